@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Vec3.h"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+template <std::floating_point T>
+struct BasicAABB {
+	using AABB = BasicAABB;
+	using Vec3 = BasicVec3<T>;
+
+	Vec3 min{
+		std::numeric_limits<T>::infinity(),
+		std::numeric_limits<T>::infinity(),
+		std::numeric_limits<T>::infinity()
+	};
+	Vec3 max{
+		-std::numeric_limits<T>::infinity(),
+		-std::numeric_limits<T>::infinity(),
+		-std::numeric_limits<T>::infinity()
+	};
+
+	constexpr BasicAABB() = default;
+	constexpr BasicAABB(const Vec3& min, const Vec3& max) : min{ min }, max{ max } {}
+
+	//exact when widening, e.g. float boxes stored in mesh files used with double rays
+	template <std::floating_point U>
+	constexpr explicit BasicAABB(const BasicAABB<U>& box)
+		: min{ T(box.min.x()), T(box.min.y()), T(box.min.z()) }, max{ T(box.max.x()), T(box.max.y()), T(box.max.z()) } {}
+
+	[[nodiscard]] constexpr
+	bool empty() const noexcept {
+		return min.x() > max.x() || min.y() > max.y() || min.z() > max.z();
+	}
+
+	constexpr
+	AABB& expand(const Vec3& p) noexcept {
+		for (auto i : { 0, 1, 2 }) {
+			min.data[i] = std::min(min.data[i], p.data[i]);
+			max.data[i] = std::max(max.data[i], p.data[i]);
+		}
+		return *this;
+	}
+
+	constexpr
+	AABB& expand(const AABB& box) noexcept {
+		for (auto i : { 0, 1, 2 }) {
+			min.data[i] = std::min(min.data[i], box.min.data[i]);
+			max.data[i] = std::max(max.data[i], box.max.data[i]);
+		}
+		return *this;
+	}
+
+	[[nodiscard]] constexpr
+	Vec3 centroid() const noexcept {
+		return (min + max) * T(0.5);
+	}
+
+	[[nodiscard]] constexpr
+	Vec3 extent() const noexcept {
+		return max - min;
+	}
+
+	[[nodiscard]] constexpr
+	T surface_area() const noexcept {
+		if (empty()) return 0;
+		const auto e = extent();
+		return 2 * (e.x() * e.y() + e.y() * e.z() + e.z() * e.x());
+	}
+
+	[[nodiscard]] constexpr
+	int largest_axis() const noexcept {
+		const auto e = extent();
+		return e.x() > e.y() && e.x() > e.z() ? 0
+		     : e.y() > e.z()                  ? 1
+		     :                                  2;
+	}
+
+	//slab test, inv_direction is 1 / ray.direction() computed once per ray
+	//returns distance at which the ray enters the box
+	//far distance is enlarged by bound of rounding error, so that rays grazing the box are not missed (pbrt 3.9.2)
+	[[nodiscard]] constexpr
+	std::optional<T> intersect(const Vec3& origin, const Vec3& inv_direction, T t_min, T t_max) const noexcept {
+		constexpr auto epsilon = std::numeric_limits<T>::epsilon() / 2;
+		constexpr auto gamma3 = 3 * epsilon / (1 - 3 * epsilon);
+
+		for (auto i : { 0, 1, 2 }) {
+			auto t0 = (min.data[i] - origin.data[i]) * inv_direction.data[i];
+			auto t1 = (max.data[i] - origin.data[i]) * inv_direction.data[i];
+			if (inv_direction.data[i] < 0) std::swap(t0, t1);
+			t1 *= 1 + 2 * gamma3;
+
+			t_min = t0 > t_min ? t0 : t_min;
+			t_max = t1 < t_max ? t1 : t_max;
+
+			if (t_max < t_min) return {};
+		}
+		return t_min;
+	}
+
+	[[nodiscard]] constexpr
+	friend AABB merge(AABB a, const AABB& b) noexcept {
+		return a.expand(b);
+	}
+};
+
+using AABB = BasicAABB<Scalar>;
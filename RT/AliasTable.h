@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Vec3.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+//Discrete distribution sampled in O(1) with one uniform number: each of n bins is split between its own index
+//and one alias, so that every index gets probability proportional to its weight in total (Vose's construction).
+class AliasTable {
+	struct Bin {
+		Scalar threshold{}; //probability of keeping the bin's own index
+		uint32_t alias{};
+		Scalar pmf{};
+	};
+
+	std::vector<Bin> bins_;
+
+public:
+	AliasTable() = default;
+
+	//weights are non negative, table stays empty when they sum to 0
+	explicit AliasTable(std::span<const double> weights) {
+		double sum = 0;
+		for (auto w : weights) sum += w;
+		if (!(sum > 0)) return;
+
+		const auto n = weights.size();
+		bins_.resize(n);
+		std::vector<double> scaled(n);
+		std::vector<uint32_t> small, large;
+		for (uint32_t i = 0; i < n; ++i) {
+			bins_[i].pmf = static_cast<Scalar>(weights[i] / sum);
+			scaled[i] = weights[i] / sum * n;
+			(scaled[i] < 1 ? small : large).push_back(i);
+		}
+
+		while (!small.empty() && !large.empty()) {
+			const auto s = small.back();
+			small.pop_back();
+			const auto l = large.back();
+
+			bins_[s].threshold = static_cast<Scalar>(scaled[s]);
+			bins_[s].alias = l;
+			scaled[l] -= 1 - scaled[s];
+			if (scaled[l] < 1) {
+				large.pop_back();
+				small.push_back(l);
+			}
+		}
+
+		//left over bins are full up to rounding
+		for (auto i : large) bins_[i] = { 1, i, bins_[i].pmf };
+		for (auto i : small) bins_[i] = { 1, i, bins_[i].pmf };
+	}
+
+	[[nodiscard]]
+	bool empty() const noexcept {
+		return bins_.empty();
+	}
+
+	[[nodiscard]]
+	size_t size() const noexcept {
+		return bins_.size();
+	}
+
+	//index and its probability, u is uniform in [0, 1), integer part of u * n selects the bin, fraction decides for alias
+	[[nodiscard]]
+	std::pair<uint32_t, Scalar> sample(double u) const noexcept {
+		const auto scaled = u * bins_.size();
+		const auto i = std::min(static_cast<size_t>(scaled), bins_.size() - 1);
+		const auto& bin = bins_[i];
+		const auto index = scaled - i < bin.threshold ? static_cast<uint32_t>(i) : bin.alias;
+		return { index, bins_[index].pmf };
+	}
+
+	[[nodiscard]]
+	Scalar pmf(uint32_t i) const noexcept {
+		return bins_[i].pmf;
+	}
+};
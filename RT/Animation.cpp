@@ -0,0 +1,34 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+	//index of the last key at or before time and weight of the next one, keys must not be empty
+	template <typename Key>
+	std::pair<size_t, Scalar> segment(std::span<const Key> keys, double time) {
+		const auto next = std::upper_bound(keys.begin(), keys.end(), time, [](double t, const Key& key) { return t < key.time; });
+		if (next == keys.begin()) return { 0, 0 };
+		if (next == keys.end()) return { keys.size() - 1, 0 };
+
+		const auto& previous = *(next - 1);
+		const auto weight = static_cast<Scalar>((time - previous.time) / (next->time - previous.time));
+		return { static_cast<size_t>(next - keys.begin()) - 1, weight };
+	}
+}
+
+Transform interpolate(std::span<const TransformKeyframe> keys, double time) {
+	if (keys.empty()) return {};
+
+	const auto [i, t] = segment(keys, time);
+	return t > 0 ? lerp(keys[i].transform, keys[i + 1].transform, t) : keys[i].transform;
+}
+
+Camera CameraTrack::at(double time, Scalar aspect_ratio) const {
+	const auto [i, t] = segment(std::span<const CameraKeyframe>{ keys }, time);
+	const auto& key = keys[i];
+	const auto lookfrom = t > 0 ? lerp(key.lookfrom, keys[i + 1].lookfrom, t) : key.lookfrom;
+	const auto lookat = t > 0 ? lerp(key.lookat, keys[i + 1].lookat, t) : key.lookat;
+
+	return { lookfrom, lookat, vup, vfov, aspect_ratio, aperture, (lookfrom - lookat).length() };
+}
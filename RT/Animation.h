@@ -0,0 +1,106 @@
+#pragma once
+
+#include "RayTracer.h"
+#include "Transform.h"
+#include "Camera.h"
+#include "Frame.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+//Keyframed motion of objects and the camera over a sequence of frames. The scene is built once, frames only place
+//the moving objects again and refit the scene BVH to them, which is rebuilt only when refits have made it too slow
+//(see Scene::refit). One Frame is rendered over and over, so a frame of a mostly static scene costs little more than its rays.
+
+//times in seconds from the start of the animation
+struct TransformKeyframe {
+	double time = 0;
+	Transform transform;
+};
+
+//blend of the keyframes around time, keys sorted by time, the first and the last ones hold before and after them
+[[nodiscard]]
+Transform interpolate(std::span<const TransformKeyframe> keys, double time);
+
+struct CameraKeyframe {
+	double time = 0;
+	Position lookfrom;
+	Position lookat;
+};
+
+struct CameraTrack {
+	std::vector<CameraKeyframe> keys; //sorted by time, at least one
+	Direction vup{ 0, 1, 0 };
+	Scalar vfov = 40;
+	Scalar aperture = 0;
+
+	//positions blended like interpolate, focused at lookat
+	[[nodiscard]]
+	Camera at(double time, Scalar aspect_ratio) const;
+};
+
+//object placed by set_transform (instances), see Scene::emplace_back for its index
+struct ObjectTrack {
+	PrimitiveIndex object;
+	std::vector<TransformKeyframe> keys;
+};
+
+struct Animation {
+	CameraTrack camera;
+	std::vector<ObjectTrack> objects;
+	uint64_t frame_count = 1;
+	double frame_rate = 24;
+};
+
+struct AnimationSettings {
+	double shutter = 0.5;           //fraction of the frame interval the shutter is open for motion blur (180 degrees), 0 for none
+	double rebuild_ratio = 1.5;     //see Scene::refit
+};
+
+struct AnimationFrame {
+	uint64_t index = 0;
+	double setup_seconds = 0;       //placing objects and refitting (or rebuilding) the BVH
+	double render_seconds = 0;
+	bool rebuilt = false;
+};
+
+//receives every frame, image is overwritten by the next one
+using AnimationCallback = std::function<void(const Frame& image, const AnimationFrame& frame)>;
+
+//renders frames of the animation tile by tile (RayTracer::render_tiles, adaptive and wavefront settings are not used)
+//objects move from their place at shutter open to the one at shutter close, lights stay where RayTracer::build found them
+template <typename Tracer>
+void render_animation(Tracer& RT, const Animation& animation, uint64_t height, uint64_t width, const RenderSettings& settings, const AnimationSettings& animation_settings, ThreadPool& pool, const AnimationCallback& callback) {
+	using clock = std::chrono::steady_clock;
+	const auto seconds_since = [](clock::time_point start) { return std::chrono::duration<double>(clock::now() - start).count(); };
+
+	Frame image{ height, width, settings.pixel_format };
+	const auto shutter = animation_settings.shutter / animation.frame_rate;
+
+	for (uint64_t index = 0; index < animation.frame_count; ++index) {
+		const auto setup_start = clock::now();
+		const auto open = index / animation.frame_rate;
+
+		for (const auto& track : animation.objects) {
+			const auto start = interpolate(track.keys, open);
+			const auto end = shutter > 0 ? interpolate(track.keys, open + shutter) : start;
+			RT.scene.update(track.object, [&](auto& object) {
+				if constexpr (requires { object.set_transform(start, end); }) object.set_transform(start, end);
+			});
+		}
+		const auto rebuilt = RT.scene.refit(animation_settings.rebuild_ratio);
+
+		auto camera = animation.camera.at(open, Scalar(width) / height);
+		if (shutter > 0) camera.set_shutter(0, 1);
+
+		AnimationFrame frame{ index, seconds_since(setup_start), 0, rebuilt };
+		const auto render_start = clock::now();
+		RT.render_tiles(camera, image, settings, pool);
+		frame.render_seconds = seconds_since(render_start);
+
+		callback(image, frame);
+	}
+}
@@ -0,0 +1,354 @@
+#pragma once
+
+#include "AABB.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//Bounding volume hierarchy built with binned SAH and stored as flat array of nodes in depth first order.
+//Left child of interior node always directly follows its parent, only index of right child is stored.
+//BVH knows nothing about primitives, it works on their bounding boxes and leaves refer to ranges
+//of primitives in order returned by build - owner is expected to reorder its storage accordingly.
+class BVH {
+public:
+	struct Node {
+		AABB bounds;
+		uint32_t offset{}; //leaf: first primitive, interior: index of right child
+		uint16_t count{};  //number of primitives in leaf, 0 for interior nodes
+		uint8_t axis{};    //split axis, used to traverse children front to back
+	};
+
+	static constexpr size_t max_depth = 64;
+
+private:
+	static constexpr size_t bin_count = 16;
+	static constexpr size_t median_split_depth = max_depth / 2;
+	static constexpr double traversal_cost = 1.0;
+	static constexpr double intersection_cost = 1.0;
+
+	std::vector<Node> nodes_;
+
+	struct BuildPrimitive {
+		AABB bounds;
+		Position centroid;
+		uint32_t index;
+	};
+
+	struct Bin {
+		AABB bounds;
+		size_t count{};
+	};
+
+	uint32_t build_recursive(std::span<BuildPrimitive> primitives, uint32_t offset, size_t depth, size_t max_leaf_size) {
+		const auto node_index = static_cast<uint32_t>(nodes_.size());
+		nodes_.emplace_back();
+
+		AABB bounds, centroid_bounds;
+		for (const auto& p : primitives) {
+			bounds.expand(p.bounds);
+			centroid_bounds.expand(p.centroid);
+		}
+		nodes_[node_index].bounds = bounds;
+
+		const auto count = primitives.size();
+		auto make_leaf = [&] {
+			nodes_[node_index].offset = offset;
+			nodes_[node_index].count = static_cast<uint16_t>(count);
+			return node_index;
+		};
+
+		if (count == 1) return make_leaf();
+
+		const auto axis = centroid_bounds.largest_axis();
+		const auto axis_min = centroid_bounds.min.data[axis];
+		const auto axis_extent = centroid_bounds.max.data[axis] - axis_min;
+
+		size_t split = 0;
+
+		if (axis_extent > 0 && depth < median_split_depth) {
+			auto bin_of = [&](const BuildPrimitive& p) {
+				const auto b = static_cast<size_t>(bin_count * (p.centroid.data[axis] - axis_min) / axis_extent);
+				return std::min(b, bin_count - 1);
+			};
+
+			std::array<Bin, bin_count> bins{};
+			for (const auto& p : primitives) {
+				auto& bin = bins[bin_of(p)];
+				bin.bounds.expand(p.bounds);
+				++bin.count;
+			}
+
+			//cost of splitting after bin i, computed with one sweep from each side
+			std::array<double, bin_count - 1> costs{};
+			AABB left_bounds;
+			size_t left_count = 0;
+			for (size_t i = 0; i < bin_count - 1; ++i) {
+				left_bounds.expand(bins[i].bounds);
+				left_count += bins[i].count;
+				costs[i] = left_count * left_bounds.surface_area();
+			}
+			AABB right_bounds;
+			size_t right_count = 0;
+			for (size_t i = bin_count - 1; i > 0; --i) {
+				right_bounds.expand(bins[i].bounds);
+				right_count += bins[i].count;
+				costs[i - 1] += right_count * right_bounds.surface_area();
+			}
+
+			const auto best = std::min_element(costs.begin(), costs.end());
+			const auto split_cost = traversal_cost + intersection_cost * *best / bounds.surface_area();
+			const auto leaf_cost = intersection_cost * count;
+
+			if (count <= max_leaf_size && leaf_cost <= split_cost) return make_leaf();
+
+			const auto best_bin = static_cast<size_t>(best - costs.begin());
+			const auto middle = std::partition(primitives.begin(), primitives.end(), [&](const BuildPrimitive& p) {
+				return bin_of(p) <= best_bin;
+			});
+			split = static_cast<size_t>(middle - primitives.begin());
+		}
+		else if (count <= max_leaf_size) {
+			return make_leaf();
+		}
+
+		//centroids cannot be separated by bins (or tree is getting too deep), split in half
+		if (split == 0 || split == count) {
+			split = count / 2;
+			std::nth_element(primitives.begin(), primitives.begin() + split, primitives.end(), [&](const BuildPrimitive& a, const BuildPrimitive& b) {
+				return a.centroid.data[axis] < b.centroid.data[axis];
+			});
+		}
+
+		nodes_[node_index].axis = static_cast<uint8_t>(axis);
+		build_recursive(primitives.first(split), offset, depth + 1, max_leaf_size);
+		const auto right = build_recursive(primitives.subspan(split), offset + static_cast<uint32_t>(split), depth + 1, max_leaf_size);
+		nodes_[node_index].offset = right;
+
+		return node_index;
+	}
+
+public:
+	//builds hierarchy over given boxes
+	//returns order of primitives - leaf range [offset, offset + count) refers to order[offset], ..., order[offset + count - 1]
+	[[nodiscard]]
+	std::vector<uint32_t> build(std::span<const AABB> boxes, size_t max_leaf_size = 4) {
+		nodes_.clear();
+		if (boxes.empty()) return {};
+
+		std::vector<BuildPrimitive> primitives;
+		primitives.reserve(boxes.size());
+		for (uint32_t i = 0; i < boxes.size(); ++i) {
+			primitives.push_back({ boxes[i], boxes[i].centroid(), i });
+		}
+
+		nodes_.reserve(2 * boxes.size());
+		build_recursive(primitives, 0, 0, std::min<size_t>(max_leaf_size, UINT16_MAX));
+		nodes_.shrink_to_fit();
+
+		std::vector<uint32_t> order(primitives.size());
+		std::transform(primitives.begin(), primitives.end(), order.begin(), [](const BuildPrimitive& p) { return p.index; });
+		return order;
+	}
+
+	//bounds of nodes recomputed for moved primitives, topology is kept
+	//boxes are in the order returned by build, children follow their parents, so one backward sweep updates all nodes
+	void refit(std::span<const AABB> boxes) noexcept {
+		for (auto i = nodes_.size(); i-- > 0;) {
+			auto& node = nodes_[i];
+			AABB bounds;
+			if (node.count > 0) {
+				for (auto p = node.offset; p < node.offset + node.count; ++p) bounds.expand(boxes[p]);
+			}
+			else {
+				bounds.expand(nodes_[i + 1].bounds).expand(nodes_[node.offset].bounds);
+			}
+			node.bounds = bounds;
+		}
+	}
+
+	//expected cost of a ray hitting the root by the surface area heuristic, relative to intersection of one primitive
+	//grows as refits stretch boxes of a hierarchy built for other positions, rebuild is due when it has grown too much
+	[[nodiscard]]
+	double sah_cost() const noexcept {
+		if (nodes_.empty()) return 0;
+		const auto root_area = nodes_.front().bounds.surface_area();
+		if (!(root_area > 0)) return intersection_cost * nodes_.front().count;
+
+		double cost = 0;
+		for (const auto& node : nodes_) {
+			const auto probability = node.bounds.surface_area() / root_area;
+			cost += probability * (node.count > 0 ? intersection_cost * node.count : traversal_cost);
+		}
+		return cost;
+	}
+
+	//takes nodes of a hierarchy built before (see SceneFile.h), primitives have to be in the order build returned then
+	void assign(std::span<const Node> nodes) {
+		nodes_.assign(nodes.begin(), nodes.end());
+	}
+
+	void clear() noexcept {
+		nodes_.clear();
+	}
+
+	//whether traversal of nodes laid out like nodes() stays in bounds, for hierarchies read from files: leaves refer to
+	//ranges of primitive_count primitives, children follow their parent and no path is deeper than traversal's stack
+	template <typename NodeT>
+	[[nodiscard]]
+	static bool valid(std::span<const NodeT> nodes, uint64_t primitive_count) {
+		std::vector<uint8_t> depths(nodes.size());
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			const auto& node = nodes[i];
+			if (node.count > 0) {
+				if (node.offset + uint64_t{ node.count } > primitive_count) return false;
+				continue;
+			}
+			if (node.offset <= i || node.offset >= nodes.size() || node.axis > 2 || depths[i] >= max_depth) return false;
+
+			const auto depth = static_cast<uint8_t>(depths[i] + 1);
+			depths[i + 1] = std::max(depths[i + 1], depth);
+			depths[node.offset] = std::max(depths[node.offset], depth);
+		}
+		return true;
+	}
+
+	[[nodiscard]]
+	bool empty() const noexcept {
+		return nodes_.empty();
+	}
+
+	[[nodiscard]]
+	const std::vector<Node>& nodes() const noexcept {
+		return nodes_;
+	}
+
+	[[nodiscard]]
+	AABB bounds() const noexcept {
+		return nodes_.empty() ? AABB{} : nodes_.front().bounds;
+	}
+
+	//visits leaves hit by the ray, nearer child first
+	//leaf(first, count, t_max) tests primitives in range, shrinks t_max on hit and returns whether anything was hit
+	template <typename LeafFn>
+	bool intersect(const Ray& ray, Scalar t_min, Scalar t_max, LeafFn&& leaf) const {
+		return traverse(std::span<const Node>{ nodes_ }, ray, t_min, t_max, std::forward<LeafFn>(leaf));
+	}
+
+	//visits leaves hit by the ray until leaf(first, count) returns true, for shadow rays any hit will do
+	template <typename LeafFn>
+	bool occluded(const Ray& ray, Scalar t_min, Scalar t_max, LeafFn&& leaf) const {
+		return traverse<true>(std::span<const Node>{ nodes_ }, ray, t_min, t_max, std::forward<LeafFn>(leaf));
+	}
+
+	//traversal of nodes laid out like nodes(), which may be stored elsewhere with boxes of other precision (mesh files)
+	//any_hit: leaf is called without t_max and traversal ends at the first leaf which reports a hit
+	template <bool any_hit = false, typename NodeT, typename LeafFn>
+	static bool traverse(std::span<const NodeT> nodes, const Ray& ray, Scalar t_min, Scalar t_max, LeafFn&& leaf) {
+		if (nodes.empty()) return false;
+
+		const auto& origin = ray.origin();
+		const Direction inv_direction{
+			1 / ray.direction().x(),
+			1 / ray.direction().y(),
+			1 / ray.direction().z()
+		};
+		const bool negative[3] = {
+			inv_direction.x() < 0,
+			inv_direction.y() < 0,
+			inv_direction.z() < 0
+		};
+
+		auto enters = [&](const NodeT& node) {
+			if constexpr (std::is_same_v<decltype(NodeT::bounds), AABB>) return node.bounds.intersect(origin, inv_direction, t_min, t_max).has_value();
+			else return AABB{ node.bounds }.intersect(origin, inv_direction, t_min, t_max).has_value();
+		};
+
+		std::array<uint32_t, max_depth> stack;
+		size_t stack_size = 0;
+		uint32_t current = 0;
+		bool hit = false;
+
+		while (true) {
+			const auto& node = nodes[current];
+			stats::count_node();
+			if (enters(node)) {
+				if (node.count > 0) {
+					stats::count_leaf(node.count);
+					if constexpr (any_hit) {
+						if (leaf(node.offset, uint32_t{ node.count })) return true;
+					}
+					else {
+						hit |= leaf(node.offset, uint32_t{ node.count }, t_max);
+					}
+				}
+				else if (negative[node.axis]) {
+					stack[stack_size++] = current + 1;
+					current = node.offset;
+					continue;
+				}
+				else {
+					stack[stack_size++] = node.offset;
+					current = current + 1;
+					continue;
+				}
+			}
+
+			if (stack_size == 0) break;
+			current = stack[--stack_size];
+		}
+
+		return hit;
+	}
+
+	//packet version, leaf(first, count, lanes) gets lanes whose rays enter the leaf and shrinks their t_max
+	//children are visited in order given by the first active ray, camera rays of a packet mostly agree
+	template <typename LeafFn>
+	void intersect(const RayPacket& packet, Scalar t_min, Scalar* t_max, LeafFn&& leaf) const {
+		if (nodes_.empty() || packet.active == 0) return;
+
+		const auto lane = std::countr_zero(packet.active);
+		const bool negative[3] = {
+			packet.direction[0][lane] < 0,
+			packet.direction[1][lane] < 0,
+			packet.direction[2][lane] < 0
+		};
+
+		std::array<uint32_t, max_depth> stack;
+		size_t stack_size = 0;
+		uint32_t current = 0;
+
+		while (true) {
+			const auto& node = nodes_[current];
+			stats::count_node();
+			if (const auto lanes = packet.intersect(node.bounds, t_min, t_max) & packet.active; lanes) {
+				if (node.count > 0) {
+					stats::count_leaf(node.count * static_cast<uint32_t>(std::popcount(lanes)));
+					leaf(node.offset, uint32_t{ node.count }, lanes);
+				}
+				else if (negative[node.axis]) {
+					stack[stack_size++] = current + 1;
+					current = node.offset;
+					continue;
+				}
+				else {
+					stack[stack_size++] = node.offset;
+					current = current + 1;
+					continue;
+				}
+			}
+
+			if (stack_size == 0) break;
+			current = stack[--stack_size];
+		}
+	}
+};
@@ -0,0 +1,1277 @@
+#include "Benchmark.h"
+#include "Scene.h"
+#include "Sphere.h"
+#include "SphereSet.h"
+#include "Simd.h"
+#include "Scenes.h"
+#include "ThreadPool.h"
+#include "PixelStatistics.h"
+#include "Materials.h"
+#include "RayPacket.h"
+#include "Sampler.h"
+#include "TriangleMesh.h"
+#include "Instance.h"
+#include "Checkpoint.h"
+#include "Animation.h"
+#include "SceneFile.h"
+#include "RenderJob.h"
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numbers>
+#include <random>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <type_traits>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+	template <typename F>
+	double time_seconds(F&& f) {
+		const auto start = std::chrono::steady_clock::now();
+		std::forward<F>(f)();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void bvh_benchmark() {
+		std::mt19937 gen{ 42 };
+		std::uniform_real_distribution<Scalar> unit{ 0, 1 };
+
+		for (size_t sphere_count : { 1'000, 10'000, 100'000 }) {
+			//keep density constant so that hit rate does not depend on the count
+			const auto half_size = std::cbrt(static_cast<Scalar>(sphere_count));
+
+			Scene<Sphere> scene;
+			for (size_t i = 0; i < sphere_count; ++i) {
+				const Position center{
+					(2 * unit(gen) - 1) * half_size,
+					(2 * unit(gen) - 1) * half_size,
+					(2 * unit(gen) - 1) * half_size
+				};
+				scene.emplace_back<Sphere>(center, Scalar(0.1) + Scalar(0.3) * unit(gen), MaterialIndex{ 0, 0 });
+			}
+
+			std::vector<Ray> rays;
+			const size_t ray_count = 100'000;
+			for (size_t i = 0; i < ray_count; ++i) {
+				const auto origin = Position{ 2 * unit(gen) - 1, 2 * unit(gen) - 1, 2 * unit(gen) - 1 } * (2 * half_size);
+				const auto target = Position{ 2 * unit(gen) - 1, 2 * unit(gen) - 1, 2 * unit(gen) - 1 } * half_size;
+				rays.emplace_back(origin, target - origin);
+			}
+
+			auto trace = [&](size_t count, double& t_sum) {
+				size_t hits = 0;
+				for (size_t i = 0; i < count; ++i) {
+					if (auto hit = scene.intersect(rays[i], 0, std::numeric_limits<Scalar>::infinity()); hit) {
+						++hits;
+						t_sum += hit->t;
+					}
+				}
+				return hits;
+			};
+
+			//linear scan is too slow to trace every ray in the biggest scenes
+			const auto linear_ray_count = std::clamp<size_t>(100'000'000 / sphere_count, 100, ray_count);
+			double linear_t_sum = 0;
+			size_t linear_hits = 0;
+			const auto linear_time = time_seconds([&] { linear_hits = trace(linear_ray_count, linear_t_sum); });
+
+			const auto build_time = time_seconds([&] { scene.build(); });
+
+			double bvh_t_sum = 0;
+			size_t bvh_hits = 0;
+			trace(linear_ray_count, bvh_t_sum);
+			const bool matches = bvh_t_sum == linear_t_sum;
+			const auto bvh_time = time_seconds([&] { bvh_hits = trace(ray_count, bvh_t_sum = 0); });
+
+			const auto linear_rate = linear_ray_count / linear_time;
+			const auto bvh_rate = ray_count / bvh_time;
+
+			std::cout << "bvh " << sphere_count << " spheres:"
+				<< " linear " << linear_rate / 1e6 << " Mrays/s (" << linear_hits << '/' << linear_ray_count << " hits),"
+				<< " bvh " << bvh_rate / 1e6 << " Mrays/s (" << bvh_hits << '/' << ray_count << " hits),"
+				<< " build " << build_time * 1e3 << " ms,"
+				<< " speedup " << bvh_rate / linear_rate
+				<< (matches ? "" : " RESULTS DIFFER") << '\n';
+		}
+	}
+
+	void sphere_set_benchmark() {
+		std::mt19937 gen{ 7 };
+		std::uniform_real_distribution<Scalar> unit{ 0, 1 };
+
+		for (size_t sphere_count : { 64, 100'000 }) {
+			const auto half_size = std::cbrt(static_cast<Scalar>(sphere_count));
+			const bool use_bvh = sphere_count > 1000;
+
+			Scene<Sphere> spheres;
+			SphereSet sphere_set;
+			for (size_t i = 0; i < sphere_count; ++i) {
+				const Position center{
+					(2 * unit(gen) - 1) * half_size,
+					(2 * unit(gen) - 1) * half_size,
+					(2 * unit(gen) - 1) * half_size
+				};
+				const auto radius = Scalar(0.1) + Scalar(0.3) * unit(gen);
+				spheres.emplace_back<Sphere>(center, radius, MaterialIndex{ 0, i });
+				sphere_set.emplace_back(center, radius, MaterialIndex{ 0, i });
+			}
+			if (use_bvh) {
+				spheres.build();
+				sphere_set.build();
+			}
+
+			std::vector<Ray> rays;
+			const size_t ray_count = 200'000;
+			for (size_t i = 0; i < ray_count; ++i) {
+				const auto origin = Position{ 2 * unit(gen) - 1, 2 * unit(gen) - 1, 2 * unit(gen) - 1 } * (2 * half_size);
+				const auto target = Position{ 2 * unit(gen) - 1, 2 * unit(gen) - 1, 2 * unit(gen) - 1 } * half_size;
+				rays.emplace_back(origin, target - origin);
+			}
+
+			std::vector<std::optional<HitRecord>> reference(ray_count);
+			const auto aos_time = time_seconds([&] {
+				for (size_t i = 0; i < ray_count; ++i) reference[i] = spheres.intersect(rays[i], 0, std::numeric_limits<Scalar>::infinity());
+			});
+			std::cout << "spheres " << sphere_count << (use_bvh ? " (bvh)" : "") << ": Sphere " << ray_count / aos_time / 1e6 << " Mrays/s";
+
+			for (auto level : { simd::Level::scalar, simd::Level::avx2, simd::Level::avx512 }) {
+				if (level > simd::detect()) continue;
+				simd::set_level(level);
+
+				size_t mismatches = 0;
+				const auto time = time_seconds([&] {
+					for (size_t i = 0; i < ray_count; ++i) {
+						const auto hit = sphere_set.intersect(rays[i], 0, std::numeric_limits<Scalar>::infinity());
+						if (hit.has_value() != reference[i].has_value() || (hit && (hit->t != reference[i]->t || hit->material.vector_index != reference[i]->material.vector_index))) {
+							++mismatches;
+						}
+					}
+				});
+				std::cout << ", SphereSet " << simd::name(level) << ' ' << ray_count / time / 1e6 << " Mrays/s";
+				if (mismatches) std::cout << " (" << mismatches << " MISMATCHES)";
+			}
+			simd::set_level(simd::detect());
+			std::cout << '\n';
+		}
+	}
+
+	void thread_scaling_benchmark() {
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		const uint64_t height = 200;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = book_camera(double(width) / height);
+
+		RenderSettings settings;
+		settings.samples_per_pixel = 16;
+		settings.max_depth = 50;
+		settings.report_progress = false;
+
+		const auto max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		std::vector<size_t> thread_counts;
+		for (size_t t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+		thread_counts.push_back(max_threads);
+
+		std::optional<Frame> reference;
+		double single_thread_time = 0;
+
+		for (auto thread_count : thread_counts) {
+			ThreadPool pool{ thread_count };
+			std::optional<Frame> frame;
+			const auto time = time_seconds([&] { frame = RT.render(camera, height, width, settings, pool); });
+
+			if (!reference) {
+				reference = frame;
+				single_thread_time = time;
+			}
+			const bool matches = *frame == *reference;
+
+			std::cout << "threads " << thread_count << ": " << time << " s,"
+				<< " speedup " << single_thread_time / time << ","
+				<< " efficiency " << single_thread_time / time / thread_count
+				<< (matches ? "" : " IMAGE DIFFERS") << '\n';
+		}
+	}
+
+	void rng_benchmark() {
+		const size_t count = 100'000'000;
+
+		std::mt19937 mt;
+		std::uniform_real_distribution<double> distribution{ 0.0, 1.0 };
+		double mt_sum = 0;
+		const auto mt_time = time_seconds([&] {
+			for (size_t i = 0; i < count; ++i) mt_sum += distribution(mt);
+		});
+
+		utils::CounterRng counter_rng;
+		double counter_sum = 0;
+		const auto counter_time = time_seconds([&] {
+			for (size_t i = 0; i < count; ++i) counter_sum += counter_rng.uniform();
+		});
+
+		//includes rekeying for every sample, as done when rendering
+		double keyed_sum = 0;
+		const auto keyed_time = time_seconds([&] {
+			for (size_t i = 0; i < count / 8; ++i) {
+				counter_rng.start_sample(i, 0);
+				for (int j = 0; j < 8; ++j) keyed_sum += counter_rng.uniform();
+			}
+		});
+
+		const auto mt_seed_time = time_seconds([&] {
+			for (uint32_t i = 0; i < 100'000; ++i) mt.seed(i);
+		});
+
+		std::cout << "rng mt19937: " << count / mt_time / 1e6 << " M/s"
+			<< ", counter: " << count / counter_time / 1e6 << " M/s"
+			<< ", counter rekeyed every 8: " << count / keyed_time / 1e6 << " M/s"
+			<< ", mt19937 seeding: " << mt_seed_time / 100'000 * 1e9 << " ns"
+			<< ", state " << sizeof(std::mt19937) << " vs " << sizeof(utils::CounterRng) << " bytes"
+			<< " (means " << mt_sum / count << ' ' << counter_sum / count << ' ' << keyed_sum / (count / 8 * 8) << ")\n";
+	}
+
+	[[nodiscard]]
+	double mean_luminance(const Frame& frame) {
+		double sum = 0;
+		for (uint64_t y = 0; y < frame.height(); ++y) {
+			for (uint64_t x = 0; x < frame.width(); ++x) {
+				sum += luminance(frame.pixel(y, x));
+			}
+		}
+		return sum / (frame.height() * frame.width());
+	}
+
+	//compared after gamma 2 encoding, as written by Frame::to_ppm
+	[[nodiscard]]
+	double rms_difference(const Frame& a, const Frame& b) {
+		double sum = 0;
+		for (uint64_t y = 0; y < a.height(); ++y) {
+			for (uint64_t x = 0; x < a.width(); ++x) {
+				const auto& ca = a.pixel(y, x);
+				const auto& cb = b.pixel(y, x);
+				for (auto i : { 0, 1, 2 }) {
+					const auto d = std::sqrt(std::max<double>(ca.data[i], 0)) - std::sqrt(std::max<double>(cb.data[i], 0));
+					sum += d * d / 3;
+				}
+			}
+		}
+		return std::sqrt(sum / (a.height() * a.width()));
+	}
+
+	void integrator_benchmark() {
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		const uint64_t height = 100;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = book_camera(double(width) / height);
+
+		RenderSettings settings;
+		settings.samples_per_pixel = 64;
+		settings.report_progress = false;
+
+		ThreadPool pool{ settings.thread_count };
+		const auto samples = static_cast<double>(height * width * settings.samples_per_pixel);
+
+		auto run = [&](const char* name, Integrator integrator, int russian_roulette_depth) {
+			settings.integrator = integrator;
+			settings.russian_roulette_depth = russian_roulette_depth;
+			std::optional<Frame> frame;
+			const auto time = time_seconds([&] { frame = RT.render(camera, height, width, settings, pool); });
+			std::cout << "integrator " << name << ": " << samples / time / 1e6 << " Msamples/s, mean luminance " << mean_luminance(*frame) << '\n';
+			return *frame;
+		};
+
+		const auto recursive = run("recursive", Integrator::recursive, settings.max_depth);
+		const auto iterative = run("iterative", Integrator::iterative, settings.max_depth);
+		const auto roulette = run("iterative+roulette", Integrator::iterative, 5);
+
+		std::cout << "integrator rms difference to recursive: iterative " << rms_difference(recursive, iterative)
+			<< ", iterative+roulette " << rms_difference(recursive, roulette) << '\n';
+	}
+
+	void adaptive_benchmark() {
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		const uint64_t height = 60;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = book_camera(double(width) / height);
+
+		RenderSettings settings;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+
+		settings.samples_per_pixel = 4096;
+		const auto reference = RT.render(camera, height, width, settings, pool);
+
+		for (int samples : { 32, 128 }) {
+			settings.samples_per_pixel = samples;
+			settings.adaptive.enabled = false;
+			std::optional<Frame> fixed;
+			const auto fixed_time = time_seconds([&] { fixed = RT.render(camera, height, width, settings, pool); });
+
+			std::cout << "fixed " << samples << " spp: " << fixed_time << " s, rms error " << rms_difference(reference, *fixed) << '\n';
+
+			settings.samples_per_pixel = 4 * samples;
+			settings.adaptive.enabled = true;
+			for (double threshold : { 0.01, 0.005 }) {
+				settings.adaptive.threshold = threshold;
+				std::optional<AdaptiveRender> adaptive;
+				const auto adaptive_time = time_seconds([&] { adaptive = RT.render_adaptive(camera, height, width, settings, pool); });
+
+				std::cout << "adaptive max " << settings.samples_per_pixel << " spp, threshold " << threshold << ": " << adaptive_time << " s,"
+					<< " average " << double(adaptive->total_samples) / (height * width) << " spp,"
+					<< " rms error " << rms_difference(reference, adaptive->image) << '\n';
+			}
+
+			settings.adaptive.threshold = 0;
+			settings.adaptive.sample_budget = height * width * samples;
+			std::optional<AdaptiveRender> budgeted;
+			const auto budgeted_time = time_seconds([&] { budgeted = RT.render_adaptive(camera, height, width, settings, pool); });
+			std::cout << "adaptive budget " << samples << " spp: " << budgeted_time << " s,"
+				<< " rms error " << rms_difference(reference, budgeted->image) << '\n';
+			settings.adaptive.sample_budget = 0;
+		}
+	}
+
+	void progressive_benchmark() {
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		const uint64_t height = 100;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = book_camera(double(width) / height);
+
+		RenderSettings settings;
+		settings.samples_per_pixel = 32;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+
+		const auto full = RT.render(camera, height, width, settings, pool);
+		int snapshots = 0;
+		const auto progressive = RT.render_progressive(camera, height, width, settings, pool, [&](const Frame&, int) { ++snapshots; });
+		std::cout << "progressive " << settings.samples_per_pixel << " spp: " << snapshots << " snapshots"
+			<< (progressive == full ? ", same as render" : ", IMAGE DIFFERS") << '\n';
+
+		settings.samples_per_pixel = 1'000'000;
+		for (double budget : { 0.5, 2.0 }) {
+			settings.progressive.time_budget = budget;
+			int samples = 0;
+			const auto time = time_seconds([&] {
+				RT.render_progressive(camera, height, width, settings, pool, [&](const Frame&, int spp) { samples = spp; });
+			});
+			std::cout << "progressive budget " << budget << " s: " << samples << " spp in " << time << " s\n";
+		}
+	}
+
+	//fills a large frame from all threads, tile by tile, in both pixel formats
+	void frame_benchmark() {
+		const uint64_t size = 8192;
+		const uint64_t tile_size = 32;
+		const auto tiles = size / tile_size;
+		ThreadPool pool;
+
+		for (auto format : { PixelFormat::scalar, PixelFormat::float32 }) {
+			std::optional<Frame> frame;
+			const auto allocation_time = time_seconds([&] { frame.emplace(size, size, format); });
+			const auto write_time = time_seconds([&] {
+				pool.parallel_for(tiles * tiles, [&](size_t index) {
+					auto view = frame->view({ index / tiles * tile_size, index % tiles * tile_size, tile_size, tile_size });
+					for (uint64_t y = 0; y < tile_size; ++y) {
+						for (uint64_t x = 0; x < tile_size; ++x) {
+							view.set_pixel(y, x, Color{ Scalar(x), Scalar(y), Scalar(index) });
+						}
+					}
+				});
+			});
+
+			std::cout << "frame " << size << 'x' << size << (format == PixelFormat::float32 ? " float32" : " scalar") << ": "
+				<< frame->memory_size() / double(1 << 20) << " MiB, allocation " << allocation_time * 1e3 << " ms,"
+				<< " tiled writes " << size * size / write_time / 1e6 << " Mpixels/s\n";
+		}
+	}
+
+	//writer from before rows were converted at once, kept as baseline
+	void write_ppm_per_pixel(const Frame& frame, const char* filename) {
+		auto file = std::ofstream{ filename, std::ios::binary };
+		const auto header = "P6 " + std::to_string(frame.width()) + " " + std::to_string(frame.height()) + " 255 ";
+		file.write(header.data(), header.size());
+		for (uint64_t y = 0; y < frame.height(); ++y) {
+			for (uint64_t x = 0; x < frame.width(); ++x) {
+				const auto c = frame.pixel(y, x);
+				unsigned char data[3];
+				for (auto i : { 0, 1, 2 }) data[i] = static_cast<unsigned char>(utils::clamp(256 * std::sqrt(c.data[i]), Scalar(0), Scalar(255)));
+				file.write(reinterpret_cast<const char*>(data), 3);
+			}
+		}
+	}
+
+	[[nodiscard]]
+	std::string read_file(const std::filesystem::path& path) {
+		std::ifstream file{ path, std::ios::binary };
+		return { std::istreambuf_iterator<char>{ file }, {} };
+	}
+
+	void output_benchmark() {
+		const auto directory = std::filesystem::temp_directory_path();
+		const auto path = [&](const char* name) { return (directory / name).string(); };
+
+		for (auto [height, width] : { std::pair<uint64_t, uint64_t>{ 1200, 1800 }, { 4320, 7680 } }) {
+			Frame frame{ height, width };
+			for (uint64_t y = 0; y < height; ++y) {
+				for (uint64_t x = 0; x < width; ++x) {
+					frame.set_pixel(y, x, { Scalar(x) / width, Scalar(y) / height, Scalar(0.5) * (x + y) / (width + height) });
+				}
+			}
+
+			const auto baseline = time_seconds([&] { write_ppm_per_pixel(frame, path("rt_output_baseline.ppm").c_str()); });
+			std::cout << "output " << width << 'x' << height << ": per pixel ppm " << baseline * 1e3 << " ms";
+
+			for (const char* name : { "rt_output.ppm", "rt_output.pfm", "rt_output.png" }) {
+				const auto time = time_seconds([&] { frame.save(path(name).c_str()); });
+				std::cout << ", " << std::string_view{ name }.substr(10) << ' ' << time * 1e3 << " ms";
+			}
+
+			const bool matches = read_file(path("rt_output.ppm")) == read_file(path("rt_output_baseline.ppm"));
+			std::cout << (matches ? "" : " (PPM DIFFERS)") << '\n';
+
+			for (const char* name : { "rt_output_baseline.ppm", "rt_output.ppm", "rt_output.pfm", "rt_output.png" }) {
+				std::filesystem::remove(directory / name);
+			}
+		}
+	}
+
+	//material storage from before the variant table, kept as baseline - one vector per type, dispatched by visit_tuple
+	template <Material... Ms>
+	class TupleMaterialList {
+		std::tuple<std::vector<Ms>...> materials;
+
+	public:
+		template <Material M, typename... Ts>
+		MaterialIndex emplace_material(Ts... args) {
+			auto& vec = std::get<std::vector<M>>(materials);
+			vec.emplace_back(std::forward<Ts>(args)...);
+			return { utils::first_occurance<M, Ms...>::value, vec.size() - 1 };
+		}
+
+		[[nodiscard]]
+		std::optional<ScatterResult> get_scatter_result(const Ray& ray, const HitRecord& hit) const {
+			return utils::visit_tuple(materials, [&]<Material T>(const std::vector<T>& v) {
+				return v[hit.material.vector_index].scatter(ray, hit);
+			}, hit.material.type_index);
+		}
+	};
+
+	[[nodiscard]]
+	double checksum(const std::optional<ScatterResult>& res) {
+		if (!res) return 0;
+		const auto& d = res->scattered.direction();
+		return res->attenuation.x() + d.x() + d.y() + d.z();
+	}
+
+	//scatter of random hits with book scene mix of materials: tuple dispatch, variant dispatch and hits grouped by material
+	void material_dispatch_benchmark() {
+		std::mt19937 gen{ 3 };
+		std::uniform_real_distribution<Scalar> unit{ 0, 1 };
+		std::discrete_distribution<int> material_dst{ { 80, 15, 5 } };
+
+		TupleMaterialList<Lambertian, Metal, Dielectric> tuple_list;
+		MaterialList<Lambertian, Metal, Dielectric> variant_list;
+		std::vector<MaterialIndex> tuple_indices, variant_indices;
+
+		for (size_t i = 0; i < 500; ++i) {
+			const Color color{ unit(gen), unit(gen), unit(gen) };
+			const auto fuzz = unit(gen) / 2;
+			switch (material_dst(gen)) {
+			case 0:
+				tuple_indices.push_back(tuple_list.emplace_material<Lambertian>(color));
+				variant_indices.push_back(variant_list.emplace_material<Lambertian>(color));
+				break;
+			case 1:
+				tuple_indices.push_back(tuple_list.emplace_material<Metal>(color, fuzz));
+				variant_indices.push_back(variant_list.emplace_material<Metal>(color, fuzz));
+				break;
+			default:
+				tuple_indices.push_back(tuple_list.emplace_material<Dielectric>(Scalar(1.5)));
+				variant_indices.push_back(variant_list.emplace_material<Dielectric>(Scalar(1.5)));
+			}
+		}
+
+		const size_t hit_count = 1'000'000;
+		std::vector<Ray> rays;
+		std::vector<HitRecord> tuple_hits, variant_hits;
+		std::vector<MaterialIndex> hit_materials;
+		std::uniform_int_distribution<size_t> material_of_hit{ 0, tuple_indices.size() - 1 };
+		for (size_t i = 0; i < hit_count; ++i) {
+			const auto normal = Direction{ unit(gen) - Scalar(0.5), unit(gen) - Scalar(0.5), unit(gen) - Scalar(0.5) }.unit();
+			const auto direction = Direction{ unit(gen) - Scalar(0.5), unit(gen) - Scalar(0.5), unit(gen) - Scalar(0.5) };
+			rays.emplace_back(Position{ 0, 0, 0 }, direction);
+
+			HitRecord hit;
+			hit.position = direction;
+			hit.t = 1;
+			hit.set_face_normal(direction, normal);
+			const auto m = material_of_hit(gen);
+			hit.material = tuple_indices[m];
+			tuple_hits.push_back(hit);
+			hit.material = variant_indices[m];
+			variant_hits.push_back(hit);
+			hit_materials.push_back(hit.material);
+		}
+
+		double tuple_sum = 0, variant_sum = 0, sorted_sum = 0;
+		const auto tuple_time = time_seconds([&] {
+			for (size_t i = 0; i < hit_count; ++i) {
+				utils::sampler.start_sample(SamplePattern{}, i, 0);
+				tuple_sum += checksum(tuple_list.get_scatter_result(rays[i], tuple_hits[i]));
+			}
+		});
+		const auto variant_time = time_seconds([&] {
+			for (size_t i = 0; i < hit_count; ++i) {
+				utils::sampler.start_sample(SamplePattern{}, i, 0);
+				variant_sum += checksum(variant_list.get_scatter_result(rays[i], variant_hits[i]));
+			}
+		});
+
+		std::vector<double> sorted_results(hit_count);
+		std::vector<uint32_t> order;
+		const auto sorted_time = time_seconds([&] {
+			variant_list.for_each_sorted(hit_materials, order, [&](uint32_t i, const auto& material) {
+				utils::sampler.start_sample(SamplePattern{}, i, 0);
+				sorted_results[i] = checksum(material.scatter(rays[i], variant_hits[i]));
+			});
+		});
+		for (auto r : sorted_results) sorted_sum += r;
+
+		std::cout << "materials: tuple " << hit_count / tuple_time / 1e6 << " Mscatters/s,"
+			<< " variant " << hit_count / variant_time / 1e6 << " Mscatters/s,"
+			<< " sorted by type " << hit_count / sorted_time / 1e6 << " Mscatters/s"
+			<< (tuple_sum == variant_sum && variant_sum == sorted_sum ? "" : " RESULTS DIFFER") << '\n';
+	}
+
+	//book scene (as in default render) with iterative and wavefront integrators
+	void material_render_benchmark() {
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		const uint64_t height = 120;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = book_camera(double(width) / height);
+
+		RenderSettings settings;
+		settings.samples_per_pixel = 32;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+		const auto samples = static_cast<double>(height * width * settings.samples_per_pixel);
+
+		std::optional<Frame> iterative;
+		std::optional<WavefrontRender> wavefront;
+		settings.integrator = Integrator::iterative;
+		const auto iterative_time = time_seconds([&] { iterative = RT.render(camera, height, width, settings, pool); });
+		const auto wavefront_time = time_seconds([&] { wavefront = RT.render_wavefront(camera, height, width, settings, pool); });
+
+		std::cout << "materials render: iterative " << samples / iterative_time / 1e6 << " Msamples/s,"
+			<< " wavefront (sorted shading) " << samples / wavefront_time / 1e6 << " Msamples/s"
+			<< (*iterative == wavefront->image ? ", same image" : ", IMAGE DIFFERS") << '\n';
+	}
+
+	void material_benchmark() {
+		material_dispatch_benchmark();
+		material_render_benchmark();
+	}
+
+	//megakernel (iterative) and stream engine on the book scene, rays/s counts every bounce of every path
+	void wavefront_benchmark() {
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		RenderSettings settings;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+
+		for (auto [height, samples] : { std::pair<uint64_t, int>{ 120, 64 }, { 400, 4 } }) {
+			const auto width = height * 3 / 2;
+			const auto camera = book_camera(double(width) / height);
+			settings.samples_per_pixel = samples;
+
+			std::optional<WavefrontRender> wavefront;
+			std::optional<Frame> iterative;
+			settings.integrator = Integrator::iterative;
+			const auto iterative_time = time_seconds([&] { iterative = RT.render(camera, height, width, settings, pool); });
+			const auto wavefront_time = time_seconds([&] { wavefront = RT.render_wavefront(camera, height, width, settings, pool); });
+
+			//both follow the same paths, so they trace the same rays
+			const auto rays = static_cast<double>(wavefront->rays);
+			std::cout << "wavefront " << width << 'x' << height << ' ' << samples << " spp: " << rays / 1e6 << " Mrays,"
+				<< " iterative " << rays / iterative_time / 1e6 << " Mrays/s,"
+				<< " wavefront " << rays / wavefront_time / 1e6 << " Mrays/s"
+				<< (*iterative == wavefront->image ? ", same image" : ", IMAGE DIFFERS") << '\n';
+		}
+	}
+
+	//million triangle sphere: OBJ parse and BVH build, mapping of the converted file, trace speed
+	//and watertightness - rays from the center towards vertices and edge midpoints must all hit
+	void mesh_benchmark() {
+		const auto directory = std::filesystem::temp_directory_path();
+		const auto obj_path = (directory / "rt_mesh_benchmark.obj").string();
+		const auto mesh_path = (directory / "rt_mesh_benchmark.rtmesh").string();
+
+		const auto [vertices, triangles] = sphere_mesh(512, 1024);
+		{
+			std::ofstream obj{ obj_path };
+			for (const auto& v : vertices) obj << "v " << v[0] << ' ' << v[1] << ' ' << v[2] << '\n';
+			for (const auto& t : triangles) obj << "f " << t[0] + 1 << ' ' << t[1] + 1 << ' ' << t[2] + 1 << '\n';
+		}
+
+		std::optional<TriangleMesh> parsed, mapped;
+		const auto parse_time = time_seconds([&] { parsed = TriangleMesh::from_obj(obj_path.c_str(), MaterialIndex{ 0, 0 }); });
+		if (!parsed || !parsed->save(mesh_path.c_str())) {
+			std::cerr << "mesh: cannot convert " << obj_path << '\n';
+			return;
+		}
+		const auto load_time = time_seconds([&] { mapped = TriangleMesh::load(mesh_path.c_str(), MaterialIndex{ 0, 0 }); });
+		if (!mapped) {
+			std::cerr << "mesh: cannot load " << mesh_path << '\n';
+			return;
+		}
+
+		std::cout << "mesh " << mapped->triangle_count() << " triangles: obj " << std::filesystem::file_size(obj_path) / 1e6 << " MB,"
+			<< " parse and build " << parse_time << " s, mesh file " << std::filesystem::file_size(mesh_path) / 1e6 << " MB,"
+			<< " load " << load_time * 1e3 << " ms\n";
+
+		const auto infinity = std::numeric_limits<Scalar>::infinity();
+		std::mt19937 gen{ 42 };
+		std::uniform_real_distribution<Scalar> unit{ -1, 1 };
+		std::vector<Ray> rays;
+		for (size_t i = 0; i < 1'000'000; ++i) {
+			const auto origin = Position{ unit(gen), unit(gen), unit(gen) } * 3;
+			rays.emplace_back(origin, Position{ unit(gen), unit(gen), unit(gen) } * Scalar(0.8) - origin);
+		}
+
+		Scene<Sphere> sphere_scene;
+		sphere_scene.emplace_back<Sphere>(Position{ 0, 0, 0 }, 1, MaterialIndex{ 0, 0 });
+		sphere_scene.build();
+
+		//incoherent rays over 50 MB of nodes and triangles are bound by cache misses, first pass over the mapped file also by page faults
+		size_t hits = 0, parsed_hits = 0, sphere_hits = 0;
+		const auto mapped_time = time_seconds([&] {
+			for (const auto& ray : rays) hits += mapped->intersect(ray, 0, infinity).has_value();
+		});
+		const auto parsed_time = time_seconds([&] {
+			for (const auto& ray : rays) parsed_hits += parsed->intersect(ray, 0, infinity).has_value();
+		});
+		for (const auto& ray : rays) sphere_hits += sphere_scene.intersect(ray, 0, infinity).has_value();
+
+		//from the center, the hardest rays go exactly through vertices and along shared edges
+		size_t watertight_rays = 0, misses = 0;
+		auto shoot = [&](const Position& target) {
+			++watertight_rays;
+			misses += !mapped->intersect(Ray{ Position{ 0, 0, 0 }, target }, 0, infinity).has_value();
+		};
+		auto position = [&](uint32_t i) { return Position{ vertices[i][0], vertices[i][1], vertices[i][2] }; };
+		for (uint32_t i = 0; i < vertices.size(); ++i) shoot(position(i));
+		for (const auto& t : triangles) shoot((position(t[0]) + position(t[1])) * Scalar(0.5));
+
+		std::cout << "mesh trace: mapped " << rays.size() / mapped_time / 1e6 << " Mrays/s, in memory " << rays.size() / parsed_time / 1e6 << " Mrays/s,"
+			<< " " << hits << " hits" << (hits == parsed_hits ? "" : " DIFFER") << " (analytic sphere " << sphere_hits << "),"
+			<< " " << misses << " misses of " << watertight_rays << " rays through vertices and edges,"
+			<< " " << mapped->memory_size() / 1e6 << " MB mapped\n";
+
+		std::filesystem::remove(obj_path);
+		std::filesystem::remove(mesh_path);
+	}
+
+	//forest of instances of one tree against the same forest with every sphere copied into one SphereSet
+	//instances are only a few hundred bytes each, while copies grow with size of the tree
+	void instancing_benchmark() {
+		constexpr size_t tree_count = 10'000;
+
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		const auto tree = tree_asset(RT);
+		const auto layout = forest_layout(tree_count);
+		const auto ground_material = RT.materials.emplace_material<Lambertian>(Color{ 0.4, 0.35, 0.25 });
+
+		const auto instanced_time = time_seconds([&] {
+			RT.scene.emplace_back<Sphere>(Position{ 0, -10000, 0 }, 10000, ground_material);
+			for (const auto& transform : layout) RT.scene.emplace_back<Instance<SphereSet>>(tree, transform);
+			RT.scene.build();
+		});
+
+		//trees are only rotated and uniformly scaled, so transformed spheres are spheres again
+		Scene<Sphere, SphereSet> flat;
+		const auto flat_time = time_seconds([&] {
+			flat.emplace_back<Sphere>(Position{ 0, -10000, 0 }, 10000, ground_material);
+			SphereSet spheres;
+			spheres.reserve(tree_count * tree->size());
+			for (const auto& transform : layout) {
+				const auto scale = transform.vector(Direction{ 1, 0, 0 }).length();
+				for (size_t i = 0; i < tree->size(); ++i) {
+					spheres.emplace_back(transform.point(tree->center(i)), tree->radius(i) * scale, tree->material(i));
+				}
+			}
+			flat.push_back(std::move(spheres));
+			flat.build();
+		});
+
+		const auto sphere_bytes = 4 * sizeof(Scalar) + sizeof(MaterialIndex);
+		const auto tree_bytes = tree->size() * sphere_bytes;
+		const auto instanced_bytes = tree_count * sizeof(Instance<SphereSet>) + tree_bytes;
+		const auto flat_bytes = tree_count * tree_bytes;
+
+		std::cout << "instancing " << tree_count << " trees of " << tree->size() << " spheres: instances " << instanced_bytes / 1e6 << " MB,"
+			<< " build " << instanced_time << " s, copies " << flat_bytes / 1e6 << " MB, build " << flat_time << " s\n";
+
+		const uint64_t height = 400;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = forest_camera(tree_count, double(width) / height);
+		constexpr auto infinity = std::numeric_limits<Scalar>::infinity();
+
+		std::vector<Ray> rays;
+		for (uint64_t y = 0; y < height; ++y) {
+			for (uint64_t x = 0; x < width; ++x) rays.push_back(camera.get_ray((x + Scalar(0.5)) / width, (y + Scalar(0.5)) / height));
+		}
+
+		std::vector<std::optional<HitRecord>> instanced_hits(rays.size()), flat_hits(rays.size());
+		const auto instanced_trace = time_seconds([&] {
+			for (size_t i = 0; i < rays.size(); ++i) instanced_hits[i] = RT.scene.intersect(rays[i], 0, infinity);
+		});
+		const auto flat_trace = time_seconds([&] {
+			for (size_t i = 0; i < rays.size(); ++i) flat_hits[i] = flat.intersect(rays[i], 0, infinity);
+		});
+
+		//distances agree up to rounding of the transforms, which in single precision decides some rays grazing silhouettes
+		size_t differing = 0;
+		for (size_t i = 0; i < rays.size(); ++i) {
+			const auto& a = instanced_hits[i];
+			const auto& b = flat_hits[i];
+			if (a.has_value() != b.has_value() || (a && std::abs(a->t - b->t) > Scalar(1e-3) * b->t)) ++differing;
+		}
+
+		std::cout << "instancing camera rays: instances " << rays.size() / instanced_trace / 1e6 << " Mrays/s,"
+			<< " copies " << rays.size() / flat_trace / 1e6 << " Mrays/s, " << differing << " of " << rays.size() << " hits differ\n";
+	}
+
+	//shadow rays from visible points towards random points of a square light above the scene
+	//answered by closest hit and by occlusion query, which may stop at any blocker
+	template <typename Tracer>
+	void shadow_ray_benchmark(const char* name, const Tracer& RT, const Camera& camera, const Position& light_center, Scalar light_size) {
+		const uint64_t height = 400;
+		const uint64_t width = height * 3 / 2;
+		constexpr auto infinity = std::numeric_limits<Scalar>::infinity();
+
+		std::mt19937 gen{ 42 };
+		std::uniform_real_distribution<Scalar> unit{ -0.5, 0.5 };
+		std::vector<Ray> rays;
+		for (uint64_t y = 0; y < height; ++y) {
+			for (uint64_t x = 0; x < width; ++x) {
+				const auto hit = RT.scene.intersect(camera.get_ray((x + Scalar(0.5)) / width, (y + Scalar(0.5)) / height), 0, infinity);
+				if (!hit) continue;
+				const auto target = light_center + Direction{ unit(gen), 0, unit(gen) } * light_size;
+				rays.push_back(hit->spawn_ray(target - hit->position));
+			}
+		}
+
+		//direction reaches the light at t = 1
+		size_t closest_blocked = 0, any_blocked = 0;
+		const auto closest_time = time_seconds([&] {
+			for (const auto& ray : rays) closest_blocked += RT.scene.intersect(ray, 0, 1).has_value();
+		});
+		const auto any_time = time_seconds([&] {
+			for (const auto& ray : rays) any_blocked += RT.scene.occluded(ray, 0, 1);
+		});
+
+		std::cout << "occlusion " << name << ", " << rays.size() << " shadow rays, " << closest_blocked << " blocked"
+			<< (closest_blocked == any_blocked ? "" : " DIFFER") << ": closest hit " << rays.size() / closest_time / 1e6 << " Mrays/s,"
+			<< " occluded " << rays.size() / any_time / 1e6 << " Mrays/s\n";
+	}
+
+	void occlusion_benchmark() {
+		{
+			DefaultRayTracer RT{};
+			utils::rng.seed();
+			book_scene(RT);
+			shadow_ray_benchmark("book", RT, book_camera(1.5), Position{ 0, 20, 0 }, 20);
+		}
+		{
+			constexpr size_t tree_count = 10'000;
+			DefaultRayTracer RT{};
+			utils::rng.seed();
+			forest_scene(RT, tree_count);
+			shadow_ray_benchmark("forest", RT, forest_camera(tree_count, 1.5), Position{ 0, 50, 0 }, 100);
+		}
+	}
+
+	//rms error against a reference of the book scene for each sampler, as samples per pixel double
+	//reference has another seed, so its noise is independent of the measured images
+	void convergence_benchmark() {
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		const uint64_t height = 60;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = book_camera(double(width) / height);
+
+		RenderSettings settings;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+
+		settings.samples_per_pixel = 4096;
+		settings.sampler = SamplerType::sobol;
+		settings.seed = 1;
+		const auto reference = RT.render(camera, height, width, settings, pool);
+		settings.seed = 0;
+
+		constexpr std::pair<SamplerType, const char*> samplers[] = {
+			{ SamplerType::independent, "independent" },
+			{ SamplerType::stratified, "stratified" },
+			{ SamplerType::sobol, "sobol" },
+			{ SamplerType::blue_noise, "blue noise" }
+		};
+		constexpr int sample_counts[] = { 1, 4, 16, 64, 256 };
+
+		double independent_error = 0;
+		for (const auto& [type, name] : samplers) {
+			settings.sampler = type;
+			std::cout << "convergence " << name << ':';
+			double time = 0, error = 0;
+			for (int samples : sample_counts) {
+				settings.samples_per_pixel = samples;
+				std::optional<Frame> frame;
+				time += time_seconds([&] { frame = RT.render(camera, height, width, settings, pool); });
+
+				error = rms_difference(reference, *frame);
+				if (type == SamplerType::independent) independent_error = error;
+				std::cout << ' ' << samples << " spp " << error;
+			}
+
+			//samples independent sampling needs for the same error at the highest count, its error falls as 1 / sqrt(spp)
+			const auto ratio = independent_error / error;
+			std::cout << ", " << time << " s, " << settings.samples_per_pixel << " spp worth " << settings.samples_per_pixel * ratio * ratio << " independent spp\n";
+		}
+	}
+
+	//room lit by a small light, rendered with light sampling and with scattered rays only
+	//rms error against a light sampled reference of another seed, and samples without light sampling which match its error
+	void light_sampling_benchmark() {
+		DefaultRayTracer RT{};
+		room_scene(RT);
+
+		const uint64_t height = 60;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = room_camera(double(width) / height);
+
+		RenderSettings settings;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+
+		settings.samples_per_pixel = 4096;
+		settings.seed = 1;
+		const auto reference = RT.render(camera, height, width, settings, pool);
+		settings.seed = 0;
+
+		constexpr int sample_counts[] = { 4, 16, 64, 256 };
+		std::array<double, std::size(sample_counts)> unsampled_errors{};
+		for (bool sample_lights : { false, true }) {
+			settings.sample_lights = sample_lights;
+			std::cout << "lights " << (sample_lights ? "sampled:" : "not sampled:");
+			double time = 0;
+			std::optional<Frame> frame;
+			for (size_t i = 0; i < std::size(sample_counts); ++i) {
+				settings.samples_per_pixel = sample_counts[i];
+				time += time_seconds([&] { frame = RT.render(camera, height, width, settings, pool); });
+
+				const auto error = rms_difference(reference, *frame);
+				std::cout << ' ' << sample_counts[i] << " spp " << error;
+				if (!sample_lights) {
+					unsampled_errors[i] = error;
+					continue;
+				}
+
+				//error falls as 1 / sqrt(spp), so matching it without light sampling takes (error ratio)^2 times more samples
+				const auto ratio = unsampled_errors[i] / error;
+				std::cout << " (" << sample_counts[i] * ratio * ratio << " spp unsampled)";
+			}
+			std::cout << ", " << time << " s, mean luminance " << mean_luminance(*frame) << " (reference " << mean_luminance(reference) << ")\n";
+		}
+	}
+
+	//camera rays of the book scene traced one by one and in packets, then whole renders with and without packets
+	void packet_benchmark() {
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		const uint64_t height = 400;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = book_camera(double(width) / height);
+		constexpr auto side = RayPacket::side;
+		constexpr auto infinity = std::numeric_limits<Scalar>::infinity();
+
+		//packets in the order render_packets forms them
+		const SamplePattern pattern{ SamplerType::sobol, height, width, 1 };
+		std::vector<RayPacket> packets;
+		for (uint64_t block_y = 0; block_y < height; block_y += side) {
+			for (uint64_t block_x = 0; block_x < width; block_x += side) {
+				auto& packet = packets.emplace_back();
+				for (uint64_t y = block_y; y < std::min(block_y + side, height); ++y) {
+					for (uint64_t x = block_x; x < std::min(block_x + side, width); ++x) {
+						packet.set(static_cast<uint32_t>((y - block_y) * side + x - block_x), RT.camera_ray(camera, pattern, y, x, 0));
+					}
+				}
+			}
+		}
+
+		std::vector<std::optional<HitRecord>> single_hits(packets.size() * RayPacket::size);
+		const auto single_time = time_seconds([&] {
+			for (size_t p = 0; p < packets.size(); ++p) {
+				for (auto lanes = packets[p].active; lanes; lanes &= lanes - 1) {
+					const auto lane = std::countr_zero(lanes);
+					single_hits[p * RayPacket::size + lane] = RT.scene.intersect(packets[p].ray(lane), 0, infinity);
+				}
+			}
+		});
+
+		std::vector<std::array<std::optional<HitRecord>, RayPacket::size>> packet_hits(packets.size());
+		const auto packet_time = time_seconds([&] {
+			for (size_t p = 0; p < packets.size(); ++p) RT.scene.intersect(packets[p], 0, infinity, packet_hits[p]);
+		});
+
+		bool same_hits = true;
+		for (size_t p = 0; p < packets.size(); ++p) {
+			for (uint32_t lane = 0; lane < RayPacket::size; ++lane) {
+				const auto& a = single_hits[p * RayPacket::size + lane];
+				const auto& b = packet_hits[p][lane];
+				if (a.has_value() != b.has_value() || (a && (a->t != b->t || a->position != b->position || a->material.vector_index != b->material.vector_index))) same_hits = false;
+			}
+		}
+
+		const auto rays = static_cast<double>(height * width);
+		std::cout << "packets " << side << 'x' << side << ", camera rays: single " << rays / single_time / 1e6 << " Mrays/s,"
+			<< " packets " << rays / packet_time / 1e6 << " Mrays/s"
+			<< (same_hits ? ", same hits" : ", HITS DIFFER") << '\n';
+
+		RenderSettings settings;
+		settings.samples_per_pixel = 4;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+
+		for (int depth : { 1, settings.max_depth }) {
+			settings.max_depth = depth;
+			std::optional<Frame> single, packet;
+			settings.packet_primary_rays = false;
+			const auto single_render_time = time_seconds([&] { single = RT.render(camera, height, width, settings, pool); });
+			settings.packet_primary_rays = true;
+			const auto packet_render_time = time_seconds([&] { packet = RT.render(camera, height, width, settings, pool); });
+
+			const auto samples = rays * settings.samples_per_pixel;
+			std::cout << "packets render, max depth " << depth << ": single " << samples / single_render_time / 1e6 << " Msamples/s,"
+				<< " packets " << samples / packet_render_time / 1e6 << " Msamples/s"
+				<< (*single == *packet ? ", same image" : ", IMAGE DIFFERS") << '\n';
+		}
+	}
+
+	//renders the book scene with precision of this build, writes precision_<float|double>.ppm
+	//images of both builds are compared with "RT compare precision_float.ppm precision_double.ppm"
+	void precision_benchmark() {
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		const uint64_t height = 200;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = book_camera(double(width) / height);
+
+		RenderSettings settings;
+		settings.samples_per_pixel = 64;
+		settings.report_progress = false;
+
+		ThreadPool pool{ settings.thread_count };
+		std::optional<Frame> frame;
+		const auto time = time_seconds([&] { frame = RT.render(camera, height, width, settings, pool); });
+
+		constexpr auto name = std::is_same_v<Scalar, float> ? "float" : "double";
+		const auto filename = std::string{ "precision_" } + name + ".ppm";
+		frame->to_ppm(filename.c_str());
+
+		const auto samples = static_cast<double>(height * width * settings.samples_per_pixel);
+		std::cout << "precision " << name << ": " << samples / time / 1e6 << " Msamples/s,"
+			<< " " << sizeof(Sphere) << " bytes per Sphere, " << sizeof(HitRecord) << " bytes per HitRecord,"
+			<< " mean luminance " << mean_luminance(*frame) << ", written to " << filename << '\n';
+	}
+
+	//room rendered by the iterative and wavefront integrators with their counters, build with RT_DISABLE_STATS
+	//and compare samples/s to see what counting costs
+	void stats_benchmark() {
+		DefaultRayTracer RT{};
+		room_scene(RT);
+
+		const uint64_t height = 200;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = room_camera(Scalar(width) / height);
+
+		RenderSettings settings;
+		settings.samples_per_pixel = 16;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+
+		for (const auto integrator : { Integrator::iterative, Integrator::wavefront }) {
+			settings.integrator = integrator;
+			const auto result = RT.render_with_stats(camera, height, width, settings, pool);
+			std::cout << "stats " << (integrator == Integrator::wavefront ? "wavefront" : "iterative") << ": "
+				<< result.stats.samples / result.stats.seconds / 1e6 << " Msamples/s";
+			if constexpr (stats::enabled) {
+				std::cout << ", " << result.stats.rays_per_second() / 1e6 << " Mrays/s, "
+					<< double(result.stats.counters.nodes) / result.stats.rays() << " nodes per ray";
+			}
+			std::cout << '\n';
+			result.stats.write_json(std::cout);
+		}
+	}
+
+	//save and load of a checkpoint of 1200x1800 adaptive render, and adaptive render of the book scene with checkpoint
+	//written after every pass against one without, the difference is what the copy of the state costs the render
+	void checkpoint_benchmark() {
+		constexpr auto filename = "benchmark.checkpoint";
+		{
+			Checkpoint checkpoint{ Checkpoint::Mode::adaptive, 0, 1200, 1800, 1, 0, std::vector<PixelStatistics>(1200 * 1800) };
+			for (auto& pixel : checkpoint.pixels) pixel.add(Color::random());
+
+			bool saved = false;
+			const auto save_time = time_seconds([&] { saved = checkpoint.save(filename); });
+			std::optional<Checkpoint> loaded;
+			const auto load_time = time_seconds([&] { loaded = Checkpoint::load(filename); });
+			const auto size = saved ? std::filesystem::file_size(filename) : 0;
+			std::cout << "checkpoint 1200x1800: " << size / 1e6 << " MB, save " << save_time * 1e3 << " ms, load " << load_time * 1e3 << " ms"
+				<< (loaded && loaded->pixels.size() == checkpoint.pixels.size() ? "" : ", LOAD FAILED") << '\n';
+		}
+
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		book_scene(RT);
+
+		const uint64_t height = 200;
+		const uint64_t width = height * 3 / 2;
+		const auto camera = book_camera(double(width) / height);
+
+		RenderSettings settings;
+		settings.adaptive.enabled = true;
+		settings.samples_per_pixel = 128;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+
+		const auto plain_time = time_seconds([&] { (void)RT.render_adaptive(camera, height, width, settings, pool); });
+		settings.checkpoint.path = filename;
+		settings.checkpoint.interval = 0;
+		const auto checkpoint_time = time_seconds([&] { (void)RT.render_adaptive(camera, height, width, settings, pool); });
+		std::cout << "checkpoint adaptive render: " << plain_time << " s without, " << checkpoint_time << " s with checkpoint after every pass\n";
+		std::filesystem::remove(filename);
+	}
+
+	//forest of 20000 trees of which 20 move: setup of a frame (placing the trees and refitting the BVH) against
+	//rebuilding the scene BVH and building the whole scene, then render time of a frame with and without motion blur
+	void animation_benchmark() {
+		constexpr size_t tree_count = 20000;
+		constexpr size_t moving_count = 20;
+		constexpr uint64_t frame_count = 48;
+
+		DefaultRayTracer RT{};
+		utils::rng.seed();
+		Animation animation;
+		const auto scene_time = time_seconds([&] { animation = forest_animation(RT, tree_count, moving_count, frame_count); });
+		const auto rebuild_time = time_seconds([&] { RT.scene.build(); });
+
+		RenderSettings settings;
+		settings.samples_per_pixel = 1;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+
+		double setup_time = 0;
+		uint64_t rebuilds = 0;
+		render_animation(RT, animation, 2, 2, settings, AnimationSettings{}, pool, [&](const Frame&, const AnimationFrame& frame) {
+			setup_time += frame.setup_seconds;
+			rebuilds += frame.rebuilt;
+		});
+		std::cout << "animation setup: " << setup_time / frame_count * 1e3 << " ms per frame (" << rebuilds << " rebuilds in " << frame_count << " frames), "
+			<< rebuild_time * 1e3 << " ms to rebuild BVH, " << scene_time * 1e3 << " ms to build scene\n";
+
+		settings.samples_per_pixel = 16;
+		animation.frame_count = 1;
+		for (const auto shutter : { 0.0, 0.5 }) {
+			AnimationSettings animation_settings;
+			animation_settings.shutter = shutter;
+			render_animation(RT, animation, 200, 300, settings, animation_settings, pool, [&](const Frame& image, const AnimationFrame& frame) {
+				std::cout << "animation frame with shutter " << shutter << ": " << frame.render_seconds << " s, mean luminance " << mean_luminance(image) << '\n';
+			});
+		}
+	}
+
+	//scene of a million spheres: text compiled into a scene file (parse and build) against loading that file,
+	//compared with reading the bytes of the file, which is what loading cannot go below
+	void scene_file_benchmark() {
+		constexpr size_t sphere_count = 1'000'000;
+		const auto directory = std::filesystem::temp_directory_path();
+		const auto text_path = (directory / "rt_scene_benchmark.txt").string();
+		const auto scene_path = (directory / "rt_scene_benchmark.rtscene").string();
+
+		{
+			std::mt19937 gen{ 42 };
+			std::uniform_real_distribution<double> position{ -100, 100 };
+			std::ofstream text{ text_path };
+			text << "camera 0 0 300 0 0 0 40\nmaterial diffuse lambertian 0.5 0.5 0.5\nmaterial glass dielectric 1.5\n";
+			for (size_t i = 0; i < sphere_count; ++i) {
+				text << "sphere " << position(gen) << ' ' << position(gen) << ' ' << position(gen) << " 0.5 " << (i % 4 ? "diffuse" : "glass") << '\n';
+			}
+		}
+
+		DefaultRayTracer compiled{};
+		std::optional<SceneDescription> description;
+		const auto compile_time = time_seconds([&] { description = read_scene_text(text_path.c_str(), compiled, std::cerr); });
+		if (!description || !save_scene(scene_path.c_str(), compiled, *description)) {
+			std::cerr << "scene_file: cannot compile " << text_path << '\n';
+			return;
+		}
+
+		DefaultRayTracer loaded{};
+		const auto load_time = time_seconds([&] { description = load_scene(scene_path.c_str(), loaded); });
+		if (!description) {
+			std::cerr << "scene_file: cannot load " << scene_path << '\n';
+			return;
+		}
+		std::vector<char> bytes(std::filesystem::file_size(scene_path));
+		const auto read_time = time_seconds([&] { std::ifstream{ scene_path, std::ios::binary }.read(bytes.data(), static_cast<std::streamsize>(bytes.size())); });
+
+		RenderSettings settings;
+		settings.samples_per_pixel = 4;
+		settings.report_progress = false;
+		ThreadPool pool{ settings.thread_count };
+		const auto camera = description->camera.camera(Scalar(1.5));
+		const auto difference = rms_difference(compiled.render(camera, 100, 150, settings, pool), loaded.render(camera, 100, 150, settings, pool));
+
+		std::cout << "scene file " << sphere_count << " spheres: text " << std::filesystem::file_size(text_path) / 1e6 << " MB, parse and build " << compile_time << " s,"
+			<< " scene file " << bytes.size() / 1e6 << " MB, load " << load_time * 1e3 << " ms, read " << read_time * 1e3 << " ms"
+			<< (difference == 0 ? "" : ", IMAGES DIFFER") << '\n';
+
+		std::filesystem::remove(text_path);
+		std::filesystem::remove(scene_path);
+	}
+
+	//eight small jobs on a text scene of 200000 spheres run by one JobRunner, which loads the scene once,
+	//against each job on its own pool and runner, as separate "RT render" processes would run them
+	void batch_benchmark() {
+		constexpr size_t sphere_count = 200'000;
+		constexpr size_t job_count = 8;
+		const auto directory = std::filesystem::temp_directory_path();
+		const auto text_path = (directory / "rt_batch_benchmark.txt").string();
+		const auto image_path = (directory / "rt_batch_benchmark.ppm").string();
+
+		{
+			std::mt19937 gen{ 42 };
+			std::uniform_real_distribution<double> position{ -50, 50 };
+			std::ofstream text{ text_path };
+			text << "camera 0 0 150 0 0 0 40\nmaterial diffuse lambertian 0.5 0.5 0.5\n";
+			for (size_t i = 0; i < sphere_count; ++i) {
+				text << "sphere " << position(gen) << ' ' << position(gen) << ' ' << position(gen) << " 0.5 diffuse\n";
+			}
+		}
+
+		std::vector<RenderJob> jobs(job_count);
+		for (size_t i = 0; i < job_count; ++i) {
+			jobs[i].scene = text_path;
+			jobs[i].output = image_path;
+			jobs[i].width = 60;
+			jobs[i].samples_per_pixel = 4;
+			jobs[i].seed = i;
+		}
+
+		size_t done = 0;
+		const auto batch_time = time_seconds([&] {
+			ThreadPool pool;
+			JobRunner runner{ pool, false };
+			for (const auto& job : jobs) done += runner.run(job, std::cerr).has_value();
+		});
+		const auto separate_time = time_seconds([&] {
+			for (const auto& job : jobs) {
+				ThreadPool pool;
+				JobRunner runner{ pool, false };
+				done += runner.run(job, std::cerr).has_value();
+			}
+		});
+
+		std::cout << "batch " << job_count << " jobs of " << sphere_count << " spheres: one runner " << batch_time << " s, runner per job " << separate_time << " s"
+			<< (done == 2 * job_count ? "" : ", JOBS FAILED") << '\n';
+
+		std::filesystem::remove(text_path);
+		std::filesystem::remove(image_path);
+	}
+
+	struct Benchmark {
+		std::string_view name;
+		void (*run)();
+	};
+
+	constexpr Benchmark benchmarks[] = {
+		{ "bvh", bvh_benchmark },
+		{ "sphere_set", sphere_set_benchmark },
+		{ "threads", thread_scaling_benchmark },
+		{ "rng", rng_benchmark },
+		{ "integrator", integrator_benchmark },
+		{ "adaptive", adaptive_benchmark },
+		{ "precision", precision_benchmark },
+		{ "progressive", progressive_benchmark },
+		{ "frame", frame_benchmark },
+		{ "output", output_benchmark },
+		{ "materials", material_benchmark },
+		{ "wavefront", wavefront_benchmark },
+		{ "packets", packet_benchmark },
+		{ "convergence", convergence_benchmark },
+		{ "mesh", mesh_benchmark },
+		{ "instancing", instancing_benchmark },
+		{ "occlusion", occlusion_benchmark },
+		{ "lights", light_sampling_benchmark },
+		{ "stats", stats_benchmark },
+		{ "checkpoint", checkpoint_benchmark },
+		{ "animation", animation_benchmark },
+		{ "scene_file", scene_file_benchmark },
+		{ "batch", batch_benchmark },
+	};
+}
+
+int run_benchmarks(std::span<char*> names) {
+	int status = 0;
+	if (names.empty()) {
+		for (const auto& b : benchmarks) b.run();
+		return status;
+	}
+
+	for (std::string_view name : names) {
+		const auto it = std::find_if(std::begin(benchmarks), std::end(benchmarks), [&](const Benchmark& b) { return b.name == name; });
+		if (it == std::end(benchmarks)) {
+			std::cerr << "unknown benchmark " << name << '\n';
+			status = 1;
+			continue;
+		}
+		it->run();
+	}
+	return status;
+}
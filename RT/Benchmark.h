@@ -0,0 +1,11 @@
+#pragma once
+
+#include <span>
+
+//runs benchmarks with given names, all of them if none are given
+int run_benchmarks(std::span<char*> names);
+
+//canonical scenes and microbenchmarks, results are written to json file (args[0], suite.json by default)
+//and compared with baseline file args[1] if given, returns 1 if any is worse by more than tolerance args[2]
+//(fraction in [0, 1), 0.1 by default), returns 2 if the tolerance is not valid
+int run_suite(std::span<char*> args);
@@ -0,0 +1,397 @@
+#include "Benchmark.h"
+#include "Scenes.h"
+#include "Stats.h"
+#include "Materials.h"
+#include "Sampler.h"
+#include "Sphere.h"
+#include "ThreadPool.h"
+#include "utils.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//Suite of canonical scenes and microbenchmarks whose results are written to json under fixed names,
+//so that results of two commits (built the same way, run on the same machine) can be compared.
+//Scenes are fixed by their seeds and render settings, so every run traces the same rays.
+namespace {
+	enum class Better { higher, lower, none };
+
+	struct Result {
+		std::string name;
+		double value;
+		std::string unit;
+		Better better;
+	};
+
+	constexpr const char* better_names[] = { "higher", "lower", "none" };
+
+	class Results {
+		std::vector<Result> results_;
+
+	public:
+		void add(std::string name, double value, std::string unit, Better better) {
+			std::cout << std::left << std::setw(40) << name << ' ' << value << ' ' << unit << '\n';
+			results_.push_back({ std::move(name), value, std::move(unit), better });
+		}
+
+		[[nodiscard]]
+		const std::vector<Result>& results() const noexcept {
+			return results_;
+		}
+
+		bool write_json(const char* filename) const {
+			std::ofstream file{ filename };
+			if (!file) return false;
+
+			file << std::setprecision(9);
+			file << "{\n";
+			file << "  \"precision\": \"" << (std::is_same_v<Scalar, float> ? "float" : "double") << "\",\n";
+			file << "  \"instrumented\": " << (stats::enabled ? "true" : "false") << ",\n";
+			file << "  \"threads\": " << std::thread::hardware_concurrency() << ",\n";
+			file << "  \"results\": [\n";
+			for (size_t i = 0; i < results_.size(); ++i) {
+				const auto& r = results_[i];
+				file << "    { \"name\": \"" << r.name << "\", \"value\": " << r.value << ", \"unit\": \"" << r.unit
+					<< "\", \"better\": \"" << better_names[size_t(r.better)] << "\" }" << (i + 1 < results_.size() ? "," : "") << '\n';
+			}
+			file << "  ]\n";
+			file << "}\n";
+			return static_cast<bool>(file);
+		}
+
+		//results of a file written by write_json, one per line, empty if the file cannot be read
+		[[nodiscard]]
+		static std::optional<std::vector<Result>> read_json(const char* filename) {
+			std::ifstream file{ filename };
+			if (!file) return {};
+
+			auto field = [](std::string_view line, std::string_view key) -> std::optional<std::string_view> {
+				const auto start = line.find(key);
+				if (start == std::string_view::npos) return {};
+				return line.substr(start + key.size());
+			};
+			auto quoted = [](std::string_view value) {
+				return std::string{ value.substr(0, value.find('"')) };
+			};
+
+			std::vector<Result> results;
+			std::string line;
+			while (std::getline(file, line)) {
+				const auto name = field(line, "\"name\": \"");
+				const auto value = field(line, "\"value\": ");
+				const auto unit = field(line, "\"unit\": \"");
+				const auto better = field(line, "\"better\": \"");
+				if (!name || !value || !unit || !better) continue;
+
+				Result r{ quoted(*name), std::strtod(std::string{ *value }.c_str(), nullptr), quoted(*unit), Better::none };
+				const auto b = quoted(*better);
+				if (b == better_names[size_t(Better::higher)]) r.better = Better::higher;
+				else if (b == better_names[size_t(Better::lower)]) r.better = Better::lower;
+				results.push_back(std::move(r));
+			}
+			return results;
+		}
+	};
+
+	//largest resident memory of the process so far, 0 if it cannot be found
+	[[nodiscard]]
+	uint64_t peak_memory() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+		return counters.PeakWorkingSetSize;
+#else
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+		return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+		return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+	}
+
+	//fastest of repeated runs, the least disturbed by the rest of the machine
+	template <typename F>
+	double best_seconds(int repeats, F&& f) {
+		auto best = std::numeric_limits<double>::infinity();
+		for (int i = 0; i < repeats; ++i) {
+			const auto start = std::chrono::steady_clock::now();
+			f();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	constexpr int repeats = 5;
+	constexpr int scene_repeats = 3; //of fixed renders and of renders to target error
+
+	//results of loops are added here, so that the compiler cannot drop them
+	volatile double sink = 0;
+
+	[[nodiscard]]
+	double mean_luminance(const Frame& frame) {
+		double sum = 0;
+		for (uint64_t y = 0; y < frame.height(); ++y) {
+			for (uint64_t x = 0; x < frame.width(); ++x) {
+				sum += luminance(frame.pixel(y, x));
+			}
+		}
+		return sum / (frame.height() * frame.width());
+	}
+
+	struct SceneSettings {
+		uint64_t height = 120;
+		uint64_t width = 180;
+		int samples_per_pixel = 16;
+		double target_error = 0.02; //standard error estimated by adaptive sampling, see AdaptiveSettings::threshold
+		int max_samples = 256;      //per pixel while reaching target_error
+	};
+
+	//throughput of a fixed render, time adaptive sampling takes to bring every pixel under target error, and peak memory
+	void scene_benchmark(Results& results, const std::string& name, const DefaultRayTracer& RT, const Camera& camera, const SceneSettings& scene_settings, ThreadPool& pool) {
+		RenderSettings settings;
+		settings.samples_per_pixel = scene_settings.samples_per_pixel;
+		settings.report_progress = false;
+
+		auto render = RT.render_with_stats(camera, scene_settings.height, scene_settings.width, settings, pool);
+		for (int i = 1; i < scene_repeats; ++i) {
+			auto again = RT.render_with_stats(camera, scene_settings.height, scene_settings.width, settings, pool);
+			if (again.stats.seconds < render.stats.seconds) render = std::move(again);
+		}
+		results.add(name + ".samples_per_second", render.stats.samples / render.stats.seconds, "samples/s", Better::higher);
+		if constexpr (stats::enabled) {
+			results.add(name + ".rays_per_second", render.stats.rays_per_second(), "rays/s", Better::higher);
+		}
+		results.add(name + ".mean_luminance", mean_luminance(render.image), "", Better::none);
+
+		settings.samples_per_pixel = scene_settings.max_samples;
+		settings.adaptive.enabled = true;
+		settings.adaptive.threshold = scene_settings.target_error;
+		//median of runs, so that one disturbed run moves neither the result nor the gate
+		std::array<double, scene_repeats> seconds{};
+		uint64_t samples = 0;
+		for (auto& s : seconds) {
+			const auto adaptive = RT.render_with_stats(camera, scene_settings.height, scene_settings.width, settings, pool);
+			s = adaptive.stats.seconds;
+			samples = adaptive.stats.samples;
+		}
+		std::ranges::nth_element(seconds, seconds.begin() + scene_repeats / 2);
+		results.add(name + ".time_to_error", seconds[scene_repeats / 2], "s", Better::lower);
+		results.add(name + ".samples_to_error", double(samples), "samples", Better::none);
+
+		results.add(name + ".peak_memory", double(peak_memory()), "bytes", Better::lower);
+	}
+
+	void vec3_benchmark(Results& results) {
+		std::mt19937 gen{ 1 };
+		std::uniform_real_distribution<Scalar> unit{ -1, 1 };
+		const size_t count = 1'000'000;
+		std::vector<Vec3> a(count), b(count);
+		for (size_t i = 0; i < count; ++i) {
+			a[i] = { unit(gen), unit(gen), unit(gen) };
+			b[i] = { unit(gen), unit(gen), unit(gen) };
+		}
+
+		const auto dot = best_seconds(repeats, [&] {
+			Scalar sum = 0;
+			for (size_t i = 0; i < count; ++i) sum += a[i].dot(b[i]);
+			sink = sink + sum;
+		});
+		const auto cross = best_seconds(repeats, [&] {
+			Vec3 sum{};
+			for (size_t i = 0; i < count; ++i) sum += a[i].cross(b[i]);
+			sink = sink + sum.x();
+		});
+		const auto unit_vector = best_seconds(repeats, [&] {
+			Vec3 sum{};
+			for (size_t i = 0; i < count; ++i) sum += a[i].unit();
+			sink = sink + sum.x();
+		});
+
+		results.add("vec3.dot", dot / count * 1e9, "ns", Better::lower);
+		results.add("vec3.cross", cross / count * 1e9, "ns", Better::lower);
+		results.add("vec3.unit", unit_vector / count * 1e9, "ns", Better::lower);
+	}
+
+	void sphere_benchmark(Results& results) {
+		std::mt19937 gen{ 2 };
+		std::uniform_real_distribution<Scalar> unit{ -1, 1 };
+		const Sphere sphere{ Position{ 0, 0, 0 }, 1, MaterialIndex{ 0, 0 } };
+
+		//about half of the rays hit
+		const size_t count = 1'000'000;
+		std::vector<Ray> rays;
+		for (size_t i = 0; i < count; ++i) {
+			const auto origin = Position{ unit(gen), unit(gen), unit(gen) } * 4;
+			rays.emplace_back(origin, Position{ unit(gen), unit(gen), unit(gen) } * Scalar(1.4) - origin);
+		}
+
+		const auto time = best_seconds(repeats, [&] {
+			double sum = 0;
+			for (const auto& ray : rays) {
+				if (const auto hit = sphere.intersect(ray, 0, std::numeric_limits<Scalar>::infinity()); hit) sum += hit->t;
+			}
+			sink = sink + sum;
+		});
+		results.add("sphere.intersect", count / time, "rays/s", Better::higher);
+	}
+
+	template <Material M>
+	void scatter_benchmark(Results& results, const char* name, const M& material) {
+		std::mt19937 gen{ 3 };
+		std::uniform_real_distribution<Scalar> unit{ -1, 1 };
+
+		const size_t count = 200'000;
+		std::vector<Ray> rays;
+		std::vector<HitRecord> hits;
+		for (size_t i = 0; i < count; ++i) {
+			const auto normal = Direction{ unit(gen), unit(gen), unit(gen) }.unit();
+			const auto direction = Direction{ unit(gen), unit(gen), unit(gen) };
+			rays.emplace_back(Position{ 0, 0, 0 }, direction);
+
+			HitRecord hit;
+			hit.position = direction;
+			hit.t = 1;
+			hit.set_face_normal(direction, normal);
+			hits.push_back(hit);
+		}
+
+		const auto time = best_seconds(repeats, [&] {
+			double sum = 0;
+			for (size_t i = 0; i < count; ++i) {
+				utils::sampler.start_sample(SamplePattern{}, i, 0);
+				if (const auto res = material.scatter(rays[i], hits[i]); res) sum += res->attenuation.x() + res->scattered.direction().x();
+			}
+			sink = sink + sum;
+		});
+		results.add(std::string{ "scatter." } + name, count / time, "scatters/s", Better::higher);
+	}
+
+	void ppm_benchmark(Results& results) {
+		const uint64_t height = 1080, width = 1920;
+		Frame frame{ height, width };
+		for (uint64_t y = 0; y < height; ++y) {
+			for (uint64_t x = 0; x < width; ++x) {
+				frame.set_pixel(y, x, Color{ Scalar(x) / width, Scalar(y) / height, Scalar(0.5) });
+			}
+		}
+
+		const auto path = (std::filesystem::temp_directory_path() / "rt_suite.ppm").string();
+		bool written = true;
+		const auto time = best_seconds(repeats, [&] { written &= frame.to_ppm(path.c_str()); });
+		std::filesystem::remove(path);
+
+		if (!written) {
+			std::cerr << "suite: cannot write " << path << '\n';
+			return;
+		}
+		results.add("frame.to_ppm", height * width / time, "pixels/s", Better::higher);
+	}
+
+	//prints every result also found in the baseline, returns false if any of them is worse by more than tolerance
+	bool compare(const std::vector<Result>& results, const std::vector<Result>& baseline, double tolerance) {
+		bool passed = true;
+		for (const auto& r : results) {
+			const auto it = std::find_if(baseline.begin(), baseline.end(), [&](const Result& b) { return b.name == r.name; });
+			if (it == baseline.end() || r.better == Better::none || !(it->value > 0) || !(r.value > 0)) continue;
+
+			//above 1 is better
+			const auto ratio = r.better == Better::higher ? r.value / it->value : it->value / r.value;
+			const bool regressed = ratio < 1 - tolerance;
+			passed &= !regressed;
+
+			std::cout << std::left << std::setw(40) << r.name << ' ' << std::showpos << std::fixed << std::setprecision(1)
+				<< (ratio - 1) * 100 << '%' << std::noshowpos << std::defaultfloat << std::setprecision(6)
+				<< (regressed ? " REGRESSION" : "") << '\n';
+		}
+		return passed;
+	}
+}
+
+int run_suite(std::span<char*> args) {
+	const char* output = args.size() > 0 ? args[0] : "suite.json";
+	const char* baseline_file = args.size() > 1 ? args[1] : nullptr;
+	double tolerance = 0.1;
+	if (args.size() > 2 && (!utils::parse_number(args[2], tolerance) || !(tolerance >= 0 && tolerance < 1))) {
+		std::cerr << "usage: RT suite [json] [baseline] [tolerance], tolerance is a fraction from 0 to below 1 (0.1 for 10%)\n";
+		return 2;
+	}
+
+	std::optional<std::vector<Result>> baseline;
+	if (baseline_file) {
+		baseline = Results::read_json(baseline_file);
+		if (!baseline) {
+			std::cerr << "cannot read " << baseline_file << '\n';
+			return 2;
+		}
+	}
+
+	Results results;
+
+	//scenes go from the smallest and before microbenchmarks, as peak memory only grows
+	ThreadPool pool;
+	const SceneSettings scene_settings;
+	const auto aspect_ratio = Scalar(scene_settings.width) / scene_settings.height;
+	{
+		DefaultRayTracer RT{};
+		book_scene(RT);
+		scene_benchmark(results, "book", RT, book_camera(aspect_ratio), scene_settings, pool);
+	}
+	{
+		DefaultRayTracer RT{};
+		glass_scene(RT);
+		scene_benchmark(results, "glass", RT, glass_camera(aspect_ratio), scene_settings, pool);
+	}
+	{
+		DefaultRayTracer RT{};
+		tessellated_scene(RT, 128, 256);
+		scene_benchmark(results, "mesh", RT, tessellated_camera(aspect_ratio), scene_settings, pool);
+	}
+	{
+		constexpr size_t sphere_count = 100'000;
+		DefaultRayTracer RT{};
+		sphere_grid_scene(RT, sphere_count);
+		scene_benchmark(results, "sphere_grid", RT, sphere_grid_camera(sphere_count, aspect_ratio), scene_settings, pool);
+	}
+
+	vec3_benchmark(results);
+	sphere_benchmark(results);
+	scatter_benchmark(results, "lambertian", Lambertian{ Color{ 0.5, 0.5, 0.5 } });
+	scatter_benchmark(results, "metal", Metal{ Color{ 0.8, 0.8, 0.8 }, 0.3 });
+	scatter_benchmark(results, "dielectric", Dielectric{ 1.5 });
+	scatter_benchmark(results, "diffuse_light", DiffuseLight{ Color{ 4, 4, 4 } });
+	ppm_benchmark(results);
+
+	if (!results.write_json(output)) {
+		std::cerr << "cannot write " << output << '\n';
+		return 2;
+	}
+
+	if (!baseline) return 0;
+	std::cout << "compared to " << baseline_file << ", tolerance " << tolerance * 100 << "%:\n";
+	return compare(results.results(), *baseline, tolerance) ? 0 : 1;
+}
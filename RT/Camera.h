@@ -4,36 +4,42 @@
 #include "Ray.h"
 #include "Sphere.h"
 #include "Scene.h"
+#include "Warp.h"
 
 #include <numbers>
 #include <cmath>
 
-class Camera {
-	Position origin_;
-	Position lower_left_;
-	Direction horizontal_;
-	Direction vertical_;
-	Direction u_, v_, w_;
-	double lens_radius_;
+template <std::floating_point T>
+class BasicCamera {
+	using Vec3 = BasicVec3<T>;
+
+	Vec3 origin_;
+	Vec3 lower_left_;
+	Vec3 horizontal_;
+	Vec3 vertical_;
+	Vec3 u_, v_, w_;
+	T lens_radius_;
+	T shutter_open_ = 0;
+	T shutter_close_ = 0;
 	
 	[[nodiscard]] constexpr
-	static double degrees_to_radians(double degrees) noexcept {
-		return degrees / 180.0 * std::numbers::pi_v<double>;
+	static T degrees_to_radians(T degrees) noexcept {
+		return degrees / 180 * std::numbers::pi_v<T>;
 	}
 
 public:
-	Camera(
+	BasicCamera(
 		Vec3 lookfrom,
 		Vec3 lookat,
 		Vec3 vup,
-		double vfov,
-		double aspect_ratio,
-		double aperture,
-		double focus_dist
+		T vfov,
+		T aspect_ratio,
+		T aperture,
+		T focus_dist
 	) {
 		const auto theta = degrees_to_radians(vfov);
 		const auto h = std::tan(theta / 2);
-		const auto viewport_height = 2.0 * h;
+		const auto viewport_height = 2 * h;
 		const auto viewport_width = aspect_ratio * viewport_height;
 		
 		w_ = (lookfrom - lookat).unit();
@@ -48,13 +54,25 @@ public:
 		lens_radius_ = aperture / 2;
 	}
 
-	Ray get_ray(double h, double v) const {
-		Vec3 rd = lens_radius_ * Vec3::random_in_unit_disk();
+	//rays get times uniformly distributed in [open, close] of the frame's shutter interval [0, 1]
+	//moving objects then show motion blur, with open == close (the default) the frame is taken at that instant
+	void set_shutter(T open, T close) noexcept {
+		shutter_open_ = open;
+		shutter_close_ = close;
+	}
+
+	//time is sampled after the lens and only with open shutter, so still frames use the same sample dimensions as before
+	BasicRay<T> get_ray(T h, T v) const {
+		Vec3 rd = lens_radius_ * warp::random_in_unit_disk();
 		Vec3 offset = u_ * rd.x() + v_ * rd.y();
-		return Ray{
+		auto time = shutter_open_;
+		if (shutter_close_ != shutter_open_) time += static_cast<T>(utils::sampler.get_1d()) * (shutter_close_ - shutter_open_);
+		return BasicRay<T>{
 			origin_ + offset,
-			lower_left_ + h * horizontal_ + v * vertical_ - origin_ - offset
+			lower_left_ + h * horizontal_ + v * vertical_ - origin_ - offset,
+			time
 		};
 	}
 };
 
+using Camera = BasicCamera<Scalar>;
@@ -0,0 +1,158 @@
+#include "Checkpoint.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+namespace {
+	constexpr char checkpoint_magic[8] = { 'R', 'T', 'C', 'K', 'P', 'T', '\0', '\0' };
+	constexpr uint32_t checkpoint_version = 1;
+	constexpr uint32_t byte_order_mark = 0x01020304;
+
+	struct CheckpointFileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;        //byte_order_mark as written, tells files of other byte order apart
+		uint32_t scalar_size;       //sums are stored as Scalar, so precision of the build has to match
+		uint32_t mode;
+		uint64_t key;
+		uint64_t height;
+		uint64_t width;
+		uint64_t passes;
+		uint64_t total_samples;
+	};
+
+	//sum, luminance sums and sample count of a pixel without padding
+	constexpr size_t pixel_size = 3 * sizeof(Scalar) + 2 * sizeof(double) + sizeof(uint32_t);
+}
+
+bool Checkpoint::save(const char* filename) const {
+	const auto temporary = std::string{ filename } + ".tmp";
+	{
+		std::ofstream out{ temporary, std::ios::binary };
+		if (!out) return false;
+
+		CheckpointFileHeader header{};
+		std::memcpy(header.magic, checkpoint_magic, sizeof(checkpoint_magic));
+		header.version = checkpoint_version;
+		header.byte_order = byte_order_mark;
+		header.scalar_size = sizeof(Scalar);
+		header.mode = static_cast<uint32_t>(mode);
+		header.key = key;
+		header.height = height;
+		header.width = width;
+		header.passes = passes;
+		header.total_samples = total_samples;
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		std::vector<char> bytes(pixels.size() * pixel_size);
+		auto* p = bytes.data();
+		auto put = [&](const auto& value) {
+			std::memcpy(p, &value, sizeof(value));
+			p += sizeof(value);
+		};
+		for (const auto& pixel : pixels) {
+			put(pixel.sum.data);
+			put(pixel.luminance_sum);
+			put(pixel.luminance_squared_sum);
+			put(pixel.samples);
+		}
+		out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+		if (!out) return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, filename, error);
+	return !error;
+}
+
+std::optional<Checkpoint> Checkpoint::load(const char* filename) {
+	std::ifstream in{ filename, std::ios::binary };
+	if (!in) return {};
+
+	CheckpointFileHeader header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return {};
+	if (std::memcmp(header.magic, checkpoint_magic, sizeof(checkpoint_magic)) != 0
+		|| header.version != checkpoint_version
+		|| header.byte_order != byte_order_mark
+		|| header.scalar_size != sizeof(Scalar)
+		|| header.mode > static_cast<uint32_t>(Mode::progressive)
+		|| (header.width != 0 && header.height > UINT64_MAX / header.width / pixel_size)) {
+		return {};
+	}
+
+	const auto pixel_count = header.height * header.width;
+	std::error_code error;
+	const auto file_size = std::filesystem::file_size(filename, error);
+	if (error || file_size != sizeof(header) + pixel_count * pixel_size) return {};
+
+	std::vector<char> bytes(pixel_count * pixel_size);
+	if (!in.read(bytes.data(), static_cast<std::streamsize>(bytes.size()))) return {};
+
+	Checkpoint checkpoint;
+	checkpoint.mode = static_cast<Mode>(header.mode);
+	checkpoint.key = header.key;
+	checkpoint.height = header.height;
+	checkpoint.width = header.width;
+	checkpoint.passes = header.passes;
+	checkpoint.total_samples = header.total_samples;
+	checkpoint.pixels.resize(pixel_count);
+
+	const auto* p = bytes.data();
+	auto get = [&](auto& value) {
+		std::memcpy(&value, p, sizeof(value));
+		p += sizeof(value);
+	};
+	for (auto& pixel : checkpoint.pixels) {
+		get(pixel.sum.data);
+		get(pixel.luminance_sum);
+		get(pixel.luminance_squared_sum);
+		get(pixel.samples);
+	}
+	return checkpoint;
+}
+
+CheckpointWriter::CheckpointWriter(std::string path, double interval)
+	: path_{ std::move(path) }, interval_{ interval } {
+	thread_ = std::thread{ [this] {
+		std::unique_lock lock{ mutex_ };
+		while (true) {
+			pending_condition_.wait(lock, [&] { return pending_ || stopping_; });
+			if (!pending_) return;
+
+			auto checkpoint = std::move(*pending_);
+			pending_.reset();
+			lock.unlock();
+			const bool saved = checkpoint.save(path_.c_str());
+			if (!saved) std::cerr << "cannot write checkpoint " << path_ << '\n';
+			lock.lock();
+			failed_ |= !saved;
+		}
+	} };
+}
+
+CheckpointWriter::~CheckpointWriter() {
+	{
+		std::scoped_lock lock{ mutex_ };
+		stopping_ = true;
+	}
+	pending_condition_.notify_one();
+	thread_.join();
+}
+
+void CheckpointWriter::write(Checkpoint checkpoint) {
+	{
+		std::scoped_lock lock{ mutex_ };
+		pending_ = std::move(checkpoint);
+	}
+	pending_condition_.notify_one();
+	last_ = clock::now();
+}
+
+bool CheckpointWriter::ok() {
+	std::scoped_lock lock{ mutex_ };
+	return !failed_;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "PixelStatistics.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Accumulation state of a render between two passes. Random streams are keyed by pixel and sample index,
+//so sample counts are all that is needed to continue them - a render resumed from a checkpoint takes
+//the same samples it would have taken without interruption and gives the same image.
+struct Checkpoint {
+	enum class Mode : uint32_t { adaptive, progressive };
+
+	Mode mode = Mode::adaptive;
+	uint64_t key = 0;           //of scene independent render settings, see RayTracer::checkpoint_key
+	uint64_t height = 0;
+	uint64_t width = 0;
+	uint64_t passes = 0;        //completed, adaptive counts the first min_samples for all pixels as pass 0
+	uint64_t total_samples = 0;
+	std::vector<PixelStatistics> pixels;
+
+	//file with sums of pixels packed without padding, written to a temporary file renamed over filename
+	//when complete, so that the file is never seen half written
+	bool save(const char* filename) const;
+
+	//empty if the file cannot be read, is not a checkpoint or was written by a build of other precision
+	[[nodiscard]]
+	static std::optional<Checkpoint> load(const char* filename);
+};
+
+//Saves checkpoints on its own thread, so that rendering only waits for the copy of the state.
+//A checkpoint which comes while the previous one is being saved is saved next, replacing any older one still waiting.
+class CheckpointWriter {
+	using clock = std::chrono::steady_clock;
+
+	std::string path_;
+	std::chrono::duration<double> interval_;
+	clock::time_point last_ = clock::now();
+
+	std::mutex mutex_;
+	std::condition_variable pending_condition_;
+	std::optional<Checkpoint> pending_;
+	bool stopping_ = false;
+	bool failed_ = false;
+	std::thread thread_;
+
+public:
+	//interval in seconds between checkpoints taken when due
+	CheckpointWriter(std::string path, double interval);
+	CheckpointWriter(const CheckpointWriter&) = delete;
+	CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+	//saves the checkpoint still waiting
+	~CheckpointWriter();
+
+	//interval has passed since the last checkpoint
+	[[nodiscard]]
+	bool due() const noexcept {
+		return clock::now() - last_ >= interval_;
+	}
+
+	void write(Checkpoint checkpoint);
+
+	//false once any checkpoint could not be saved
+	[[nodiscard]]
+	bool ok();
+};
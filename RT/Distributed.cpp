@@ -0,0 +1,305 @@
+#include "Distributed.h"
+#include "Scenes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+	//Messages are a header followed by size bytes of body. Both sides are builds of the same code (checked by Hello),
+	//so bodies are structs sent as they are in memory, all fields have fixed size and natural alignment.
+	constexpr char protocol_magic[8] = { 'R', 'T', 'D', 'I', 'S', 'T', '\0', '\0' };
+	constexpr uint32_t protocol_version = 1;
+	constexpr uint32_t byte_order_mark = 0x01020304;
+
+	enum class MessageType : uint32_t { hello, job, task, result, done };
+
+	struct MessageHeader {
+		uint32_t type;
+		uint32_t reserved;
+		uint64_t size;
+	};
+
+	//worker to coordinator, first message
+	struct Hello {
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint32_t scalar_size;       //sums are sent as Scalar, so precision of the builds has to match
+		uint32_t reserved;
+	};
+
+	//coordinator to worker, answer to Hello
+	struct JobMessage {
+		char scene[64];
+		uint64_t height;
+		uint64_t width;
+		uint64_t seed;
+		int32_t samples_per_pixel;
+		int32_t max_depth;
+		int32_t russian_roulette_depth;
+		uint32_t integrator;
+		uint32_t sampler;
+		uint32_t sample_lights;
+		uint32_t reserved[2];
+	};
+
+	//coordinator to worker, and back in front of the sums of result
+	struct TaskMessage {
+		uint64_t id;
+		uint64_t y;
+		uint64_t x;
+		uint64_t height;
+		uint64_t width;
+		int32_t first;              //samples [first, last) of every pixel of the tile
+		int32_t last;
+	};
+
+	static_assert(sizeof(Color) == 3 * sizeof(Scalar), "sums are sent as an array of Colors");
+
+	//worker waits for the coordinator to start listening that long
+	constexpr auto connect_wait = std::chrono::seconds{ 10 };
+
+	bool send_message(Socket& socket, MessageType type, const void* body, size_t size, const void* extra = nullptr, size_t extra_size = 0) {
+		const MessageHeader header{ static_cast<uint32_t>(type), 0, size + extra_size };
+		return socket.send_all(&header, sizeof(header)) && socket.send_all(body, size) && (extra_size == 0 || socket.send_all(extra, extra_size));
+	}
+
+	template <typename T>
+	bool receive_body(Socket& socket, const MessageHeader& header, T& body) {
+		return header.size >= sizeof(T) && socket.receive_all(&body, sizeof(T));
+	}
+
+	[[nodiscard]]
+	Hello make_hello() noexcept {
+		Hello hello{};
+		std::memcpy(hello.magic, protocol_magic, sizeof(protocol_magic));
+		hello.version = protocol_version;
+		hello.byte_order = byte_order_mark;
+		hello.scalar_size = sizeof(Scalar);
+		return hello;
+	}
+
+	[[nodiscard]]
+	bool compatible(const Hello& hello) noexcept {
+		return std::memcmp(hello.magic, protocol_magic, sizeof(protocol_magic)) == 0 && hello.version == protocol_version
+			&& hello.byte_order == byte_order_mark && hello.scalar_size == sizeof(Scalar);
+	}
+
+	struct Task {
+		Tile tile;
+		int first = 0;
+		int last = 0;
+		int attempts = 0;
+	};
+
+	[[nodiscard]]
+	std::vector<Task> split_tasks(const DistributedJob& job, const DistributedSettings& settings) {
+		const auto tile_size = std::max<uint64_t>(settings.tile_size, 1);
+		const auto samples = std::max(job.settings.samples_per_pixel, 1);
+		const auto ranges = std::clamp(settings.sample_ranges, 1, samples);
+
+		std::vector<Task> tasks;
+		for (uint64_t y = 0; y < job.height; y += tile_size) {
+			for (uint64_t x = 0; x < job.width; x += tile_size) {
+				const Tile tile{ y, x, std::min(tile_size, job.height - y), std::min(tile_size, job.width - x) };
+				for (int range = 0; range < ranges; ++range) {
+					tasks.push_back({ tile, samples * range / ranges, samples * (range + 1) / ranges });
+				}
+			}
+		}
+		return tasks;
+	}
+}
+
+std::optional<DistributedRender> render_distributed(Listener& listener, const DistributedJob& job, const DistributedSettings& settings) {
+	using clock = std::chrono::steady_clock;
+
+	JobMessage job_message{};
+	if (job.scene.size() >= sizeof(job_message.scene)) return {};
+	std::memcpy(job_message.scene, job.scene.data(), job.scene.size());
+	job_message.height = job.height;
+	job_message.width = job.width;
+	job_message.seed = job.settings.seed;
+	job_message.samples_per_pixel = std::max(job.settings.samples_per_pixel, 1);
+	job_message.max_depth = job.settings.max_depth;
+	job_message.russian_roulette_depth = job.settings.russian_roulette_depth;
+	job_message.integrator = static_cast<uint32_t>(job.settings.integrator);
+	job_message.sampler = static_cast<uint32_t>(job.settings.sampler);
+	job_message.sample_lights = job.settings.sample_lights;
+
+	auto tasks = split_tasks(job, settings);
+	std::vector<Color> sums(job.height * job.width);
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<size_t> pending(tasks.size());
+	std::iota(pending.begin(), pending.end(), size_t{ 0 });
+	size_t finished = 0;
+	size_t connected = 0;
+	size_t workers = 0;
+	uint64_t retried = 0;
+	bool failed = false;
+
+	ProgressReporter progress{ "tasks", tasks.size(), settings.report_progress };
+
+	//one thread per worker, which waits for its results, so a slow worker holds up only its own task
+	auto serve = [&](Socket socket) {
+		socket.set_timeout(settings.task_timeout);
+
+		MessageHeader header;
+		Hello hello;
+		if (!socket.receive_all(&header, sizeof(header)) || header.type != uint32_t(MessageType::hello)
+			|| !receive_body(socket, header, hello) || !compatible(hello)) {
+			return;
+		}
+		if (!send_message(socket, MessageType::job, &job_message, sizeof(job_message))) return;
+
+		{
+			std::scoped_lock lock{ mutex };
+			++connected;
+			++workers;
+		}
+
+		std::vector<Color> tile_sums;
+		while (true) {
+			size_t index;
+			{
+				std::unique_lock lock{ mutex };
+				changed.wait(lock, [&] { return !pending.empty() || finished == tasks.size() || failed; });
+				if (pending.empty() || failed) break;
+				index = pending.front();
+				pending.pop_front();
+			}
+
+			const auto& task = tasks[index];
+			const TaskMessage message{ index, task.tile.y, task.tile.x, task.tile.height, task.tile.width, task.first, task.last };
+			const auto pixel_count = task.tile.height * task.tile.width;
+			tile_sums.resize(pixel_count);
+
+			TaskMessage answer;
+			const bool done = send_message(socket, MessageType::task, &message, sizeof(message))
+				&& socket.receive_all(&header, sizeof(header)) && header.type == uint32_t(MessageType::result)
+				&& header.size == sizeof(TaskMessage) + pixel_count * sizeof(Color)
+				&& receive_body(socket, header, answer) && answer.id == index
+				&& socket.receive_all(tile_sums.data(), pixel_count * sizeof(Color));
+
+			std::scoped_lock lock{ mutex };
+			if (!done) {
+				if (++tasks[index].attempts >= settings.max_attempts) failed = true;
+				else {
+					pending.push_front(index);
+					++retried;
+				}
+				--connected;
+				changed.notify_all();
+				return;
+			}
+
+			for (uint64_t y = 0; y < task.tile.height; ++y) {
+				for (uint64_t x = 0; x < task.tile.width; ++x) {
+					sums[(task.tile.y + y) * job.width + task.tile.x + x] += tile_sums[y * task.tile.width + x];
+				}
+			}
+			++finished;
+			progress.advance();
+			changed.notify_all();
+		}
+
+		send_message(socket, MessageType::done, nullptr, 0);
+		std::scoped_lock lock{ mutex };
+		--connected;
+	};
+
+	std::vector<std::thread> threads;
+	auto last_connected = clock::now();
+	while (true) {
+		{
+			std::scoped_lock lock{ mutex };
+			if (finished == tasks.size() || failed) break;
+			if (connected > 0) last_connected = clock::now();
+			else if (clock::now() - last_connected > std::chrono::duration<double>{ settings.worker_wait }) {
+				failed = true;
+				changed.notify_all();
+				break;
+			}
+		}
+		if (auto socket = listener.accept(0.1)) threads.emplace_back(serve, std::move(*socket));
+	}
+	for (auto& thread : threads) thread.join();
+
+	if (failed) return {};
+
+	DistributedRender result{ Frame{ job.height, job.width, job.settings.pixel_format }, workers, retried };
+	for (uint64_t y = 0; y < job.height; ++y) {
+		for (uint64_t x = 0; x < job.width; ++x) {
+			result.image.set_pixel(y, x, sums[y * job.width + x] / job_message.samples_per_pixel);
+		}
+	}
+	return result;
+}
+
+bool run_worker(const char* host, uint16_t port, size_t thread_count) {
+	std::optional<Socket> socket;
+	for (const auto start = std::chrono::steady_clock::now(); !socket; std::this_thread::sleep_for(std::chrono::milliseconds{ 200 })) {
+		socket = Socket::connect(host, port);
+		if (!socket && std::chrono::steady_clock::now() - start > connect_wait) {
+			std::cerr << "cannot connect to " << host << ':' << port << '\n';
+			return false;
+		}
+	}
+
+	const auto hello = make_hello();
+	MessageHeader header;
+	JobMessage job;
+	if (!send_message(*socket, MessageType::hello, &hello, sizeof(hello))
+		|| !socket->receive_all(&header, sizeof(header)) || header.type != uint32_t(MessageType::job)
+		|| !receive_body(*socket, header, job)) {
+		std::cerr << "coordinator did not send a job\n";
+		return false;
+	}
+
+	job.scene[sizeof(job.scene) - 1] = '\0';
+	DefaultRayTracer RT{};
+	const auto camera = named_scene(RT, job.scene, Scalar(job.width) / job.height);
+	if (!camera) {
+		std::cerr << "unknown scene " << job.scene << '\n';
+		return false;
+	}
+
+	RenderSettings settings;
+	settings.samples_per_pixel = job.samples_per_pixel;
+	settings.max_depth = job.max_depth;
+	settings.russian_roulette_depth = job.russian_roulette_depth;
+	settings.integrator = static_cast<Integrator>(job.integrator);
+	settings.sampler = static_cast<SamplerType>(job.sampler);
+	settings.seed = job.seed;
+	settings.sample_lights = job.sample_lights != 0;
+	settings.report_progress = false;
+
+	ThreadPool pool{ thread_count };
+	while (true) {
+		TaskMessage task;
+		if (!socket->receive_all(&header, sizeof(header))) break;
+		if (header.type == uint32_t(MessageType::done)) return true;
+		if (header.type != uint32_t(MessageType::task) || !receive_body(*socket, header, task)
+			|| task.y + task.height > job.height || task.x + task.width > job.width) {
+			break;
+		}
+
+		const Tile tile{ task.y, task.x, task.height, task.width };
+		const auto sums = RT.render_tile_sums(*camera, job.height, job.width, tile, task.first, task.last, settings, pool);
+		if (!send_message(*socket, MessageType::result, &task, sizeof(task), sums.data(), sums.size() * sizeof(Color))) break;
+	}
+
+	std::cerr << "lost connection to coordinator\n";
+	return false;
+}
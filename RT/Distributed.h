@@ -0,0 +1,47 @@
+#pragma once
+
+#include "RayTracer.h"
+#include "Socket.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+//Rendering of one frame by worker processes, on this or other machines. The coordinator splits the frame into tasks
+//(a tile and a range of its samples) and hands them out one at a time to workers connected over TCP, so faster workers
+//take more of them. Workers send back sums of their samples, which the coordinator adds to its accumulation buffer.
+//Task of a worker which disconnects or does not answer in time goes back to the queue for another worker.
+//Random streams are keyed by pixel and sample, so workers need only the scene and settings to take the same samples
+//as a local render - with one sample range per tile the image is identical to RayTracer::render.
+
+//what workers build and render, scene is one of named_scene (see Scenes.h)
+struct DistributedJob {
+	std::string scene;
+	uint64_t height = 0;
+	uint64_t width = 0;
+	RenderSettings settings;        //sampling and integrator settings are sent to workers, which use their own thread count
+};
+
+struct DistributedSettings {
+	uint64_t tile_size = 64;
+	int sample_ranges = 1;          //tasks per tile, each takes its share of samples_per_pixel
+	double task_timeout = 60;       //in seconds, task of a worker which does not answer in time is given to another one
+	int max_attempts = 3;           //of one task, render fails when a task has been lost that many times
+	double worker_wait = 30;        //in seconds, render fails when no worker is connected for that long
+	bool report_progress = true;
+};
+
+struct DistributedRender {
+	Frame image;
+	size_t workers = 0;             //connected over the whole render
+	uint64_t retried_tasks = 0;
+};
+
+//accepts workers on listener and hands them tasks until all are done, empty if render fails
+[[nodiscard]]
+std::optional<DistributedRender> render_distributed(Listener& listener, const DistributedJob& job, const DistributedSettings& settings);
+
+//connects to coordinator (retrying for a while, in case it is still starting) and renders its tasks until it is done
+//false if connection cannot be made or is lost before that
+bool run_worker(const char* host, uint16_t port, size_t thread_count);
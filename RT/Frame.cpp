@@ -1,30 +1,364 @@
 #include "Frame.h"
-#include "utils.h"
+#include "Simd.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <string>
+#include <string_view>
+
+namespace {
+	//truncation like static_cast of clamped value, NaN (from negative values) becomes 0 like in the SIMD versions
+	template <std::floating_point T>
+	[[nodiscard]]
+	unsigned char encode(T c) noexcept {
+		const auto v = 256 * std::sqrt(c);
+		return static_cast<unsigned char>(v >= 0 ? std::min(v, T(255)) : T(0));
+	}
+
+	[[nodiscard]]
+	Scalar decode(unsigned char c) noexcept {
+		const auto v = (c + Scalar(0.5)) / 256;
+		return v * v;
+	}
+
+	template <std::floating_point T>
+	void encode_scalar(const T* in, size_t count, unsigned char* out) noexcept {
+		for (size_t i = 0; i < count; ++i) out[i] = encode(in[i]);
+	}
+
+#ifdef RT_X86
+	//same operations as encode, sqrt is correctly rounded in both, max returns 0 for NaN
+#ifndef RT_SINGLE_PRECISION
+	//double components are only stored by double Scalar builds
+	RT_TARGET("avx2")
+	void encode_avx2(const double* in, size_t count, unsigned char* out) noexcept {
+		const auto scale = _mm256_set1_pd(256);
+		const auto zero = _mm256_setzero_pd();
+		const auto max = _mm256_set1_pd(255);
+
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			auto v = _mm256_mul_pd(scale, _mm256_sqrt_pd(_mm256_loadu_pd(in + i)));
+			v = _mm256_min_pd(_mm256_max_pd(v, zero), max);
+			const auto words = _mm_packus_epi32(_mm256_cvttpd_epi32(v), _mm_setzero_si128());
+			const auto bytes = _mm_packus_epi16(words, words);
+			const auto packed = _mm_cvtsi128_si32(bytes);
+			std::memcpy(out + i, &packed, 4);
+		}
+		encode_scalar(in + i, count - i, out + i);
+	}
+#endif
+
+	RT_TARGET("avx2")
+	void encode_avx2(const float* in, size_t count, unsigned char* out) noexcept {
+		const auto scale = _mm256_set1_ps(256);
+		const auto zero = _mm256_setzero_ps();
+		const auto max = _mm256_set1_ps(255);
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			auto v = _mm256_mul_ps(scale, _mm256_sqrt_ps(_mm256_loadu_ps(in + i)));
+			v = _mm256_min_ps(_mm256_max_ps(v, zero), max);
+			const auto ints = _mm256_cvttps_epi32(v);
+			const auto words = _mm_packus_epi32(_mm256_castsi256_si128(ints), _mm256_extracti128_si256(ints, 1));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+		}
+		encode_scalar(in + i, count - i, out + i);
+	}
+#endif
+
+	template <std::floating_point T>
+	void encode_components(const T* in, size_t count, unsigned char* out) noexcept {
+#ifdef RT_X86
+		if (simd::active_level() >= simd::Level::avx2) return encode_avx2(in, count, out);
+#endif
+		encode_scalar(in, count, out);
+	}
+
+	//rows are converted into a buffer of about this size, which is then written at once
+	constexpr size_t write_chunk_size = 1 << 20;
+
+	//writes rows produced by convert_row(y, out) in large chunks
+	template <typename F>
+	bool write_rows(std::ofstream& file, uint64_t height, size_t row_size, F&& convert_row) {
+		const auto rows_per_chunk = std::max<size_t>(1, write_chunk_size / std::max<size_t>(row_size, 1));
+		std::vector<char> buffer(rows_per_chunk * row_size);
+
+		for (uint64_t y = 0; y < height; y += rows_per_chunk) {
+			const auto rows = std::min<uint64_t>(rows_per_chunk, height - y);
+			for (uint64_t r = 0; r < rows; ++r) {
+				convert_row(y + r, buffer.data() + r * row_size);
+			}
+			file.write(buffer.data(), rows * row_size);
+		}
+		return file.good();
+	}
+
+	//png chunks end with crc of their type and data
+	class Crc32 {
+		static constexpr auto table = [] {
+			std::array<uint32_t, 256> t{};
+			for (uint32_t n = 0; n < 256; ++n) {
+				auto c = n;
+				for (int k = 0; k < 8; ++k) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				t[n] = c;
+			}
+			return t;
+		}();
+
+		uint32_t crc_ = 0xffffffffu;
+
+	public:
+		void update(const unsigned char* data, size_t size) noexcept {
+			for (size_t i = 0; i < size; ++i) crc_ = table[(crc_ ^ data[i]) & 0xff] ^ (crc_ >> 8);
+		}
+
+		[[nodiscard]]
+		uint32_t value() const noexcept { return crc_ ^ 0xffffffffu; }
+	};
+
+	//zlib stream ends with adler32 of uncompressed data
+	class Adler32 {
+		uint32_t a_ = 1;
+		uint32_t b_ = 0;
+
+	public:
+		void update(const unsigned char* data, size_t size) noexcept {
+			//largest number of bytes for which b cannot overflow before the modulo
+			constexpr size_t block = 5552;
+			while (size > 0) {
+				const auto n = std::min(size, block);
+				for (size_t i = 0; i < n; ++i) {
+					a_ += data[i];
+					b_ += a_;
+				}
+				a_ %= 65521;
+				b_ %= 65521;
+				data += n;
+				size -= n;
+			}
+		}
+
+		[[nodiscard]]
+		uint32_t value() const noexcept { return b_ << 16 | a_; }
+	};
+
+	void put_u32(std::vector<unsigned char>& out, uint32_t v) {
+		for (int shift : { 24, 16, 8, 0 }) out.push_back(static_cast<unsigned char>(v >> shift));
+	}
+
+	//writes image data as zlib stream of stored deflate blocks, split into IDAT chunks of about write_chunk_size
+	class PngWriter {
+		static constexpr size_t max_block_size = 65535;
+
+		std::ofstream& file_;
+		std::vector<unsigned char> block_;
+		std::vector<unsigned char> idat_;
+		Adler32 adler_;
+
+		void write_chunk(const char* type, const std::vector<unsigned char>& data) {
+			std::vector<unsigned char> header;
+			put_u32(header, static_cast<uint32_t>(data.size()));
+			header.insert(header.end(), type, type + 4);
+
+			Crc32 crc;
+			crc.update(header.data() + 4, 4);
+			crc.update(data.data(), data.size());
+			std::vector<unsigned char> footer;
+			put_u32(footer, crc.value());
+
+			file_.write(reinterpret_cast<const char*>(header.data()), header.size());
+			file_.write(reinterpret_cast<const char*>(data.data()), data.size());
+			file_.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+		}
+
+		void flush_block(bool final) {
+			const auto size = static_cast<uint16_t>(block_.size());
+			idat_.push_back(final ? 1 : 0); //BFINAL, BTYPE 00 - stored
+			for (auto v : { size, static_cast<uint16_t>(~size) }) {
+				idat_.push_back(static_cast<unsigned char>(v));
+				idat_.push_back(static_cast<unsigned char>(v >> 8));
+			}
+			idat_.insert(idat_.end(), block_.begin(), block_.end());
+			block_.clear();
+
+			if (idat_.size() >= write_chunk_size) {
+				write_chunk("IDAT", idat_);
+				idat_.clear();
+			}
+		}
+
+	public:
+		PngWriter(std::ofstream& file, uint64_t height, uint64_t width) : file_{ file } {
+			const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+			file_.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+			std::vector<unsigned char> header;
+			put_u32(header, static_cast<uint32_t>(width));
+			put_u32(header, static_cast<uint32_t>(height));
+			header.insert(header.end(), { 8, 2, 0, 0, 0 }); //8 bit RGB, deflate, no filter, not interlaced
+			write_chunk("IHDR", header);
+
+			block_.reserve(max_block_size);
+			idat_.reserve(write_chunk_size + max_block_size + 16);
+			idat_.insert(idat_.end(), { 0x78, 0x01 }); //zlib header, no compression
+		}
+
+		void write(const unsigned char* data, size_t size) {
+			adler_.update(data, size);
+			while (size > 0) {
+				const auto n = std::min(size, max_block_size - block_.size());
+				block_.insert(block_.end(), data, data + n);
+				data += n;
+				size -= n;
+				if (block_.size() == max_block_size) flush_block(false);
+			}
+		}
+
+		void finish() {
+			flush_block(true);
+			put_u32(idat_, adler_.value());
+			write_chunk("IDAT", idat_);
+			write_chunk("IEND", {});
+		}
+	};
+}
+
+void Frame::encode_row(uint64_t y, unsigned char* out) const noexcept {
+	if (format_ == PixelFormat::float32) encode_components(float_data_[y * stride_].data, 3 * width_, out);
+	else encode_components(scalar_data_[y * stride_].data, 3 * width_, out);
+}
 
 bool Frame::to_ppm(const char* filename) const {
-	if (height * width != data.size()) return false;
 	auto file = std::ofstream{ filename, std::ios::binary };
 	if (!file) return false;
 
-	file.write("P6 ", 3);
-	auto tmp = std::to_string(width) + " " + std::to_string(height) + " 255 ";
-	file.write(tmp.data(), tmp.size());
+	const auto header = "P6 " + std::to_string(width_) + " " + std::to_string(height_) + " 255 ";
+	file.write(header.data(), header.size());
 
-	auto write_color = [&file](const Color& c) {
-		unsigned char data[3];
-		for (auto i : { 0, 1, 2 })
-			data[i] = static_cast<unsigned char>(utils::clamp(256 * std::sqrt(c.data[i]), 0.0, 255.0));
-			//data[i] = static_cast<int>(256 * clamp(std::sqrt(c.data[i]), 0.0, 0.999));
+	return write_rows(file, height_, 3 * width_, [&](uint64_t y, char* out) {
+		encode_row(y, reinterpret_cast<unsigned char*>(out));
+	});
+}
 
-		file.write((char*)data, 3);
-	};
+bool Frame::to_pfm(const char* filename) const {
+	static_assert(std::endian::native == std::endian::little, "pfm is written as little endian");
+
+	auto file = std::ofstream{ filename, std::ios::binary };
+	if (!file) return false;
+
+	//negative scale marks little endian data, rows go from bottom to top
+	const auto header = "PF\n" + std::to_string(width_) + " " + std::to_string(height_) + "\n-1.0\n";
+	file.write(header.data(), header.size());
 
-	for (const auto& c : data) {
-		write_color(c);
+	return write_rows(file, height_, 3 * sizeof(float) * width_, [&](uint64_t y, char* out) {
+		const auto row = height_ - 1 - y;
+		if (format_ == PixelFormat::float32) {
+			std::memcpy(out, float_data_[row * stride_].data, 3 * sizeof(float) * width_);
+			return;
+		}
+		const auto* in = scalar_data_[row * stride_].data;
+		for (uint64_t i = 0; i < 3 * width_; ++i) {
+			const auto v = static_cast<float>(in[i]);
+			std::memcpy(out + i * sizeof(float), &v, sizeof(float));
+		}
+	});
+}
+
+bool Frame::to_png(const char* filename) const {
+	auto file = std::ofstream{ filename, std::ios::binary };
+	if (!file) return false;
+
+	PngWriter png{ file, height_, width_ };
+	std::vector<unsigned char> row(1 + 3 * width_);
+	for (uint64_t y = 0; y < height_; ++y) {
+		row[0] = 0; //filter type none
+		encode_row(y, row.data() + 1);
+		png.write(row.data(), row.size());
 	}
+	png.finish();
 
 	return file.good();
+}
+
+bool Frame::save(const char* filename) const {
+	const std::string_view name{ filename };
+	if (name.ends_with(".pfm")) return to_pfm(filename);
+	if (name.ends_with(".png")) return to_png(filename);
+	return to_ppm(filename);
+}
+
+std::optional<Frame> Frame::from_ppm(const char* filename) {
+	auto file = std::ifstream{ filename, std::ios::binary };
+	if (!file) return {};
+
+	//header fields are separated by whitespace and may be interleaved with comments
+	auto read_field = [&file]() -> std::optional<uint64_t> {
+		while (true) {
+			file >> std::ws;
+			if (file.peek() != '#') break;
+			file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+		}
+		uint64_t value;
+		if (!(file >> value)) return {};
+		return value;
+	};
+
+	char magic[2];
+	if (!file.read(magic, 2) || magic[0] != 'P' || magic[1] != '6') return {};
+
+	const auto width = read_field();
+	const auto height = read_field();
+	const auto max_value = read_field();
+	if (!width || !height || *width == 0 || *height == 0 || max_value != 255) return {};
+	file.get(); //single whitespace before pixel data
+
+	//pixels have to be in the file, which also keeps the byte count from overflowing
+	const auto data_start = file.tellg();
+	if (data_start < 0 || !file.seekg(0, std::ios::end)) return {};
+	const auto data_size = static_cast<uint64_t>(file.tellg() - data_start);
+	if (!file.seekg(data_start) || *width > data_size / 3 / *height) return {};
+
+	Frame frame{ *height, *width };
+	std::vector<unsigned char> bytes(3 * *width * *height);
+	if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) return {};
+
+	for (uint64_t y = 0; y < *height; ++y) {
+		for (uint64_t x = 0; x < *width; ++x) {
+			const auto* p = &bytes[3 * (y * *width + x)];
+			frame.set_pixel(y, x, { decode(p[0]), decode(p[1]), decode(p[2]) });
+		}
+	}
+	return frame;
+}
+
+FrameDifference difference(const Frame& a, const Frame& b) {
+	FrameDifference result;
+	double squared_sum = 0;
+
+	std::vector<unsigned char> row_a(3 * a.width()), row_b(3 * b.width());
+	for (uint64_t y = 0; y < a.height(); ++y) {
+		a.encode_row(y, row_a.data());
+		b.encode_row(y, row_b.data());
+		for (uint64_t x = 0; x < a.width(); ++x) {
+			bool differs = false;
+			for (auto i : { 0, 1, 2 }) {
+				const auto d = std::abs(int{ row_a[3 * x + i] } - int{ row_b[3 * x + i] });
+				squared_sum += d * d;
+				result.max = std::max(result.max, d);
+				differs |= d != 0;
+			}
+			result.differing_pixels += differs;
+		}
+	}
+
+	const auto count = 3.0 * a.height() * a.width();
+	result.rms = count > 0 ? std::sqrt(squared_sum / count) : 0;
+	result.psnr = result.rms > 0 ? 20 * std::log10(255 / result.rms) : std::numeric_limits<double>::infinity();
+	return result;
 }
\ No newline at end of file
@@ -1,19 +1,145 @@
 #pragma once
 
 #include "Vec3.h"
+#include "utils.h"
+
+#include <cstdint>
+#include <numeric>
+#include <optional>
 #include <vector>
 
+//difference of two frames after 8 bit encoding, as they would be written to files
+struct FrameDifference {
+	double rms = 0;             //in 8 bit units
+	double psnr = 0;            //in dB, infinite for identical frames
+	int max = 0;
+	uint64_t differing_pixels = 0;
+};
+
+enum class PixelFormat {
+	scalar,  //Color, i.e. Scalar per channel
+	float32  //float per channel, halves memory of double builds
+};
+
+//rectangle of a frame, in pixels
+struct Tile {
+	uint64_t y = 0;
+	uint64_t x = 0;
+	uint64_t height = 0;
+	uint64_t width = 0;
+};
+
+//Image preallocated at construction, pixels can be written in any order.
+//Rows start at cache line boundary and are padded to whole cache lines, so tiles whose width is
+//a multiple of 8 (scalar) or 16 (float32) pixels never share a cache line and can be written
+//from different threads without locks.
 class Frame {
-	uint64_t height;
-	uint64_t width;
-	std::vector<Color> data;
+	static constexpr size_t cache_line = 64;
+
+	template <typename T>
+	using Storage = std::vector<BasicVec3<T>, utils::AlignedAllocator<BasicVec3<T>, cache_line>>;
+
+	uint64_t height_;
+	uint64_t width_;
+	uint64_t stride_;
+	PixelFormat format_;
+	Storage<Scalar> scalar_data_;   //used with PixelFormat::scalar
+	Storage<float> float_data_;     //used with PixelFormat::float32
+
+	[[nodiscard]]
+	static uint64_t row_stride(uint64_t width, size_t pixel_size) noexcept {
+		//smallest number of pixels filling whole cache lines
+		auto pixels = cache_line / std::gcd(pixel_size, cache_line);
+		return (width + pixels - 1) / pixels * pixels;
+	}
 
 public:
-	Frame(uint64_t height, uint64_t width) : height{ height }, width{ width } {}
+	Frame(uint64_t height, uint64_t width, PixelFormat format = PixelFormat::scalar) : height_{ height }, width_{ width }, format_{ format } {
+		if (format_ == PixelFormat::float32) {
+			stride_ = row_stride(width_, sizeof(BasicVec3<float>));
+			float_data_.resize(height_ * stride_);
+		}
+		else {
+			stride_ = row_stride(width_, sizeof(Color));
+			scalar_data_.resize(height_ * stride_);
+		}
+	}
+
+	//view of a tile, coordinates are relative to its corner
+	class TileView {
+		Frame* frame_;
+		Tile tile_;
+
+	public:
+		TileView(Frame& frame, const Tile& tile) noexcept : frame_{ &frame }, tile_{ tile } {}
+
+		[[nodiscard]]
+		const Tile& tile() const noexcept { return tile_; }
+
+		void set_pixel(uint64_t y, uint64_t x, const Color& c) noexcept {
+			frame_->set_pixel(tile_.y + y, tile_.x + x, c);
+		}
+
+		[[nodiscard]]
+		Color pixel(uint64_t y, uint64_t x) const noexcept {
+			return frame_->pixel(tile_.y + y, tile_.x + x);
+		}
+	};
+
+	[[nodiscard]]
+	uint64_t height() const noexcept { return height_; }
 
-	void push_pixel(const Color& c) {
-		data.push_back(c);
+	[[nodiscard]]
+	uint64_t width() const noexcept { return width_; }
+
+	[[nodiscard]]
+	PixelFormat format() const noexcept { return format_; }
+
+	//different pixels can be written from different threads concurrently
+	void set_pixel(uint64_t y, uint64_t x, const Color& c) noexcept {
+		if (format_ == PixelFormat::float32) float_data_[y * stride_ + x] = BasicVec3<float>{ c };
+		else scalar_data_[y * stride_ + x] = c;
+	}
+
+	[[nodiscard]]
+	Color pixel(uint64_t y, uint64_t x) const noexcept {
+		if (format_ == PixelFormat::float32) return Color{ float_data_[y * stride_ + x] };
+		return scalar_data_[y * stride_ + x];
+	}
+
+	[[nodiscard]]
+	TileView view(const Tile& tile) noexcept {
+		return { *this, tile };
+	}
+
+	//bytes taken by pixels, including row padding
+	[[nodiscard]]
+	size_t memory_size() const noexcept {
+		return scalar_data_.size() * sizeof(Color) + float_data_.size() * sizeof(BasicVec3<float>);
 	}
 
+	[[nodiscard]]
+	bool operator==(const Frame&) const = default;
+
+	//gamma 2 encoded 8 bit RGB of row y, 3 * width bytes, as written to ppm and png
+	void encode_row(uint64_t y, unsigned char* out) const noexcept;
+
 	bool to_ppm(const char* filename) const;
-};
\ No newline at end of file
+
+	//linear 32 bit float RGB, nothing is lost by tonemapping or quantization
+	bool to_pfm(const char* filename) const;
+
+	//8 bit RGB in stored (uncompressed) deflate blocks, meant for previews
+	bool to_png(const char* filename) const;
+
+	//format is chosen by extension - .ppm, .pfm or .png
+	bool save(const char* filename) const;
+
+	//reads binary ppm with maxval 255, inverse of to_ppm up to quantization
+	[[nodiscard]]
+	static std::optional<Frame> from_ppm(const char* filename);
+};
+
+//frames have to be of the same size
+[[nodiscard]]
+FrameDifference difference(const Frame& a, const Frame& b);
\ No newline at end of file
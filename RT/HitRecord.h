@@ -1,6 +1,11 @@
 #pragma once
 
 #include "Vec3.h"
+#include "Ray.h"
+
+#include <bit>
+#include <cstdint>
+#include <type_traits>
 
 struct MaterialIndex
 {
@@ -8,15 +13,56 @@ struct MaterialIndex
 	size_t vector_index;
 };
 
-struct HitRecord {
-	Position position;
-	Direction normal;
+//moves point computed by intersection off the surface along the normal, so that rays leaving it
+//do not hit the same surface again - error of computed hit point grows with its magnitude, so the offset
+//is done in units in the last place, except near the origin where spacing of floating point numbers is tiny
+//(Wachter, Binder: A Fast and Robust Method for Avoiding Self-Intersection, Ray Tracing Gems)
+template <std::floating_point T>
+[[nodiscard]]
+BasicVec3<T> offset_ray_origin(const BasicVec3<T>& position, const BasicVec3<T>& normal) noexcept {
+	using Int = std::conditional_t<sizeof(T) == 4, int32_t, int64_t>;
+
+	constexpr T origin = T(1.0 / 32.0);
+	constexpr T float_scale = sizeof(T) == 4 ? T(1.0 / 65536.0) : T(1.0 / 4294967296.0);
+	constexpr T int_scale = sizeof(T) == 4 ? T(256) : T(1 << 20);
+
+	BasicVec3<T> result;
+	for (auto i : { 0, 1, 2 }) {
+		const auto p = position.data[i];
+		const auto offset = static_cast<Int>(int_scale * normal.data[i]);
+		const auto moved = std::bit_cast<T>(std::bit_cast<Int>(p) + (p < 0 ? -offset : offset));
+		result.data[i] = std::abs(p) < origin ? p + float_scale * normal.data[i] : moved;
+	}
+	return result;
+}
+
+template <std::floating_point T>
+struct BasicHitRecord {
+	using Vec3 = BasicVec3<T>;
+
+	Vec3 position;
+	Vec3 normal;
 	MaterialIndex material;
-	double t{};
+	T t{};
+	T error{}; //bound of absolute error of position, when it is larger than few ulps handled by offset_ray_origin
+	T time{};  //of the ray which found the hit, set by Scene, rays leaving the surface keep it
 	bool front_face{};
 
-	void set_face_normal(const Direction& ray_direction, const Direction& outward_normal) {
+	void set_face_normal(const Vec3& ray_direction, const Vec3& outward_normal) {
 		front_face = ray_direction.dot(outward_normal) < 0;
 		normal = front_face ? outward_normal : -outward_normal;
 	}
-};
\ No newline at end of file
+
+	//ray leaving the surface, origin is moved to the side of the surface the direction points to
+	[[nodiscard]]
+	BasicRay<T> spawn_ray(const Vec3& direction) const noexcept {
+		const auto n = direction.dot(normal) > 0 ? normal : -normal;
+		return {
+			offset_ray_origin(position + n * error, n),
+			direction,
+			time
+		};
+	}
+};
+
+using HitRecord = BasicHitRecord<Scalar>;
\ No newline at end of file
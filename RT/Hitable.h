@@ -1,9 +1,25 @@
 #pragma once
 #include "Ray.h"
 #include "HitRecord.h"
+#include "AABB.h"
 #include <optional>
 
-template <typename T>
-concept Hittable = requires (const T a, const Ray r) {
-	{ a.intersect(r, double{}, double{}) } -> std::same_as<std::optional<HitRecord>>;
-};
\ No newline at end of file
+template <typename T, typename S = Scalar>
+concept Hittable = requires (const T a, const BasicRay<S> r) {
+	{ a.intersect(r, S{}, S{}) } -> std::same_as<std::optional<BasicHitRecord<S>>>;
+	{ a.bounding_box() } -> std::same_as<BasicAABB<S>>;
+};
+
+//hittables with a cheaper test for whether anything lies on the ray, without computing HitRecord
+template <typename T, typename S = Scalar>
+concept Occluder = Hittable<T, S> && requires (const T a, const BasicRay<S> r) {
+	{ a.occluded(r, S{}, S{}) } -> std::same_as<bool>;
+};
+
+//occlusion query for any hittable, those without occluded() fall back to closest hit
+template <Hittable T>
+[[nodiscard]]
+bool any_hit(const T& object, const Ray& ray, Scalar t_min, Scalar t_max) {
+	if constexpr (Occluder<T>) return object.occluded(ray, t_min, t_max);
+	else return object.intersect(ray, t_min, t_max).has_value();
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Ray.h"
+#include "Hitable.h"
+#include "HitRecord.h"
+#include "AABB.h"
+#include "Transform.h"
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+//Copy of shared geometry (e.g. SphereSet or TriangleMesh with its own BVH) placed in the scene by an affine transform.
+//Rays are moved into object space instead of geometry being duplicated, so an instance costs the same few hundred bytes
+//whatever the size of its geometry. Scene BVH over instances and BVHs of the geometries form a two-level hierarchy.
+//Geometry is not modified through instances, objects with build() have to be built before they are shared.
+//Moving instance has another transform at the end of the shutter interval, rays are intersected with the blend of the two
+//at their time (motion blur). Blend and its inverse are computed per ray, so only moving instances pay for it.
+template <Hittable G>
+class Instance {
+	std::shared_ptr<const G> geometry_;
+	Transform object_to_world_;
+	std::optional<Transform> world_to_object_; //empty for singular transforms, such instances are never hit
+	std::optional<Transform> end_to_world_;    //at shutter close, empty for instances which do not move
+	AABB bounds_;
+	std::optional<MaterialIndex> material_;
+
+	[[nodiscard]]
+	std::optional<HitRecord> intersect(const Ray& ray, Scalar t_min, Scalar t_max, const Transform& object_to_world, const Transform& world_to_object) const noexcept {
+		const Ray local{ world_to_object.point(ray.origin()), world_to_object.vector(ray.direction()), ray.time() };
+		auto hit = geometry_->intersect(local, t_min, t_max);
+		if (!hit) return {};
+
+		//error of the object space point is scaled by the transform and rounding of the transform is added,
+		//also for world to object space as the next ray leaving the surface is transformed back
+		const auto local_position = hit->position;
+		hit->position = object_to_world.point(local_position);
+		hit->error = object_to_world.max_scale() * (hit->error + world_to_object.point_error(hit->position))
+			+ object_to_world.point_error(local_position);
+
+		//sign of the dot product with the ray direction does not change, so front_face stays valid
+		hit->normal = world_to_object.normal_of_inverse(hit->normal).unit();
+		if (material_) hit->material = *material_;
+
+		return hit;
+	}
+
+	[[nodiscard]]
+	bool occluded(const Ray& ray, Scalar t_min, Scalar t_max, const Transform& world_to_object) const noexcept {
+		const Ray local{ world_to_object.point(ray.origin()), world_to_object.vector(ray.direction()), ray.time() };
+		return any_hit(*geometry_, local, t_min, t_max);
+	}
+
+public:
+	//material, when given, replaces materials of the geometry, so one asset can appear in different colors
+	Instance(std::shared_ptr<const G> geometry, const Transform& object_to_world, const std::optional<MaterialIndex>& material = {})
+		: geometry_{ std::move(geometry) }, material_{ material } {
+		set_transform(object_to_world);
+	}
+
+	//instance moving from start at shutter open to end at shutter close
+	Instance(std::shared_ptr<const G> geometry, const Transform& start, const Transform& end, const std::optional<MaterialIndex>& material = {})
+		: geometry_{ std::move(geometry) }, material_{ material } {
+		set_transform(start, end);
+	}
+
+	//places the instance again, e.g. for the next frame of an animation, its box in the scene BVH has to be refit
+	void set_transform(const Transform& object_to_world) noexcept {
+		set_transform(object_to_world, object_to_world);
+	}
+
+	//vertices move linearly between the two placements, so the union of their boxes bounds the whole motion
+	void set_transform(const Transform& start, const Transform& end) noexcept {
+		object_to_world_ = start;
+		world_to_object_ = start.inverse();
+		end_to_world_.reset();
+		bounds_ = start.box(geometry_->bounding_box());
+		if (end != start) {
+			end_to_world_ = end;
+			bounds_.expand(end.box(geometry_->bounding_box()));
+		}
+	}
+
+	[[nodiscard]]
+	bool moving() const noexcept {
+		return end_to_world_.has_value();
+	}
+
+	[[nodiscard]]
+	const G& geometry() const noexcept {
+		return *geometry_;
+	}
+
+	//at shutter open
+	[[nodiscard]]
+	const Transform& transform() const noexcept {
+		return object_to_world_;
+	}
+
+	//direction is transformed without normalization, so t is the same in both spaces
+	[[nodiscard]]
+	std::optional<HitRecord> intersect(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept {
+		if (end_to_world_) {
+			const auto object_to_world = lerp(object_to_world_, *end_to_world_, ray.time());
+			const auto world_to_object = object_to_world.inverse();
+			return world_to_object ? intersect(ray, t_min, t_max, object_to_world, *world_to_object) : std::nullopt;
+		}
+		return world_to_object_ ? intersect(ray, t_min, t_max, object_to_world_, *world_to_object_) : std::nullopt;
+	}
+
+	[[nodiscard]]
+	bool occluded(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept {
+		if (end_to_world_) {
+			const auto world_to_object = lerp(object_to_world_, *end_to_world_, ray.time()).inverse();
+			return world_to_object && occluded(ray, t_min, t_max, *world_to_object);
+		}
+		return world_to_object_ && occluded(ray, t_min, t_max, *world_to_object_);
+	}
+
+	[[nodiscard]]
+	AABB bounding_box() const noexcept {
+		return bounds_;
+	}
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Vec3.h"
+#include "HitRecord.h"
+#include "AliasTable.h"
+#include "PixelStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <optional>
+#include <utility>
+#include <vector>
+
+//Spherical emitters sampled directly from shaded points (next event estimation). A light is chosen
+//with probability proportional to its power by alias table, then a direction uniformly in the cone it subtends.
+class LightList {
+	struct SphereLight {
+		Position center;
+		Scalar radius;
+		Color radiance;
+		MaterialIndex material;
+	};
+
+	std::vector<SphereLight> lights_;
+	std::vector<std::pair<size_t, uint32_t>> by_material_; //(material vector_index, light), sorted, to find lights hit by rays
+	AliasTable table_;
+
+	//1 - cosine of the half angle of the cone, computed without cancellation for distant lights
+	[[nodiscard]]
+	static Scalar cone_height(Scalar radius_squared, Scalar distance_squared) noexcept {
+		const auto sin2 = radius_squared / distance_squared;
+		return sin2 / (1 + std::sqrt(std::max(Scalar(0), 1 - sin2)));
+	}
+
+public:
+	struct Sample {
+		Direction direction; //unit
+		Scalar distance;     //to the surface of the light along direction
+		Color radiance;
+		Scalar pdf;          //solid angle density, including probability of choosing the light
+	};
+
+	void clear() {
+		lights_.clear();
+		by_material_.clear();
+		table_ = {};
+	}
+
+	void add(const Position& center, Scalar radius, const Color& radiance, const MaterialIndex& material) {
+		lights_.push_back({ center, radius, radiance, material });
+	}
+
+	//has to be called after lights are added
+	void build() {
+		std::vector<double> power;
+		by_material_.clear();
+		for (uint32_t i = 0; i < lights_.size(); ++i) {
+			const auto& light = lights_[i];
+			power.push_back(std::max(luminance(light.radiance), 0.0) * 4 * std::numbers::pi * light.radius * light.radius);
+			by_material_.emplace_back(light.material.vector_index, i);
+		}
+		std::sort(by_material_.begin(), by_material_.end());
+		table_ = AliasTable{ power };
+	}
+
+	[[nodiscard]]
+	bool empty() const noexcept {
+		return table_.empty();
+	}
+
+	[[nodiscard]]
+	size_t size() const noexcept {
+		return lights_.size();
+	}
+
+	//direction from point towards a light, empty when the point is inside the chosen light
+	[[nodiscard]]
+	std::optional<Sample> sample(const Position& point, double u_light, std::pair<double, double> u_direction) const noexcept {
+		if (empty()) return {};
+
+		const auto [index, pmf] = table_.sample(u_light);
+		const auto& light = lights_[index];
+
+		const auto to_center = light.center - point;
+		const auto distance_squared = to_center.length_squared();
+		const auto radius_squared = light.radius * light.radius;
+		if (distance_squared <= radius_squared) return {};
+
+		//cosine uniform in [cos_max, 1], around direction to the center
+		const auto height = cone_height(radius_squared, distance_squared);
+		const auto cosine = 1 - Scalar(u_direction.first) * height;
+		const auto sine = std::sqrt(std::max(Scalar(0), 1 - cosine * cosine));
+		const auto phi = 2 * std::numbers::pi_v<Scalar> * Scalar(u_direction.second);
+
+		const auto w = to_center / std::sqrt(distance_squared);
+		const auto a = std::abs(w.x()) > Scalar(0.9) ? Direction{ 0, 1, 0 } : Direction{ 1, 0, 0 };
+		const auto v = w.cross(a).unit();
+		const auto u = v.cross(w);
+		const auto direction = (u * (sine * std::cos(phi)) + v * (sine * std::sin(phi)) + w * cosine).unit();
+
+		//nearer intersection with the sphere, the direction is inside the cone so it always exists up to rounding
+		const auto b = direction.dot(to_center);
+		const auto distance = b - std::sqrt(std::max(Scalar(0), b * b - (distance_squared - radius_squared)));
+
+		return Sample{ direction, distance, light.radiance, pmf / (2 * std::numbers::pi_v<Scalar> * height) };
+	}
+
+	//density with which sample would pick direction from origin to the hit of an emitter, 0 for emitters which are not lights
+	//lights sharing material are told apart by distance of the hit from their surface
+	[[nodiscard]]
+	Scalar pdf(const Position& origin, const HitRecord& hit) const noexcept {
+		auto it = std::lower_bound(by_material_.begin(), by_material_.end(), std::pair{ hit.material.vector_index, uint32_t{ 0 } });
+		for (; it != by_material_.end() && it->first == hit.material.vector_index; ++it) {
+			const auto& light = lights_[it->second];
+			if (std::abs((hit.position - light.center).length() - light.radius) > Scalar(1e-3) * light.radius + hit.error) continue;
+
+			const auto distance_squared = (light.center - origin).length_squared();
+			const auto radius_squared = light.radius * light.radius;
+			if (distance_squared <= radius_squared) return 0;
+
+			return table_.pmf(it->second) / (2 * std::numbers::pi_v<Scalar> * cone_height(radius_squared, distance_squared));
+		}
+		return 0;
+	}
+};
@@ -1,142 +1,401 @@
-#include "Vec3.h"
-#include "Frame.h"
-#include "Camera.h"
-#include "Scene.h"
-#include "Sphere.h"
-#include "utils.h"
-#include "Materials.h"
+#include "RayTracer.h"
+#include "Scenes.h"
+#include "Benchmark.h"
+#include "Distributed.h"
+#include "SceneFile.h"
+#include "RenderJob.h"
 
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
 
-template <typename... Ts>
-struct TypeList {};
+constexpr const char* checkpoint_path = "out.checkpoint";
 
-template <typename Hittables, typename Materials>
-class RayTracer {
-	static_assert(!std::is_void_v<std::void_t<Hittables>>, "Wrong template arguments");
-};
+constexpr const char* usage =
+	"usage: RT                                   book scene, adaptive, to out.ppm\n"
+	"       RT render <scene> [options]          scene file (.rtscene) or text scene, options:\n"
+	"           --output <file>                  .ppm (default out.ppm), .pfm or .png\n"
+	"           --width <n> --height <n>         one of them keeps aspect ratio of the scene\n"
+	"           --spp <n> --depth <n> --seed <n> --threads <n>\n"
+	"           --budget <seconds>               progressive render for that long, --spp is its limit\n"
+	"           --adaptive                       adaptive sampling, --spp is the limit per pixel\n"
+	"       RT batch <manifest> [--threads <n>]  one job per line: <scene> [options], paths relative to the manifest\n"
+	"       RT compile <scene.txt> <scene.rtscene>\n"
+	"       RT progressive <seconds> | resume <checkpoint> [seconds]\n"
+	"       RT worker <host> <port> [threads]\n"
+	"       RT coordinator <port> <scene> [--workers <n>] [--bind <address>] [options of render]\n"
+	"                                            scene by name (book, room, glass, mesh, sphere_grid)\n"
+	"       RT mesh <file.rtmesh> | obj2mesh <file.obj> <file.rtmesh> | animation [frames] | room\n"
+	"       RT compare <a.ppm> <b.ppm> | bench [names] | suite [json] [baseline] [tolerance]\n";
 
-template <Hittable... Hs, Material... Ms>
-class RayTracer<TypeList<Hs...>, TypeList<Ms...>> {
-	Color ray_color(const Ray& ray, int depth) const {
-		if (depth <= 0) return { 0.0, 0.0, 0.0 };
+//state is saved to checkpoint_path every ten minutes, RT resume continues from it
+void default_render(const Checkpoint* resume = nullptr) {
+	DefaultRayTracer RT{};
+	book_scene(RT);
 
-		auto background_color = [](const Ray& ray) -> Color {
-			auto t = (ray.direction().unit().y() + 1.0) * 0.5;
-			return { lerp(Vec3{1.0, 1.0, 1.0}, Vec3{0.5, 0.7, 1.0}, t) };
-		};
+	const uint64_t height = 1200;
+	const uint64_t width = height * 3 / 2;
+	const auto aspect_ratio = double(width) / height;
 
-		auto hit = scene.intersect(ray, 0.001, std::numeric_limits<double>::infinity());
+	const auto camera = book_camera(aspect_ratio);
 
-		if (hit) {
-			auto res = materials.get_scatter_result(ray, *hit);
-			if (res) {
-				return res->attenuation.elementwise_mul(ray_color(res->scattered, depth - 1));
-			}
-			return Color{ 0, 0, 0 };
-		}
-		else return background_color(ray);
+	RenderSettings settings;
+	settings.adaptive.enabled = true;
+	settings.checkpoint.path = checkpoint_path;
+
+	ThreadPool pool{ settings.thread_count };
+	const auto result = RT.render_adaptive(camera, height, width, settings, pool, resume);
+	result.image.to_ppm("out.ppm");
+	result.sample_heatmap().to_ppm("samples.ppm");
+}
+
+//time budget of a command in seconds, 0 (no limit) and other values which would not end the render are not valid
+[[nodiscard]]
+bool parse_time_budget(std::string_view word, double& seconds) {
+	return utils::parse_number(word, seconds) && seconds > 0 && std::isfinite(seconds);
+}
+
+//best image within time budget, out.ppm is rewritten after every pass so the render can be watched
+void progressive_render(double time_budget, const Checkpoint* resume = nullptr) {
+	DefaultRayTracer RT{};
+	book_scene(RT);
+
+	const uint64_t height = 1200;
+	const uint64_t width = height * 3 / 2;
+	const auto camera = book_camera(double(width) / height);
+
+	RenderSettings settings;
+	settings.progressive.time_budget = time_budget;
+	settings.checkpoint.path = checkpoint_path;
+
+	ThreadPool pool{ settings.thread_count };
+	RT.render_progressive(camera, height, width, settings, pool, [](const Frame& image, int) {
+		image.to_ppm("out.ppm");
+	}, resume);
+}
+
+//continues default or progressive render from its checkpoint, progressive one for another time budget
+int resume_render(const char* filename, double time_budget) {
+	const auto checkpoint = Checkpoint::load(filename);
+	if (!checkpoint) {
+		std::cerr << "cannot read checkpoint " << filename << '\n';
+		return 2;
 	}
+	if (checkpoint->mode == Checkpoint::Mode::adaptive) default_render(&*checkpoint);
+	else progressive_render(time_budget, &*checkpoint);
+	return 0;
+}
 
-public:
-	Scene<Hs...> scene;
-	MaterialList<Ms...> materials;
+//converts Wavefront OBJ to mesh file, which is mapped at load time instead of being parsed
+int convert_obj(const char* input, const char* output) {
+	const auto mesh = TriangleMesh::from_obj(input, MaterialIndex{ 0, 0 });
+	if (!mesh) {
+		std::cerr << "cannot read " << input << '\n';
+		return 2;
+	}
+	if (!mesh->save(output)) {
+		std::cerr << "cannot write " << output << '\n';
+		return 2;
+	}
+	std::cout << mesh->vertex_count() << " vertices, " << mesh->triangle_count() << " triangles, " << mesh->memory_size() << " bytes\n";
+	return 0;
+}
 
-	Frame render(const Camera& camera, const uint64_t height, const uint64_t width) const {
-		const int samples_per_pixel = 1000;
-		const int max_depth = 100;
+//compiles text scene into scene file, which is mapped at load time instead of being parsed and built
+int compile_scene(const char* input, const char* output) {
+	DefaultRayTracer RT{};
+	const auto description = read_scene_text(input, RT, std::cerr);
+	if (!description) return 2;
+	if (!save_scene(output, RT, *description)) {
+		std::cerr << "cannot write " << output << '\n';
+		return 2;
+	}
+	std::cout << RT.materials.size() << " materials, " << RT.scene.size() << " objects\n";
+	return 0;
+}
+
+void print_report(const RenderJob& job, const JobReport& report) {
+	std::cout << job.output << ": " << report.width << 'x' << report.height << ", " << report.total_samples << " samples, render "
+		<< report.render_seconds << " s";
+	if (report.load_seconds > 0) std::cout << ", scene " << job.scene << " loaded in " << report.load_seconds << " s";
+	std::cout << '\n';
+}
 
-		Frame frame{ height, width };
+//scene file rendered with options of parse_job, e.g. RT render scene.rtscene --width 1920 --spp 256 --output image.png
+int render_command(std::span<char*> args) {
+	const std::vector<std::string_view> arguments(args.begin(), args.end());
+	const auto job = parse_job(arguments, std::cerr);
+	if (!job) return 2;
 
-		for (uint64_t y = 0; y < height; ++y) {
-			for (uint64_t x = 0; x < width; ++x) {
-				Color color{};
-				for (int i = 0; i < samples_per_pixel; ++i) {
-					auto h = (x + utils::random_double()) / (width - 1);
-					auto v = (height - y + utils::random_double()) / (height - 1);
+	ThreadPool pool{ job->thread_count.value_or(std::thread::hardware_concurrency()) };
+	JobRunner runner{ pool, true };
+	const auto report = runner.run(*job, std::cerr);
+	if (!report) return 2;
+	print_report(*job, *report);
+	return 0;
+}
 
-					const auto r = camera.get_ray(h, v);
+//jobs of the manifest (see read_manifest) back to back in this process, on one pool and with scenes loaded once
+//failed jobs are reported and skipped, returns 1 if there were any
+int batch_command(const char* manifest, size_t thread_count) {
+	const auto jobs = read_manifest(manifest, std::cerr);
+	if (!jobs) return 2;
 
-					color += ray_color(r, max_depth);
-				}
-				frame.push_pixel(color / samples_per_pixel);
-			}
-			std::cout << y << "\n";
-		}
+	ThreadPool pool{ thread_count };
+	JobRunner runner{ pool, false };
+	size_t failed = 0;
+	for (const auto& job : *jobs) {
+		if (const auto report = runner.run(job, std::cerr)) print_report(job, *report);
+		else ++failed;
+	}
+	std::cout << jobs->size() - failed << " of " << jobs->size() << " jobs done, " << runner.scene_count() << " scenes loaded\n";
+	return failed > 0 ? 1 : 0;
+}
+
+//mesh file on the ground, written to out.ppm
+int mesh_render(const char* filename) {
+	DefaultRayTracer RT{};
+
+	const uint64_t height = 800;
+	const uint64_t width = height * 3 / 2;
+	const auto camera = mesh_scene(RT, filename, Scalar(width) / height);
+	if (!camera) {
+		std::cerr << "cannot load " << filename << '\n';
+		return 2;
+	}
+
+	RenderSettings settings;
+	settings.samples_per_pixel = 64;
+
+	ThreadPool pool{ settings.thread_count };
+	RT.render(*camera, height, width, settings, pool).to_ppm("out.ppm");
+	return 0;
+}
+
+//room lit by one small light, which is sampled directly at every diffuse bounce, written to out.ppm
+//with counters of the render in stats.json
+int room_render() {
+	DefaultRayTracer RT{};
+	room_scene(RT);
+
+	const uint64_t height = 800;
+	const uint64_t width = height * 3 / 2;
+	const auto camera = room_camera(Scalar(width) / height);
+
+	RenderSettings settings;
+	settings.samples_per_pixel = 256;
+
+	ThreadPool pool{ settings.thread_count };
+	const auto result = RT.render_with_stats(camera, height, width, settings, pool);
+	result.image.to_ppm("out.ppm");
+	std::cout << result.stats.rays() << " rays, " << result.stats.rays_per_second() << " rays/s\n";
+	if (!result.stats.write_json("stats.json")) {
+		std::cerr << "cannot write stats.json\n";
+		return 2;
+	}
+	return 0;
+}
+
+//renders the named scene (see named_scene) by workers which connect to port, port 0 picks a free one
+//--workers n processes of this executable are started as workers, other ones can join with "RT worker <host> <port>"
+//if --bind is an address they reach (the default is loopback), other options are those of parse_job
+//e.g. RT coordinator 5000 book --bind 0.0.0.0 --width 1920 --spp 256
+int coordinator_command(const char* executable, std::span<char*> args) {
+	uint16_t port = 0;
+	if (args.size() < 2 || !utils::parse_number(args[0], port)) {
+		std::cerr << usage;
+		return 2;
+	}
 
-		return frame;
-	}
-};
-
-void default_render() {
-	RayTracer<TypeList<Sphere>, TypeList<Lambertian, Metal, Dielectric>> RT{};
-
-	auto ground_material = RT.materials.emplace_material<Lambertian>(Color{ 0.5, 0.5, 0.5 });
-	RT.scene.emplace_back<Sphere>(Position{ 0, -1000, 0 }, 1000, ground_material);
-
-	std::discrete_distribution<int> material_dst{ {80, 15, 5} };
-	for (int a = -11; a < 11; ++a) {
-		for (int b = -11; b < 11; ++b) {
-			auto choose_material = material_dst(utils::rng);
-			Position center{ a + 0.7 * utils::random_double(), 0.2, b + 0.7 * utils::random_double() };
-
-			if ((center - Position{ 4, 0.2, 0 }).length() > 0.9) {
-				MaterialIndex sphere_material = [&] {
-					switch (choose_material)
-					{
-					case 0: {
-						const auto color = Color::random().elementwise_mul(Color::random());
-						return RT.materials.emplace_material<Lambertian>(color);
-					}
-					case 1: {
-						const auto color = Color::random(0.5, 1);
-						const auto fuzz = utils::random_double(0, 0.5);
-						return RT.materials.emplace_material<Metal>(color, fuzz);
-					}
-					default: {
-						return RT.materials.emplace_material<Dielectric>(1.5);
-					}
-					}
-				}();
-
-				RT.scene.emplace_back<Sphere>(center, 0.2, sphere_material);
+	const char* address = "127.0.0.1";
+	size_t local_workers = 0;
+	std::vector<std::string_view> arguments{ args[1] };
+	for (size_t i = 2; i < args.size(); ++i) {
+		const std::string_view option = args[i];
+		if (option == "--bind" && i + 1 < args.size()) address = args[++i];
+		else if (option == "--workers" && i + 1 < args.size()) {
+			if (!utils::parse_number(args[++i], local_workers)) {
+				std::cerr << "invalid value " << args[i] << " of --workers\n";
+				return 2;
 			}
 		}
+		else arguments.push_back(option);
 	}
 
-	auto material = RT.materials.emplace_material<Dielectric>(1.5);
-	RT.scene.emplace_back<Sphere>(Position{ 0, 1, 0 }, 1.0, material);
+	const auto job = parse_job(arguments, std::cerr);
+	if (!job) return 2;
+	if (job->time_budget > 0 || job->adaptive || job->thread_count) {
+		std::cerr << "distributed renders take a fixed number of samples, workers choose their threads\n";
+		return 2;
+	}
 
-	material = RT.materials.emplace_material<Lambertian>(Color{ 0.4, 0.2, 0.1 });
-	RT.scene.emplace_back<Sphere>(Position{ -4, 1, 0 }, 1.0, material);
+	auto listener = Listener::listen(port, address);
+	if (!listener) {
+		std::cerr << "cannot listen on " << address << ':' << port << '\n';
+		return 2;
+	}
+	port = listener->port();
+	std::cout << "coordinator listening on " << address << ':' << port << '\n';
 
-	material = RT.materials.emplace_material<Metal>(Color{ 0.7, 0.6, 0.5 }, 0.0);
-	RT.scene.emplace_back<Sphere>(Position{ 4, 1, 0 }, 1, material);
+	//what the job leaves out comes from defaults of scene files
+	const SceneDescription description;
+	DistributedJob distributed;
+	distributed.scene = job->scene;
+	std::tie(distributed.height, distributed.width) = image_size(*job, description);
+	distributed.settings = description.settings;
+	if (job->samples_per_pixel) distributed.settings.samples_per_pixel = *job->samples_per_pixel;
+	if (job->max_depth) distributed.settings.max_depth = *job->max_depth;
+	if (job->seed) distributed.settings.seed = *job->seed;
 
-	const uint64_t height = 1200;
+	const auto command = '"' + std::string{ executable } + "\" worker 127.0.0.1 " + std::to_string(port);
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < local_workers; ++i) {
+		workers.emplace_back([&] { (void)std::system(command.c_str()); });
+	}
+
+	const auto result = render_distributed(*listener, distributed, DistributedSettings{});
+	for (auto& worker : workers) worker.join();
+	if (!result) {
+		std::cerr << "distributed render of " << job->scene << " failed\n";
+		return 1;
+	}
+	if (!result->image.save(job->output.c_str())) {
+		std::cerr << "cannot write " << job->output << '\n';
+		return 2;
+	}
+	std::cout << result->workers << " workers, " << result->retried_tasks << " tasks retried\n";
+	return 0;
+}
+
+//forest with a few moving trees, frames are written to frame_0000.ppm, ... with the time their setup and render took
+int animation_render(uint64_t frame_count) {
+	DefaultRayTracer RT{};
+	const auto animation = forest_animation(RT, 2000, 8, frame_count);
+
+	const uint64_t height = 240;
 	const uint64_t width = height * 3 / 2;
-	const auto aspect_ratio = double(width) / height;
 
-	Position lookfrom{ 13, 2, 3 };
-	Position lookat{ 0, 0, 0 };
-	Direction vup{ 0, 1, 0 };
-	auto dist_to_focus = 10.0;
-	auto aperture = 0.1;
-
-	Camera camera {
-		lookfrom,
-		lookat,
-		vup,
-		20,
-		aspect_ratio,
-		aperture,
-		dist_to_focus
-	};
-
-	RT.render(camera, height, width).to_ppm("out.ppm");
+	RenderSettings settings;
+	settings.samples_per_pixel = 16;
+	settings.report_progress = false;
+
+	ThreadPool pool{ settings.thread_count };
+	bool written = true;
+	render_animation(RT, animation, height, width, settings, AnimationSettings{}, pool, [&](const Frame& image, const AnimationFrame& frame) {
+		char filename[32];
+		std::snprintf(filename, sizeof(filename), "frame_%04llu.ppm", static_cast<unsigned long long>(frame.index));
+		written &= image.to_ppm(filename);
+		std::cout << filename << ": setup " << frame.setup_seconds * 1e3 << " ms" << (frame.rebuilt ? " (rebuilt)" : "")
+			<< ", render " << frame.render_seconds << " s\n";
+	});
+	if (!written) {
+		std::cerr << "cannot write frames\n";
+		return 2;
+	}
+	return 0;
 }
 
-int main() {
-	default_render();
-}
\ No newline at end of file
+//prints difference of two ppm files, e.g. renders of single and double precision builds
+int compare_images(const char* first, const char* second) {
+	const auto a = Frame::from_ppm(first);
+	const auto b = Frame::from_ppm(second);
+	if (!a || !b) {
+		std::cerr << "cannot read " << (a ? second : first) << '\n';
+		return 2;
+	}
+	if (a->height() != b->height() || a->width() != b->width()) {
+		std::cerr << "images differ in size\n";
+		return 2;
+	}
+
+	const auto d = difference(*a, *b);
+	std::cout << "rms " << d.rms << ", psnr " << d.psnr << " dB, max " << d.max
+		<< ", differing pixels " << d.differing_pixels << '/' << a->height() * a->width() << '\n';
+	return d.max == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc > 1 && std::string_view{ argv[1] } == "bench") {
+		return run_benchmarks({ argv + 2, argv + argc });
+	}
+	if (argc > 1 && std::string_view{ argv[1] } == "suite") {
+		return run_suite({ argv + 2, argv + argc });
+	}
+	if (argc == 3 && std::string_view{ argv[1] } == "progressive") {
+		double time_budget = 0;
+		if (!parse_time_budget(argv[2], time_budget)) {
+			std::cerr << usage;
+			return 2;
+		}
+		progressive_render(time_budget);
+		return 0;
+	}
+	if ((argc == 3 || argc == 4) && std::string_view{ argv[1] } == "resume") {
+		double time_budget = 0;
+		if (argc == 4 && !parse_time_budget(argv[3], time_budget)) {
+			std::cerr << usage;
+			return 2;
+		}
+		return resume_render(argv[2], time_budget);
+	}
+	if ((argc == 4 || argc == 5) && std::string_view{ argv[1] } == "worker") {
+		uint16_t port = 0;
+		size_t threads = std::thread::hardware_concurrency();
+		if (!utils::parse_number(argv[3], port) || (argc == 5 && (!utils::parse_number(argv[4], threads) || threads == 0))) {
+			std::cerr << usage;
+			return 2;
+		}
+		return run_worker(argv[2], port, threads) ? 0 : 2;
+	}
+	if (argc >= 4 && std::string_view{ argv[1] } == "coordinator") {
+		return coordinator_command(argv[0], { argv + 2, argv + argc });
+	}
+	if (argc == 4 && std::string_view{ argv[1] } == "compare") {
+		return compare_images(argv[2], argv[3]);
+	}
+	if (argc == 4 && std::string_view{ argv[1] } == "obj2mesh") {
+		return convert_obj(argv[2], argv[3]);
+	}
+	if (argc == 4 && std::string_view{ argv[1] } == "compile") {
+		return compile_scene(argv[2], argv[3]);
+	}
+	if (argc >= 3 && std::string_view{ argv[1] } == "render") {
+		return render_command({ argv + 2, argv + argc });
+	}
+	if ((argc == 3 || (argc == 5 && std::string_view{ argv[3] } == "--threads")) && std::string_view{ argv[1] } == "batch") {
+		size_t threads = std::thread::hardware_concurrency();
+		if (argc == 5 && (!utils::parse_number(argv[4], threads) || threads == 0)) {
+			std::cerr << usage;
+			return 2;
+		}
+		return batch_command(argv[2], threads);
+	}
+	if (argc == 3 && std::string_view{ argv[1] } == "mesh") {
+		return mesh_render(argv[2]);
+	}
+	if ((argc == 2 || argc == 3) && std::string_view{ argv[1] } == "animation") {
+		uint64_t frame_count = 48;
+		if (argc == 3 && (!utils::parse_number(argv[2], frame_count) || frame_count == 0)) {
+			std::cerr << usage;
+			return 2;
+		}
+		return animation_render(frame_count);
+	}
+	if (argc == 2 && std::string_view{ argv[1] } == "room") {
+		return room_render();
+	}
+	if (argc == 1) {
+		default_render();
+		return 0;
+	}
+
+	std::cerr << usage;
+	return 2;
+}
@@ -0,0 +1,80 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::shared_ptr<const MappedFile> MappedFile::open(const char* filename) {
+	std::shared_ptr<MappedFile> file{ new MappedFile };
+
+	file->file_ = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file->file_ == INVALID_HANDLE_VALUE) {
+		file->file_ = nullptr;
+		return nullptr;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file->file_, &size)) return nullptr;
+	file->size_ = static_cast<size_t>(size.QuadPart);
+	if (file->size_ == 0) return file;
+
+	file->mapping_ = CreateFileMappingA(file->file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!file->mapping_) return nullptr;
+
+	file->data_ = static_cast<const std::byte*>(MapViewOfFile(file->mapping_, FILE_MAP_READ, 0, 0, 0));
+	if (!file->data_) return nullptr;
+
+	return file;
+}
+
+MappedFile::~MappedFile() {
+	if (data_) UnmapViewOfFile(data_);
+	if (mapping_) CloseHandle(mapping_);
+	if (file_) CloseHandle(file_);
+}
+
+#else
+
+std::shared_ptr<const MappedFile> MappedFile::open(const char* filename) {
+	const auto fd = ::open(filename, O_RDONLY);
+	if (fd < 0) return nullptr;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		::close(fd);
+		return nullptr;
+	}
+
+	std::shared_ptr<MappedFile> file{ new MappedFile };
+	file->size_ = static_cast<size_t>(info.st_size);
+
+	if (file->size_ > 0) {
+		void* data = mmap(nullptr, file->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			::close(fd);
+			return nullptr;
+		}
+		//traversal jumps around the file, readahead would load pages which are never used
+		madvise(data, file->size_, MADV_RANDOM);
+		file->data_ = static_cast<const std::byte*>(data);
+	}
+
+	//mapping stays valid after the descriptor is closed
+	::close(fd);
+	return file;
+}
+
+MappedFile::~MappedFile() {
+	if (data_) munmap(const_cast<std::byte*>(data_), size_);
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+
+//Read only view of a whole file mapped into memory. Nothing is read up front, the OS loads pages
+//on first access and can drop them again under memory pressure, so data is used in place without copies.
+class MappedFile {
+	const std::byte* data_ = nullptr;
+	size_t size_ = 0;
+#ifdef _WIN32
+	void* file_ = nullptr;
+	void* mapping_ = nullptr;
+#endif
+
+	MappedFile() = default;
+
+public:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	//nullptr if the file cannot be opened or mapped
+	[[nodiscard]]
+	static std::shared_ptr<const MappedFile> open(const char* filename);
+
+	[[nodiscard]]
+	std::span<const std::byte> bytes() const noexcept {
+		return { data_, size_ };
+	}
+};
@@ -7,13 +7,40 @@
 #include <optional>
 
 
-struct ScatterResult
+template <std::floating_point T>
+struct BasicScatterResult
 {
-	Color attenuation;
-	Ray scattered;
+	BasicVec3<T> attenuation;
+	BasicRay<T> scattered;
+	T pdf{}; //solid angle density of the scattered direction, 0 for specular scattering which lights cannot be sampled for
 };
 
-template <typename T>
-concept Material = requires (const T m, const Ray ray, const HitRecord& hr) {
-	{ m.scatter(ray, hr) } -> std::same_as<std::optional<ScatterResult>>;
+using ScatterResult = BasicScatterResult<Scalar>;
+
+//BSDF times cosine for a given direction and density with which scatter would have chosen it
+template <std::floating_point T>
+struct BasicBsdfValue
+{
+	BasicVec3<T> value;
+	T pdf{};
+};
+
+using BsdfValue = BasicBsdfValue<Scalar>;
+
+template <typename T, typename S = Scalar>
+concept Material = requires (const T m, const BasicRay<S> ray, const BasicHitRecord<S>& hr) {
+	{ m.scatter(ray, hr) } -> std::same_as<std::optional<BasicScatterResult<S>>>;
+};
+
+//materials giving off light, radiance is constant so spheres made of them can be sampled as lights
+template <typename T, typename S = Scalar>
+concept EmissiveMaterial = Material<T, S> && requires (const T m, const BasicRay<S> ray, const BasicHitRecord<S>& hr) {
+	{ m.emitted(ray, hr) } -> std::same_as<BasicVec3<S>>;
+	{ m.radiance() } -> std::same_as<BasicVec3<S>>;
+};
+
+//non-specular materials whose BSDF can be evaluated for directions towards lights
+template <typename T, typename S = Scalar>
+concept DiffuseMaterial = Material<T, S> && requires (const T m, const BasicHitRecord<S>& hr, const BasicVec3<S>& direction) {
+	{ m.evaluate(hr, direction) } -> std::same_as<std::optional<BasicBsdfValue<S>>>;
 };
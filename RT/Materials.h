@@ -2,125 +2,253 @@
 
 #include "Material.h"
 #include "Vec3.h"
+#include "Warp.h"
 
+#include <array>
+#include <cstdint>
+#include <numbers>
 #include <optional>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
 
 class Lambertian {
-	Color color;
+	Color color_;
 
 public:
-	Lambertian(const Color& color) : color{ color } {}
+	Lambertian(const Color& color) : color_{ color } {}
 
 	[[nodiscard]]
 	std::optional<ScatterResult> scatter(const Ray&, const HitRecord& hr) const noexcept {
-		auto direction = hr.normal + Vec3::random_unit();
+		auto direction = hr.normal + warp::random_unit();
 
 		auto near_zero = [](const Vec3& v) {
 			for (auto s : v.data) {
-				if (std::abs(s) > std::numeric_limits<double>::epsilon()) return false;
+				if (std::abs(s) > std::numeric_limits<Scalar>::epsilon()) return false;
 			}
 			return true;
 		};
 
 		if (near_zero(direction)) direction = hr.normal;
 
+		//normal plus uniform unit vector is distributed by cosine
 		return ScatterResult{
-			color,
-			{hr.position, direction}
+			color_,
+			hr.spawn_ray(direction),
+			std::max(direction.unit().dot(hr.normal), Scalar(0)) * std::numbers::inv_pi_v<Scalar>
 		};
 	}
+
+	//direction is unit, pointing away from the surface
+	[[nodiscard]]
+	std::optional<BsdfValue> evaluate(const HitRecord& hr, const Direction& direction) const noexcept {
+		const auto cosine = direction.dot(hr.normal);
+		if (cosine <= 0) return {};
+
+		const auto pdf = cosine * std::numbers::inv_pi_v<Scalar>;
+		return BsdfValue{ color_ * pdf, pdf };
+	}
+
+	[[nodiscard]]
+	const Color& color() const noexcept {
+		return color_;
+	}
 };
 
-static_assert(Material<Lambertian>);
+static_assert(DiffuseMaterial<Lambertian>);
 
 class Metal {
-	Color color;
-	double fuzz;
+	Color color_;
+	Scalar fuzz_;
 
 public:
-	Metal(const Color& color, double fuzz) : color{ color }, fuzz{fuzz} {}
+	Metal(const Color& color, Scalar fuzz) : color_{ color }, fuzz_{ fuzz } {}
 
 	[[nodiscard]]
 	std::optional<ScatterResult> scatter(const Ray& ray, const HitRecord& hr) const noexcept {
-		auto reflected = ray.direction().reflected(hr.normal).unit() + Vec3::random_in_sphere(fuzz);
+		auto reflected = ray.direction().reflected(hr.normal).unit() + warp::random_in_sphere(fuzz_);
 		if (hr.normal.dot(reflected) > 0) {
 			return ScatterResult{
-				color,
-				{hr.position, reflected}
+				color_,
+				hr.spawn_ray(reflected)
 			};
 		}
 		return {};
 	}
+
+	[[nodiscard]]
+	const Color& color() const noexcept {
+		return color_;
+	}
+
+	[[nodiscard]]
+	Scalar fuzz() const noexcept {
+		return fuzz_;
+	}
 };
 
 static_assert(Material<Metal>);
 
 class Dielectric {
-	double index_of_refraction;
+	Scalar index_of_refraction_;
 
 	[[nodiscard]]
-	static double reflectance(double cosine, double ref_idx) noexcept {
+	static Scalar reflectance(Scalar cosine, Scalar ref_idx) noexcept {
 		auto r0 = (1 - ref_idx) / (1 + ref_idx);
 		r0 = r0 * r0;
 		return r0 + (1 - r0) * std::pow((1 - cosine), 5);
 	}
 public:
-	Dielectric(double index_of_refraction) : index_of_refraction{ index_of_refraction } {}
+	Dielectric(Scalar index_of_refraction) : index_of_refraction_{ index_of_refraction } {}
 
 	[[nodiscard]]
 	std::optional<ScatterResult> scatter(const Ray& ray, const HitRecord& hr) const noexcept {
-		const auto refraction_ratio = hr.front_face ? (1.0 / index_of_refraction) : index_of_refraction;
+		const auto refraction_ratio = hr.front_face ? (1 / index_of_refraction_) : index_of_refraction_;
 
 		const auto unit_direction = ray.direction().unit();
 
-		const auto cos_theta = std::min((-unit_direction).dot(hr.normal), 1.0);
-		const auto sin_theta = std::sqrt(1.0 - cos_theta * cos_theta);
+		const auto cos_theta = std::min((-unit_direction).dot(hr.normal), Scalar(1));
+		const auto sin_theta = std::sqrt(1 - cos_theta * cos_theta);
 
 		const bool cannot_refract = refraction_ratio * sin_theta > 1.0;
 
-		const auto direction = cannot_refract || reflectance(cos_theta, refraction_ratio) > utils::random_double()
+		const auto direction = cannot_refract || reflectance(cos_theta, refraction_ratio) > utils::sampler.get_1d()
 			                 ? unit_direction.reflected(hr.normal)
 			                 : unit_direction.refracted(hr.normal, refraction_ratio);
 
 		return ScatterResult{
 			Color{1.0, 1.0, 1.0},
-			Ray{hr.position, direction}
+			hr.spawn_ray(direction)
 		};
 	}
+
+	[[nodiscard]]
+	Scalar index_of_refraction() const noexcept {
+		return index_of_refraction_;
+	}
 };
 
 static_assert(Material<Dielectric>);
 
+//one sided emitter, gives off radiance from its front face and absorbs everything
+class DiffuseLight {
+	Color radiance_;
+
+public:
+	DiffuseLight(const Color& radiance) : radiance_{ radiance } {}
+
+	[[nodiscard]]
+	std::optional<ScatterResult> scatter(const Ray&, const HitRecord&) const noexcept {
+		return {};
+	}
+
+	[[nodiscard]]
+	Color emitted(const Ray&, const HitRecord& hr) const noexcept {
+		return hr.front_face ? radiance_ : Color{ 0, 0, 0 };
+	}
+
+	[[nodiscard]]
+	Color radiance() const noexcept {
+		return radiance_;
+	}
+};
+
+static_assert(EmissiveMaterial<DiffuseLight>);
+
+//Flat table of materials, dispatched with std::visit (jump table) in O(1).
+//MaterialIndex::type_index is index of the alternative, so hits can be grouped by type without touching the table.
 template <Material... Ms>
 class MaterialList {
 	static_assert(utils::are_distinct<Ms...>::value, "Some type appears more then one time");
 
-	std::tuple<std::vector<Ms>...> materials;
-	
-	//probably better option:
-	//std::vector<std::variant<Ms...>> materials;
+	using Variant = std::variant<Ms...>;
+
+	std::vector<Variant> materials;
+
+	template <size_t... Is, typename F>
+	void for_each_group(std::span<const MaterialIndex> hits, std::span<const uint32_t> order, const std::array<uint32_t, sizeof...(Ms) + 1>& offsets, F& f, std::index_sequence<Is...>) const {
+		auto group = [&]<size_t I>(std::integral_constant<size_t, I>) {
+			for (auto k = offsets[I]; k < offsets[I + 1]; ++k) {
+				const auto i = order[k];
+				f(i, *std::get_if<I>(&materials[hits[i].vector_index]));
+			}
+		};
+		(group(std::integral_constant<size_t, Is>{}), ...);
+	}
 
 public:
+	static constexpr size_t type_count = sizeof...(Ms);
+
+	//MaterialIndex::type_index of materials of type M
+	template <Material M>
+	[[nodiscard]]
+	static constexpr size_t type_index() noexcept {
+		static_assert(utils::is_in_pack_v<M, Ms...>, "This material is not in the list");
+		return utils::first_occurance<M, Ms...>::value;
+	}
+
 	template <Material M, typename... Ts>
 	[[nodiscard]]
 	MaterialIndex emplace_material(Ts... args) {
 		static_assert(utils::is_in_pack_v<M, Ms...>, "This material is not in the list");
 		static_assert(std::is_constructible_v<M, Ts...>, "Cannot construct material from given arguments");
 
-		auto& vec = std::get<std::vector<M>>(materials);
-		vec.emplace_back(std::forward<Ts>(args)...);
+		materials.emplace_back(std::in_place_type<M>, std::forward<Ts>(args)...);
 		return {
 			utils::first_occurance<M, Ms...>::value,
-			vec.size() - 1
+			materials.size() - 1
 		};
 	}
 
+	[[nodiscard]]
+	size_t size() const noexcept {
+		return materials.size();
+	}
+
 	[[nodiscard]]
 	std::optional<ScatterResult> get_scatter_result(const Ray& ray, const HitRecord& hit) const {
-		auto visitor = [&]<Material T>(const std::vector<T>& v) {
-			return v[hit.material.vector_index].scatter(ray, hit);
-		};
+		return std::visit([&](const auto& material) {
+			return material.scatter(ray, hit);
+		}, materials[hit.material.vector_index]);
+	}
+
+	//calls f(material) with the material of given index
+	template <typename F>
+	decltype(auto) visit(const MaterialIndex& index, F&& f) const {
+		return std::visit(std::forward<F>(f), materials[index.vector_index]);
+	}
+
+	[[nodiscard]]
+	Color emitted(const Ray& ray, const HitRecord& hit) const {
+		return visit(hit.material, [&]<Material M>(const M& material) {
+			if constexpr (EmissiveMaterial<M>) return material.emitted(ray, hit);
+			else return Color{ 0, 0, 0 };
+		});
+	}
+
+	//radiance of emissive materials, empty for the others
+	[[nodiscard]]
+	std::optional<Color> radiance(const MaterialIndex& index) const {
+		return visit(index, [&]<Material M>(const M& material) -> std::optional<Color> {
+			if constexpr (EmissiveMaterial<M>) return material.radiance();
+			else return {};
+		});
+	}
+
+	//shading stage of batched rendering - calls f(i, material) for every hits[i], grouped by material type,
+	//so each group runs the same scatter code without dispatch; order is scratch space reused between calls
+	//within a group hits keep their relative order
+	template <typename F>
+	void for_each_sorted(std::span<const MaterialIndex> hits, std::vector<uint32_t>& order, F&& f) const {
+		std::array<uint32_t, type_count + 1> offsets{};
+		for (const auto& hit : hits) ++offsets[hit.type_index + 1];
+		for (size_t t = 0; t < type_count; ++t) offsets[t + 1] += offsets[t];
+
+		order.resize(hits.size());
+		auto next = offsets;
+		for (uint32_t i = 0; i < hits.size(); ++i) order[next[hits[i].type_index]++] = i;
 
-		return utils::visit_tuple(materials, visitor, hit.material.type_index);
+		for_each_group(hits, order, offsets, f, std::index_sequence_for<Ms...>{});
 	}
 };
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Vec3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+[[nodiscard]] constexpr
+double luminance(const Color& c) noexcept {
+	return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+}
+
+//running sums of samples of one pixel, luminance moments are used to estimate error of the mean
+struct PixelStatistics {
+	Color sum;
+	double luminance_sum = 0;
+	double luminance_squared_sum = 0;
+	uint32_t samples = 0;
+
+	constexpr
+	void add(const Color& c) noexcept {
+		const auto l = luminance(c);
+		sum += c;
+		luminance_sum += l;
+		luminance_squared_sum += l * l;
+		++samples;
+	}
+
+	[[nodiscard]] constexpr
+	Color mean() const noexcept {
+		return samples == 0 ? Color{} : sum * (1.0 / samples);
+	}
+
+	//standard error of the mean luminance after gamma 2 encoding, i.e. noise as it shows up in the image
+	//floor keeps the estimate finite for black pixels
+	[[nodiscard]]
+	double error(double floor = 1e-4) const noexcept {
+		if (samples < 2) return std::numeric_limits<double>::infinity();
+
+		const auto n = static_cast<double>(samples);
+		const auto mean = luminance_sum / n;
+		const auto variance = std::max(0.0, (luminance_squared_sum - n * mean * mean) / (n - 1));
+
+		//derivative of sqrt scales the error of the linear value
+		return std::sqrt(variance / n) / (2 * std::sqrt(std::max(mean, floor)));
+	}
+};
@@ -2,21 +2,31 @@
 
 #include "Vec3.h"
 
-class Ray {
-	Position origin_;
-	Direction direction_;
+template <std::floating_point T>
+class BasicRay {
+	using Vec3 = BasicVec3<T>;
+
+	Vec3 origin_;
+	Vec3 direction_;
+	T time_;
 
 public:
-	constexpr Ray(const Position& origin, const Direction& direction) : origin_{ origin }, direction_{ direction } {}
+	//time in the shutter interval of the frame, 0 when it opens and 1 when it closes, moving objects are placed by it
+	constexpr BasicRay(const Vec3& origin, const Vec3& direction, T time = 0) : origin_{ origin }, direction_{ direction }, time_{ time } {}
+
+	[[nodiscard]] constexpr
+	const Vec3& origin() const noexcept { return origin_; }
 
 	[[nodiscard]] constexpr
-	const Position& origin() const noexcept { return origin_; }
+	const Vec3& direction() const noexcept { return direction_; }
 
 	[[nodiscard]] constexpr
-	const Direction& direction() const noexcept { return direction_; }
+	T time() const noexcept { return time_; }
 
 	constexpr
-	Position at(double t) const noexcept {
+	Vec3 at(T t) const noexcept {
 		return origin_ + t * direction_;
 	}
-};
\ No newline at end of file
+};
+
+using Ray = BasicRay<Scalar>;
\ No newline at end of file
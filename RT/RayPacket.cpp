@@ -0,0 +1,160 @@
+#include "RayPacket.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+//wider targets enable fma and gcc would fuse multiplications with additions, kernels have to round like scalar code
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "SimdOps.h"
+
+namespace {
+	constexpr Scalar epsilon = std::numeric_limits<Scalar>::epsilon() / 2;
+	constexpr Scalar far_scale = 1 + 2 * (3 * epsilon / (1 - 3 * epsilon));
+
+	uint32_t intersect_box_scalar(const RayPacket& p, const AABB& box, Scalar t_min, const Scalar* t_max) {
+		uint32_t mask = 0;
+		for (uint32_t lane = 0; lane < RayPacket::size; ++lane) {
+			const Position origin{ p.origin[0][lane], p.origin[1][lane], p.origin[2][lane] };
+			const Direction inv_direction{ p.inv_direction[0][lane], p.inv_direction[1][lane], p.inv_direction[2][lane] };
+			if (box.intersect(origin, inv_direction, t_min, t_max[lane])) mask |= 1u << lane;
+		}
+		return mask;
+	}
+
+	uint32_t intersect_sphere_scalar(const RayPacket& p, const Position& center, Scalar radius, Scalar t_min, Scalar* t_max) {
+		uint32_t mask = 0;
+		for (uint32_t lane = 0; lane < RayPacket::size; ++lane) {
+			const auto dx = p.direction[0][lane], dy = p.direction[1][lane], dz = p.direction[2][lane];
+			const auto ocx = p.origin[0][lane] - center.x();
+			const auto ocy = p.origin[1][lane] - center.y();
+			const auto ocz = p.origin[2][lane] - center.z();
+
+			const auto a = dx * dx + dy * dy + dz * dz;
+			const auto half_b = ocx * dx + ocy * dy + ocz * dz;
+			const auto c = (ocx * ocx + ocy * ocy + ocz * ocz) - radius * radius;
+			const auto discriminant = half_b * half_b - a * c;
+
+			if (!(discriminant >= 0)) continue;
+
+			const auto sqrt_d = std::sqrt(discriminant);
+			auto root = (-half_b - sqrt_d) / a;
+			if (root < t_min || t_max[lane] < root) {
+				root = (-half_b + sqrt_d) / a;
+				if (root < t_min || t_max[lane] < root) continue;
+			}
+
+			t_max[lane] = root;
+			mask |= 1u << lane;
+		}
+		return mask;
+	}
+
+#ifdef RT_X86
+	RT_TARGET("avx2")
+	uint32_t intersect_box_avx2(const RayPacket& p, const AABB& box, Scalar t_min, const Scalar* t_max) {
+		using Ops = simd::Avx2<Scalar>;
+
+		const auto scale = Ops::set1(far_scale);
+		const auto zero = Ops::set1(0);
+		uint32_t mask = 0;
+
+		for (uint32_t lane = 0; lane < RayPacket::size; lane += Ops::width) {
+			auto near = Ops::set1(t_min);
+			auto far = Ops::load(t_max + lane);
+
+			for (auto i : { 0, 1, 2 }) {
+				const auto o = Ops::load(p.origin[i] + lane);
+				const auto inv = Ops::load(p.inv_direction[i] + lane);
+				const auto t0 = Ops::mul(Ops::sub(Ops::set1(box.min.data[i]), o), inv);
+				const auto t1 = Ops::mul(Ops::sub(Ops::set1(box.max.data[i]), o), inv);
+
+				const auto negative = Ops::less(inv, zero);
+				const auto entry = Ops::blend(t0, t1, negative);
+				const auto exit = Ops::mul(Ops::blend(t1, t0, negative), scale);
+
+				//NaN distances leave the interval unchanged, like comparisons in AABB::intersect
+				near = Ops::blend(near, entry, Ops::less(near, entry));
+				far = Ops::blend(far, exit, Ops::less(exit, far));
+			}
+
+			const auto missed = Ops::movemask(Ops::less(far, near));
+			mask |= (~missed & ((1u << Ops::width) - 1)) << lane;
+		}
+		return mask;
+	}
+
+	RT_TARGET("avx2")
+	uint32_t intersect_sphere_avx2(const RayPacket& p, const Position& center, Scalar radius, Scalar t_min, Scalar* t_max) {
+		using Ops = simd::Avx2<Scalar>;
+
+		const auto cx = Ops::set1(center.x()), cy = Ops::set1(center.y()), cz = Ops::set1(center.z());
+		const auto r = Ops::set1(radius);
+		const auto t_lower = Ops::set1(t_min);
+		const auto zero = Ops::set1(0);
+		uint32_t mask = 0;
+
+		for (uint32_t lane = 0; lane < RayPacket::size; lane += Ops::width) {
+			const auto dx = Ops::load(p.direction[0] + lane);
+			const auto dy = Ops::load(p.direction[1] + lane);
+			const auto dz = Ops::load(p.direction[2] + lane);
+			const auto ocx = Ops::sub(Ops::load(p.origin[0] + lane), cx);
+			const auto ocy = Ops::sub(Ops::load(p.origin[1] + lane), cy);
+			const auto ocz = Ops::sub(Ops::load(p.origin[2] + lane), cz);
+
+			const auto a = Ops::add(Ops::add(Ops::mul(dx, dx), Ops::mul(dy, dy)), Ops::mul(dz, dz));
+			const auto half_b = Ops::add(Ops::add(Ops::mul(ocx, dx), Ops::mul(ocy, dy)), Ops::mul(ocz, dz));
+			const auto oc2 = Ops::add(Ops::add(Ops::mul(ocx, ocx), Ops::mul(ocy, ocy)), Ops::mul(ocz, ocz));
+			const auto c = Ops::sub(oc2, Ops::mul(r, r));
+			const auto discriminant = Ops::sub(Ops::mul(half_b, half_b), Ops::mul(a, c));
+
+			//sqrt of negative discriminant is NaN, which fails both range checks
+			const auto sqrt_d = Ops::sqrt(discriminant);
+			const auto minus_b = Ops::sub(zero, half_b);
+			const auto near = Ops::div(Ops::sub(minus_b, sqrt_d), a);
+			const auto far = Ops::div(Ops::add(minus_b, sqrt_d), a);
+
+			const auto upper = Ops::load(t_max + lane);
+			const auto near_ok = Ops::in_range(near, t_lower, upper);
+			const auto far_ok = Ops::in_range(far, t_lower, upper);
+			const auto hit = Ops::mask_or(near_ok, far_ok);
+
+			Ops::store(t_max + lane, Ops::blend(upper, Ops::blend(far, near, near_ok), hit));
+			mask |= Ops::movemask(hit) << lane;
+		}
+		return mask;
+	}
+#endif
+}
+
+uint32_t RayPacket::intersect(const AABB& box, Scalar t_min, const Scalar* t_max) const noexcept {
+#ifdef RT_X86
+	if (simd::active_level() >= simd::Level::avx2) return intersect_box_avx2(*this, box, t_min, t_max);
+#endif
+	return intersect_box_scalar(*this, box, t_min, t_max);
+}
+
+uint32_t RayPacket::intersect_sphere(const Position& center, Scalar radius, uint32_t lanes, Scalar t_min, Scalar* t_max) const noexcept {
+	//kernels test all lanes, distances of the others are put back
+	Scalar previous[size];
+	std::copy(t_max, t_max + size, previous);
+
+	uint32_t hit;
+#ifdef RT_X86
+	if (simd::active_level() >= simd::Level::avx2) hit = intersect_sphere_avx2(*this, center, radius, t_min, t_max);
+	else
+#endif
+	hit = intersect_sphere_scalar(*this, center, radius, t_min, t_max);
+
+	for (auto other = hit & ~lanes; other; other &= other - 1) {
+		const auto lane = std::countr_zero(other);
+		t_max[lane] = previous[lane];
+	}
+	return hit & lanes;
+}
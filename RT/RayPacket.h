@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Vec3.h"
+#include "Ray.h"
+#include "AABB.h"
+
+#include <cstdint>
+#include <limits>
+
+//Camera rays of a block of side x side pixels, traced together through the BVH.
+//Components are stored in arrays (lane i holds ray i), so boxes and spheres are tested against all rays with SIMD.
+//Lanes without a ray have NaN origin, which never hits anything.
+struct RayPacket {
+	static constexpr uint32_t side = 4;
+	static constexpr uint32_t size = side * side;
+	static constexpr uint32_t all_lanes = (1u << size) - 1;
+
+	alignas(64) Scalar origin[3][size];
+	alignas(64) Scalar direction[3][size];
+	alignas(64) Scalar inv_direction[3][size];
+	alignas(64) Scalar time[size]{};
+	uint32_t active = 0; //bit per lane holding a ray
+
+	RayPacket() noexcept {
+		for (auto i : { 0, 1, 2 }) {
+			for (uint32_t lane = 0; lane < size; ++lane) {
+				origin[i][lane] = std::numeric_limits<Scalar>::quiet_NaN();
+				direction[i][lane] = 1;
+				inv_direction[i][lane] = 1;
+			}
+		}
+	}
+
+	void set(uint32_t lane, const Ray& ray) noexcept {
+		for (auto i : { 0, 1, 2 }) {
+			origin[i][lane] = ray.origin().data[i];
+			direction[i][lane] = ray.direction().data[i];
+			inv_direction[i][lane] = 1 / ray.direction().data[i];
+		}
+		time[lane] = ray.time();
+		active |= 1u << lane;
+	}
+
+	[[nodiscard]]
+	Ray ray(uint32_t lane) const noexcept {
+		return {
+			{ origin[0][lane], origin[1][lane], origin[2][lane] },
+			{ direction[0][lane], direction[1][lane], direction[2][lane] },
+			time[lane]
+		};
+	}
+
+	//lanes whose rays enter the box within [t_min, t_max[lane]], same test as AABB::intersect
+	[[nodiscard]]
+	uint32_t intersect(const AABB& box, Scalar t_min, const Scalar* t_max) const noexcept;
+
+	//those of given lanes with closer hit of the sphere than t_max[lane], their t_max is set to the distance of the hit
+	//same arithmetic as Sphere::intersect, so the distances are exactly equal
+	uint32_t intersect_sphere(const Position& center, Scalar radius, uint32_t lanes, Scalar t_min, Scalar* t_max) const noexcept;
+};
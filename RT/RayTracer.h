@@ -0,0 +1,848 @@
+#pragma once
+
+#include "Vec3.h"
+#include "Frame.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "Sphere.h"
+#include "Lights.h"
+#include "Materials.h"
+#include "ThreadPool.h"
+#include "PixelStatistics.h"
+#include "Wavefront.h"
+#include "Sampler.h"
+#include "RayPacket.h"
+#include "Stats.h"
+#include "Checkpoint.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+template <typename... Ts>
+struct TypeList {};
+
+enum class Integrator {
+	iterative,
+	recursive, //reference implementation, without russian roulette and light sampling
+	wavefront  //stream engine, see render_wavefront, same image as iterative
+};
+
+struct AdaptiveSettings {
+	bool enabled = false;
+	int min_samples = 16;           //taken by every pixel before its error is estimated
+	int batch_size = 16;            //samples added to unconverged pixels in one pass
+	double threshold = 0.005;       //standard error (in gamma encoded units) at which pixel is considered converged
+	uint64_t sample_budget = 0;     //if not 0, limits total number of samples, extra samples go to the noisiest pixels first
+};
+
+struct ProgressiveSettings {
+	int pass_samples = 4;           //samples per pixel added to the whole frame in one pass
+	double time_budget = 0;         //in seconds, if not 0 no pass is started which is not expected to finish in time
+};
+
+struct CheckpointSettings {
+	std::string path;               //if not empty, adaptive and progressive renders save their state there between passes
+	double interval = 600;          //in seconds between checkpoints, the finished render is always saved
+};
+
+struct RenderSettings {
+	int samples_per_pixel = 1000;   //maximum per pixel when sampling adaptively or progressively
+	int max_depth = 100;
+	int russian_roulette_depth = 5; //bounces before paths can be terminated early
+	Integrator integrator = Integrator::iterative;
+	AdaptiveSettings adaptive;
+	ProgressiveSettings progressive;
+	CheckpointSettings checkpoint;
+	uint64_t tile_size = 32;        //multiple of 16 keeps tiles on separate cache lines of the frame
+	PixelFormat pixel_format = PixelFormat::scalar;
+	SamplerType sampler = SamplerType::sobol;
+	uint64_t seed = 0;              //selects noise of the image, renders with different seeds are independent
+	bool packet_primary_rays = true; //iterative integrator traces camera rays of pixel blocks together, see render_packets
+	bool sample_lights = true;      //next event estimation at diffuse hits, lights are found by RayTracer::build
+	size_t thread_count = std::thread::hardware_concurrency();
+	bool report_progress = true;
+};
+
+struct AdaptiveRender {
+	Frame image;
+	std::vector<uint32_t> sample_counts;
+	uint64_t total_samples = 0;
+
+	//blue for pixels which took least samples, red for the ones which took most
+	[[nodiscard]]
+	Frame sample_heatmap() const {
+		Frame heatmap{ image.height(), image.width() };
+		const auto max = std::max<uint32_t>(1, *std::max_element(sample_counts.begin(), sample_counts.end()));
+		for (uint64_t y = 0; y < image.height(); ++y) {
+			for (uint64_t x = 0; x < image.width(); ++x) {
+				const auto t = Scalar(sample_counts[y * image.width() + x]) / max;
+				heatmap.set_pixel(y, x, lerp(Color{ 0.0, 0.0, 1.0 }, Color{ 1.0, 0.0, 0.0 }, t));
+			}
+		}
+		return heatmap;
+	}
+};
+
+struct StatsRender {
+	Frame image;
+	RenderStats stats;
+};
+
+//receives image after every progressive pass, together with number of samples per pixel it contains
+using SnapshotCallback = std::function<void(const Frame& image, int samples_per_pixel)>;
+
+template <typename Hittables, typename Materials>
+class RayTracer {
+	static_assert(!std::is_void_v<std::void_t<Hittables>>, "Wrong template arguments");
+};
+
+template <Hittable... Hs, Material... Ms>
+class RayTracer<TypeList<Hs...>, TypeList<Ms...>> {
+	[[nodiscard]]
+	static Color background_color(const Ray& ray) noexcept {
+		auto t = (ray.direction().unit().y() + 1.0) * 0.5;
+		return { lerp(Vec3{1.0, 1.0, 1.0}, Vec3{0.5, 0.7, 1.0}, t) };
+	}
+
+	//shadow rays end this fraction of the distance before the light, so they do not hit the light itself
+	//roots of the ray/sphere quadratic lose about half of their digits for grazing rays, so it is a multiple of sqrt(epsilon)
+	static constexpr Scalar shadow_epsilon = std::is_same_v<Scalar, float> ? Scalar(3e-3) : Scalar(1e-7);
+
+	[[nodiscard]]
+	static Scalar power_heuristic(Scalar pdf, Scalar other_pdf) noexcept {
+		return pdf * pdf / (pdf * pdf + other_pdf * other_pdf);
+	}
+
+	//one bounce at a hit, shared by ray_color and the wavefront engine: adds emitted light and at diffuse materials
+	//light sampled from the list to color, both weighted by power heuristic against the other strategy (Veach, chapter 9)
+	//bsdf_pdf is density of the direction which found the hit, 0 for camera rays and after specular bounces
+	template <Material M>
+	std::optional<ScatterResult> shade(const M& material, const Ray& ray, const HitRecord& hit, Scalar bsdf_pdf, const Color& throughput, Color& color, const RenderSettings& settings) const {
+		if constexpr (EmissiveMaterial<M>) {
+			auto emitted = material.emitted(ray, hit);
+			if (settings.sample_lights && bsdf_pdf > 0) emitted *= power_heuristic(bsdf_pdf, lights.pdf(ray.origin(), hit));
+			color += throughput.elementwise_mul(emitted);
+		}
+
+		if constexpr (DiffuseMaterial<M>) {
+			if (settings.sample_lights && !lights.empty()) {
+				const auto u_light = utils::sampler.get_1d();
+				const auto u_direction = utils::sampler.get_2d();
+				const auto light = lights.sample(hit.position, u_light, u_direction);
+				const auto bsdf = light ? material.evaluate(hit, light->direction) : std::nullopt;
+				if (bsdf) {
+					//origin of the shadow ray is moved off the surface, its distance to the light is shorter than from the hit
+					const auto shadow = hit.spawn_ray(light->direction);
+					const auto distance = light->distance - (shadow.origin() - hit.position).dot(light->direction);
+					stats::count_shadow_ray();
+					if (!scene.occluded(shadow, 0, distance * (1 - shadow_epsilon))) {
+						const auto weight = power_heuristic(light->pdf, bsdf->pdf) / light->pdf;
+						color += throughput.elementwise_mul(bsdf->value.elementwise_mul(light->radiance) * weight);
+					}
+				}
+			}
+		}
+
+		stats::count_scatter(hit.material.type_index);
+		return material.scatter(ray, hit);
+	}
+
+	Color ray_color_recursive(const Ray& ray, int depth, int max_depth) const {
+		if (depth <= 0) {
+			stats::count_termination(stats::Termination::max_depth);
+			return { 0.0, 0.0, 0.0 };
+		}
+
+		utils::sampler.start_bounce(depth);
+
+		stats::count_rays(max_depth - depth);
+		auto hit = scene.intersect(ray, 0, std::numeric_limits<Scalar>::infinity());
+
+		if (hit) {
+			const auto emitted = materials.emitted(ray, *hit);
+			stats::count_scatter(hit->material.type_index);
+			auto res = materials.get_scatter_result(ray, *hit);
+			if (res) {
+				return emitted + res->attenuation.elementwise_mul(ray_color_recursive(res->scattered, depth - 1, max_depth));
+			}
+			stats::count_termination(stats::Termination::absorbed);
+			return emitted;
+		}
+		else {
+			stats::count_termination(stats::Termination::escaped);
+			return background_color(ray);
+		}
+	}
+
+	//follows the path carrying product of attenuations, after russian_roulette_depth bounces
+	//paths survive with probability equal to their largest throughput component and are reweighted to stay unbiased
+	//random streams are keyed by remaining depth like in ray_color_recursive, so without roulette and light sampling
+	//both follow the same paths
+	Color ray_color(const Ray& ray, const RenderSettings& settings) const {
+		if (settings.max_depth <= 0) return { 0.0, 0.0, 0.0 };
+
+		utils::sampler.start_bounce(settings.max_depth);
+		stats::count_rays(0);
+		return ray_color(ray, scene.intersect(ray, 0, std::numeric_limits<Scalar>::infinity()), settings);
+	}
+
+	//continues path whose first ray was already intersected (camera rays traced in packets),
+	//random stream of the first bounce has to be started by the caller
+	Color ray_color(Ray ray, std::optional<HitRecord> hit, const RenderSettings& settings) const {
+		Color throughput{ 1.0, 1.0, 1.0 };
+		Color color{ 0.0, 0.0, 0.0 };
+		Scalar bsdf_pdf = 0;
+
+		for (int bounce = 0; bounce < settings.max_depth;) {
+			if (!hit) {
+				stats::count_termination(stats::Termination::escaped);
+				return color + throughput.elementwise_mul(background_color(ray));
+			}
+
+			const auto res = materials.visit(hit->material, [&](const auto& material) {
+				return shade(material, ray, *hit, bsdf_pdf, throughput, color, settings);
+			});
+			if (!res) {
+				stats::count_termination(stats::Termination::absorbed);
+				break;
+			}
+
+			throughput = throughput.elementwise_mul(res->attenuation);
+			bsdf_pdf = res->pdf;
+
+			if (bounce + 1 >= settings.russian_roulette_depth) {
+				const auto survival = std::min(std::max({ throughput.x(), throughput.y(), throughput.z() }), Scalar(0.95));
+				if (utils::sampler.get_1d() >= survival) {
+					stats::count_termination(stats::Termination::roulette);
+					break;
+				}
+				throughput /= survival;
+			}
+
+			ray = res->scattered;
+			if (++bounce == settings.max_depth) {
+				stats::count_termination(stats::Termination::max_depth);
+				break;
+			}
+
+			utils::sampler.start_bounce(settings.max_depth - bounce);
+			stats::count_rays(bounce);
+			hit = scene.intersect(ray, 0, std::numeric_limits<Scalar>::infinity());
+		}
+
+		return color;
+	}
+
+	//wavefront renders whole batches of paths, single samples (e.g. adaptive sampling) use iterative
+	Color sample_color(const Ray& ray, const RenderSettings& settings) const {
+		switch (settings.integrator) {
+		case Integrator::recursive:
+			return ray_color_recursive(ray, settings.max_depth, settings.max_depth);
+		default:
+			return ray_color(ray, settings);
+		}
+	}
+
+public:
+	//paths in flight in wavefront engine, stages split them into chunks of wavefront_chunk_size for pool workers
+	static constexpr uint64_t wavefront_batch_size = 1 << 20;
+	static constexpr uint64_t wavefront_chunk_size = 4096;
+
+	Scene<Hs...> scene;
+	MaterialList<Ms...> materials;
+	LightList lights;
+
+	//builds the scene and the list of lights - spheres of emissive materials, which are sampled at diffuse hits
+	//other emitters are still found by scattered rays, just without the help of light sampling
+	void build() {
+		scene.build();
+		build_lights();
+	}
+
+	//only the list of lights, for scenes whose BVHs were not built here (see SceneFile.h)
+	void build_lights() {
+		lights.clear();
+		if constexpr (utils::is_in_pack_v<Sphere, Hs...>) {
+			for (const auto& sphere : scene.template objects_of_type<Sphere>()) {
+				const auto radiance = materials.radiance(sphere.material());
+				if (radiance && sphere.radius() > 0) lights.add(sphere.center(), sphere.radius(), *radiance, sphere.material());
+			}
+		}
+		lights.build();
+	}
+
+	//starts the sample, its first dimensions are position in the pixel and on the lens
+	static Ray camera_ray(const Camera& camera, const SamplePattern& pattern, uint64_t y, uint64_t x, uint64_t sample) {
+		utils::sampler.start_sample(pattern, y * pattern.width + x, sample);
+
+		const auto [u, v] = utils::sampler.get_2d();
+		const auto h = static_cast<Scalar>((x + u) / (pattern.width - 1));
+		const auto w = static_cast<Scalar>((pattern.height - y + v) / (pattern.height - 1));
+
+		return camera.get_ray(h, w);
+	}
+
+	static SamplePattern sample_pattern(uint64_t height, uint64_t width, const RenderSettings& settings) noexcept {
+		return { settings.sampler, height, width, static_cast<uint64_t>(std::max(settings.samples_per_pixel, 1)), settings.seed };
+	}
+
+	Color pixel_sample(const Camera& camera, const SamplePattern& pattern, uint64_t y, uint64_t x, uint64_t sample, const RenderSettings& settings) const {
+		return sample_color(camera_ray(camera, pattern, y, x, sample), settings);
+	}
+
+	//renders a tile by blocks of RayPacket::side x RayPacket::side pixels, camera rays of each sample are traced as one packet
+	//and paths continue ray by ray, random streams are the same as in pixel_sample, so the image is identical
+	void render_packets(const Camera& camera, const SamplePattern& pattern, const Tile& tile, Frame::TileView& view, const RenderSettings& settings) const {
+		constexpr auto side = RayPacket::side;
+		std::array<Color, RayPacket::size> colors;
+		std::array<std::optional<HitRecord>, RayPacket::size> hits;
+
+		for (uint64_t block_y = 0; block_y < tile.height; block_y += side) {
+			for (uint64_t block_x = 0; block_x < tile.width; block_x += side) {
+				const auto block_height = std::min<uint64_t>(side, tile.height - block_y);
+				const auto block_width = std::min<uint64_t>(side, tile.width - block_x);
+				colors.fill({});
+
+				for (int sample = 0; sample < settings.samples_per_pixel; ++sample) {
+					RayPacket packet;
+					for (uint64_t y = 0; y < block_height; ++y) {
+						for (uint64_t x = 0; x < block_width; ++x) {
+							const auto ray = camera_ray(camera, pattern, tile.y + block_y + y, tile.x + block_x + x, sample);
+							packet.set(static_cast<uint32_t>(y * side + x), ray);
+						}
+					}
+
+					stats::count_rays(0, static_cast<uint64_t>(std::popcount(packet.active)));
+					scene.intersect(packet, 0, std::numeric_limits<Scalar>::infinity(), hits);
+
+					for (auto lanes = packet.active; lanes; lanes &= lanes - 1) {
+						const auto lane = std::countr_zero(lanes);
+						utils::sampler.start_sample(pattern, (tile.y + block_y + lane / side) * pattern.width + tile.x + block_x + lane % side, sample);
+						utils::sampler.start_bounce(settings.max_depth);
+						colors[lane] += ray_color(packet.ray(lane), hits[lane], settings);
+					}
+				}
+
+				for (uint64_t y = 0; y < block_height; ++y) {
+					for (uint64_t x = 0; x < block_width; ++x) {
+						view.set_pixel(block_y + y, block_x + x, colors[y * side + x] / settings.samples_per_pixel);
+					}
+				}
+			}
+		}
+	}
+
+	//calls f(tile) for every tile of the frame on pool workers
+	template <typename F>
+	static void for_each_tile(ThreadPool& pool, uint64_t height, uint64_t width, const RenderSettings& settings, F&& f) {
+		const auto tile_size = settings.tile_size;
+		const auto tiles_x = (width + tile_size - 1) / tile_size;
+		const auto tiles_y = (height + tile_size - 1) / tile_size;
+		const auto tile_count = tiles_x * tiles_y;
+
+		ProgressReporter progress{ "tiles", tile_count, settings.report_progress };
+
+		pool.parallel_for(tile_count, [&](size_t index) {
+			Tile tile;
+			tile.x = index % tiles_x * tile_size;
+			tile.y = index / tiles_x * tile_size;
+			tile.width = std::min(tile.x + tile_size, width) - tile.x;
+			tile.height = std::min(tile.y + tile_size, height) - tile.y;
+
+			f(tile);
+			progress.advance();
+		});
+	}
+
+	//calls f(y, x) for every pixel, tile by tile
+	template <typename F>
+	static void for_each_pixel(ThreadPool& pool, uint64_t height, uint64_t width, const RenderSettings& settings, F&& f) {
+		for_each_tile(pool, height, width, settings, [&](const Tile& tile) {
+			for (auto y = tile.y; y < tile.y + tile.height; ++y) {
+				for (auto x = tile.x; x < tile.x + tile.width; ++x) {
+					f(y, x);
+				}
+			}
+		});
+	}
+
+	//splits the frame into tiles rendered by pool workers, each writes only its own view of the frame
+	//random streams are keyed by pixel and sample, so the image does not depend on the thread count or scheduling
+	Frame render(const Camera& camera, const uint64_t height, const uint64_t width, const RenderSettings& settings, ThreadPool& pool) const {
+		return render_with_stats(camera, height, width, settings, pool).image;
+	}
+
+	//render together with counters of its rays, which are reset when it starts, see Stats.h
+	StatsRender render_with_stats(const Camera& camera, const uint64_t height, const uint64_t width, const RenderSettings& settings, ThreadPool& pool) const {
+		using clock = std::chrono::steady_clock;
+		stats::reset();
+		const auto start = clock::now();
+
+		uint64_t samples = height * width * static_cast<uint64_t>(std::max(settings.samples_per_pixel, 0));
+		auto image = [&] {
+			if (settings.adaptive.enabled) {
+				stats::StageTimer timer{ stats::Stage::tracing };
+				auto adaptive = render_adaptive(camera, height, width, settings, pool);
+				samples = adaptive.total_samples;
+				return std::move(adaptive.image);
+			}
+			if (settings.integrator == Integrator::wavefront) return render_wavefront(camera, height, width, settings, pool).image;
+
+			stats::StageTimer timer{ stats::Stage::tracing };
+			return render_tiles(camera, height, width, settings, pool);
+		}();
+
+		RenderStats report;
+		report.seconds = std::chrono::duration<double>(clock::now() - start).count();
+		report.height = height;
+		report.width = width;
+		report.samples = samples;
+		report.material_types = sizeof...(Ms);
+		report.counters = stats::collect();
+		return { std::move(image), report };
+	}
+
+	//tiles traced path by path (or with packets of camera rays), without statistics being reset
+	Frame render_tiles(const Camera& camera, const uint64_t height, const uint64_t width, const RenderSettings& settings, ThreadPool& pool) const {
+		Frame frame{ height, width, settings.pixel_format };
+		render_tiles(camera, frame, settings, pool);
+		return frame;
+	}
+
+	//renders into all pixels of an existing frame, so that its memory can be reused (e.g. by frames of an animation)
+	void render_tiles(const Camera& camera, Frame& frame, const RenderSettings& settings, ThreadPool& pool) const {
+		const auto height = frame.height();
+		const auto width = frame.width();
+		const auto pattern = sample_pattern(height, width, settings);
+
+		for_each_tile(pool, height, width, settings, [&](const Tile& tile) {
+			auto view = frame.view(tile);
+			if (settings.packet_primary_rays && settings.integrator == Integrator::iterative) {
+				render_packets(camera, pattern, tile, view, settings);
+				return;
+			}
+
+			for (uint64_t y = 0; y < tile.height; ++y) {
+				for (uint64_t x = 0; x < tile.width; ++x) {
+					Color color{};
+					for (int i = 0; i < settings.samples_per_pixel; ++i) {
+						color += pixel_sample(camera, pattern, tile.y + y, tile.x + x, i, settings);
+					}
+					view.set_pixel(y, x, color / settings.samples_per_pixel);
+				}
+			}
+		});
+	}
+
+	//sums of samples [first, last) of the tile's pixels, row by row, rows are rendered by pool workers
+	//sums of one range over all samples divided by samples_per_pixel are the pixels of render, see Distributed.h
+	std::vector<Color> render_tile_sums(const Camera& camera, const uint64_t height, const uint64_t width, const Tile& tile, int first, int last, const RenderSettings& settings, ThreadPool& pool) const {
+		std::vector<Color> sums(tile.height * tile.width);
+		const auto pattern = sample_pattern(height, width, settings);
+
+		pool.parallel_for(tile.height, [&](size_t y) {
+			for (uint64_t x = 0; x < tile.width; ++x) {
+				auto& sum = sums[y * tile.width + x];
+				for (int i = first; i < last; ++i) {
+					sum += pixel_sample(camera, pattern, tile.y + y, tile.x + x, i, settings);
+				}
+			}
+		});
+
+		return sums;
+	}
+
+	//calls f(begin, end) for chunks of [0, count) on pool workers
+	template <typename F>
+	static void for_each_chunk(ThreadPool& pool, size_t count, F&& f) {
+		const auto chunk_count = (count + wavefront_chunk_size - 1) / wavefront_chunk_size;
+		pool.parallel_for(chunk_count, [&](size_t chunk) {
+			f(chunk * wavefront_chunk_size, std::min(count, (chunk + 1) * wavefront_chunk_size));
+		});
+	}
+
+	//Stream engine - instead of following one path to the end, a batch of up to wavefront_batch_size paths
+	//goes through separate stages: generation of camera rays, intersection, shading grouped by material
+	//and compaction of terminated paths, then the next bounce. Paths add the light they gather to their slot of batch results,
+	//which are accumulated per pixel once the batch is done.
+	//Uses the same random streams and summation order as ray_color, so the image is identical.
+	WavefrontRender render_wavefront(const Camera& camera, const uint64_t height, const uint64_t width, const RenderSettings& settings, ThreadPool& pool) const {
+		const auto pixel_count = height * width;
+		const auto samples_per_pixel = static_cast<uint64_t>(std::max(settings.samples_per_pixel, 1));
+		const auto chunk_samples = std::clamp<uint64_t>(wavefront_batch_size / std::max<uint64_t>(pixel_count, 1), 1, samples_per_pixel);
+		const auto batch_pixels = std::min(pixel_count, wavefront_batch_size);
+
+		WavefrontRender result{ Frame{ height, width, settings.pixel_format } };
+		const auto pattern = sample_pattern(height, width, settings);
+		std::vector<Color> sums(pixel_count);
+
+		PathQueue queue, compacted;
+		std::vector<HitRecord> hits;
+		std::vector<uint8_t> alive;
+		std::vector<Color> results;
+		std::vector<size_t> live_offsets;
+
+		ProgressReporter progress{ "paths", pixel_count * samples_per_pixel, settings.report_progress };
+
+		for (uint64_t first_sample = 0; first_sample < samples_per_pixel; first_sample += chunk_samples) {
+			const auto samples = std::min(chunk_samples, samples_per_pixel - first_sample);
+
+			for (uint64_t first_pixel = 0; first_pixel < pixel_count; first_pixel += batch_pixels) {
+				const auto pixels = std::min(batch_pixels, pixel_count - first_pixel);
+				const auto path_count = pixels * samples;
+
+				//generation
+				std::optional<stats::StageTimer> timer{ std::in_place, stats::Stage::generation };
+				queue.resize(path_count);
+				results.assign(path_count, Color{});
+				for_each_chunk(pool, path_count, [&](size_t begin, size_t end) {
+					for (auto i = begin; i < end; ++i) {
+						const auto pixel = first_pixel + i / samples;
+						const auto sample = first_sample + i % samples;
+						const auto y = pixel / width;
+						const auto x = pixel % width;
+
+						queue.set_ray(i, camera_ray(camera, pattern, y, x, sample));
+						queue.throughputs[i] = { 1.0, 1.0, 1.0 };
+						queue.pixels[i] = static_cast<uint32_t>(pixel);
+						queue.samples[i] = static_cast<uint32_t>(sample);
+						queue.slots[i] = static_cast<uint32_t>(i);
+						queue.pdfs[i] = 0;
+					}
+				});
+
+				for (int bounce = 0; bounce < settings.max_depth && queue.size() > 0; ++bounce) {
+					const auto size = queue.size();
+					result.rays += size;
+					stats::count_rays(bounce, size);
+					hits.resize(size);
+					alive.resize(size);
+
+					//intersection, missed paths are finished with background
+					timer.emplace(stats::Stage::intersection);
+					for_each_chunk(pool, size, [&](size_t begin, size_t end) {
+						for (auto i = begin; i < end; ++i) {
+							const auto ray = queue.ray(i);
+							const auto hit = scene.intersect(ray, 0, std::numeric_limits<Scalar>::infinity());
+							alive[i] = hit.has_value();
+							if (hit) hits[i] = *hit;
+							else {
+								results[queue.slots[i]] += queue.throughputs[i].elementwise_mul(background_color(ray));
+								stats::count_termination(stats::Termination::escaped);
+							}
+						}
+					});
+
+					//shading, hits of a chunk are grouped by material type
+					timer.emplace(stats::Stage::shading);
+					for_each_chunk(pool, size, [&](size_t begin, size_t end) {
+						static thread_local std::vector<uint32_t> live, order;
+						static thread_local std::vector<MaterialIndex> live_materials;
+						live.clear();
+						live_materials.clear();
+						for (auto i = begin; i < end; ++i) {
+							if (!alive[i]) continue;
+							live.push_back(static_cast<uint32_t>(i));
+							live_materials.push_back(hits[i].material);
+						}
+
+						materials.for_each_sorted(live_materials, order, [&](uint32_t k, const auto& material) {
+							const auto i = live[k];
+							utils::sampler.start_sample(pattern, queue.pixels[i], queue.samples[i]);
+							utils::sampler.start_bounce(settings.max_depth - bounce);
+
+							auto& throughput = queue.throughputs[i];
+							const auto res = shade(material, queue.ray(i), hits[i], queue.pdfs[i], throughput, results[queue.slots[i]], settings);
+							if (!res) {
+								alive[i] = false;
+								stats::count_termination(stats::Termination::absorbed);
+								return;
+							}
+
+							throughput = throughput.elementwise_mul(res->attenuation);
+							queue.pdfs[i] = res->pdf;
+
+							if (bounce + 1 >= settings.russian_roulette_depth) {
+								const auto survival = std::min(std::max({ throughput.x(), throughput.y(), throughput.z() }), Scalar(0.95));
+								if (utils::sampler.get_1d() >= survival) {
+									alive[i] = false;
+									stats::count_termination(stats::Termination::roulette);
+									return;
+								}
+								throughput /= survival;
+							}
+
+							queue.set_ray(i, res->scattered);
+						});
+					});
+
+					//compaction, chunks count their live paths and copy them to offsets given by prefix sum
+					timer.emplace(stats::Stage::compaction);
+					const auto chunk_count = (size + wavefront_chunk_size - 1) / wavefront_chunk_size;
+					live_offsets.assign(chunk_count + 1, 0);
+					for_each_chunk(pool, size, [&](size_t begin, size_t end) {
+						live_offsets[begin / wavefront_chunk_size + 1] = std::count(alive.begin() + begin, alive.begin() + end, uint8_t{ 1 });
+					});
+					std::partial_sum(live_offsets.begin(), live_offsets.end(), live_offsets.begin());
+
+					compacted.resize(live_offsets.back());
+					for_each_chunk(pool, size, [&](size_t begin, size_t end) {
+						auto j = live_offsets[begin / wavefront_chunk_size];
+						for (auto i = begin; i < end; ++i) {
+							if (alive[i]) queue.copy_to(i, compacted, j++);
+						}
+					});
+					std::swap(queue, compacted);
+				}
+				stats::count_termination(stats::Termination::max_depth, queue.size());
+				queue.resize(0);
+
+				//accumulation, samples of a pixel are summed in order
+				timer.emplace(stats::Stage::accumulation);
+				for_each_chunk(pool, pixels, [&](size_t begin, size_t end) {
+					for (auto p = begin; p < end; ++p) {
+						for (uint64_t s = 0; s < samples; ++s) sums[first_pixel + p] += results[p * samples + s];
+					}
+				});
+				timer.reset();
+				progress.advance(path_count);
+			}
+		}
+
+		stats::StageTimer timer{ stats::Stage::accumulation };
+		for_each_chunk(pool, pixel_count, [&](size_t begin, size_t end) {
+			for (auto p = begin; p < end; ++p) {
+				result.image.set_pixel(p / width, p % width, sums[p] / settings.samples_per_pixel);
+			}
+		});
+		return result;
+	}
+
+	//hash of settings which decide what samples a render takes, scene and camera are left to the caller
+	[[nodiscard]]
+	static uint64_t checkpoint_key(const RenderSettings& settings) noexcept {
+		uint64_t key = 14695981039346656037u;
+		auto mix = [&](auto value) {
+			for (auto byte : std::bit_cast<std::array<unsigned char, sizeof(value)>>(value)) key = (key ^ byte) * 1099511628211u;
+		};
+		mix(settings.samples_per_pixel);
+		mix(settings.max_depth);
+		mix(settings.russian_roulette_depth);
+		mix(settings.integrator);
+		mix(settings.sampler);
+		mix(settings.seed);
+		mix(settings.sample_lights);
+		mix(settings.adaptive.min_samples);
+		mix(settings.adaptive.batch_size);
+		mix(settings.adaptive.threshold);
+		mix(settings.adaptive.sample_budget);
+		mix(settings.progressive.pass_samples);
+		return key;
+	}
+
+	//checkpoint was saved by render of the same kind, size and settings, so it can be resumed by it
+	[[nodiscard]]
+	static bool resumable(const Checkpoint& checkpoint, Checkpoint::Mode mode, const uint64_t height, const uint64_t width, const RenderSettings& settings) noexcept {
+		return checkpoint.mode == mode && checkpoint.height == height && checkpoint.width == width
+			&& checkpoint.pixels.size() == height * width && checkpoint.key == checkpoint_key(settings);
+	}
+
+	//every pixel takes min_samples, then passes add batch_size samples to pixels whose error is still above threshold
+	//until all of them converge, reach samples_per_pixel or the budget runs out
+	//with budget, each pass samples only the noisiest pixels, as many as the remaining budget allows
+	//a resumable checkpoint of an interrupted render continues it to the same image (other checkpoints are ignored)
+	AdaptiveRender render_adaptive(const Camera& camera, const uint64_t height, const uint64_t width, const RenderSettings& settings, ThreadPool& pool, const Checkpoint* resume = nullptr) const {
+		const auto& adaptive = settings.adaptive;
+		const auto pixel_count = height * width;
+		const auto max_samples = static_cast<uint32_t>(std::max(settings.samples_per_pixel, 1));
+		const auto min_samples = std::min(static_cast<uint32_t>(std::max(adaptive.min_samples, 2)), max_samples);
+		const auto batch_size = static_cast<uint32_t>(std::max(adaptive.batch_size, 1));
+
+		std::vector<PixelStatistics> statistics(pixel_count);
+		const auto pattern = sample_pattern(height, width, settings);
+
+		//progress is counted in samples up to the most the render may take, it ends sooner when pixels converge
+		auto pass_settings = settings;
+		pass_settings.report_progress = false;
+		const auto sample_limit = pixel_count * max_samples;
+		ProgressReporter progress{ "samples", adaptive.sample_budget > 0 ? std::min(adaptive.sample_budget, sample_limit) : sample_limit, settings.report_progress };
+
+		auto add_samples = [&](uint64_t pixel, uint32_t count) {
+			auto& s = statistics[pixel];
+			const auto y = pixel / width;
+			const auto x = pixel % width;
+			for (uint32_t i = 0; i < count; ++i) {
+				s.add(pixel_sample(camera, pattern, y, x, s.samples, settings));
+			}
+			progress.advance(count);
+		};
+
+		uint64_t total_samples = 0;
+		std::optional<CheckpointWriter> writer;
+		if (!settings.checkpoint.path.empty()) writer.emplace(settings.checkpoint.path, settings.checkpoint.interval);
+		auto checkpoint = [&](uint64_t passes, bool finished) {
+			if (writer && (finished || writer->due())) {
+				writer->write({ Checkpoint::Mode::adaptive, checkpoint_key(settings), height, width, passes, total_samples, statistics });
+			}
+		};
+
+		uint64_t pass = 1;
+		if (resume && resumable(*resume, Checkpoint::Mode::adaptive, height, width, settings)) {
+			statistics = resume->pixels;
+			total_samples = resume->total_samples;
+			pass = resume->passes + 1;
+			progress.advance(total_samples);
+		}
+		else {
+			for_each_pixel(pool, height, width, pass_settings, [&](uint64_t y, uint64_t x) {
+				add_samples(y * width + x, min_samples);
+			});
+			total_samples = pixel_count * min_samples;
+			checkpoint(0, false);
+		}
+
+		std::vector<uint64_t> active;
+		std::vector<double> errors(pixel_count);
+
+		for (; ; ++pass) {
+			active.clear();
+			for (uint64_t p = 0; p < pixel_count; ++p) {
+				if (statistics[p].samples >= max_samples) continue;
+				errors[p] = statistics[p].error();
+				if (errors[p] > adaptive.threshold) active.push_back(p);
+			}
+
+			if (adaptive.sample_budget > 0) {
+				const auto remaining = adaptive.sample_budget > total_samples ? adaptive.sample_budget - total_samples : 0;
+				//only the noisiest quarter is sampled in one pass, so errors are reestimated before the rest of the budget is spent
+				const auto selected = std::min<uint64_t>(remaining / batch_size, active.size() / 4 + 1);
+				if (active.size() > selected) {
+					std::partial_sort(active.begin(), active.begin() + selected, active.end(), [&](uint64_t a, uint64_t b) {
+						return errors[a] != errors[b] ? errors[a] > errors[b] : a < b;
+					});
+					active.resize(selected);
+					std::sort(active.begin(), active.end());
+				}
+			}
+
+			if (active.empty()) break;
+
+			for (auto p : active) {
+				total_samples += std::min(batch_size, max_samples - statistics[p].samples);
+			}
+
+			const size_t chunk_size = 256;
+			pool.parallel_for((active.size() + chunk_size - 1) / chunk_size, [&](size_t chunk) {
+				const auto end = std::min(active.size(), (chunk + 1) * chunk_size);
+				for (auto i = chunk * chunk_size; i < end; ++i) {
+					add_samples(active[i], std::min(batch_size, max_samples - statistics[active[i]].samples));
+				}
+			});
+			checkpoint(pass, false);
+		}
+		checkpoint(pass - 1, true);
+		progress.complete();
+
+		AdaptiveRender result{ Frame{ height, width, settings.pixel_format }, std::vector<uint32_t>(pixel_count), total_samples };
+		for (uint64_t p = 0; p < pixel_count; ++p) {
+			result.image.set_pixel(p / width, p % width, statistics[p].mean());
+			result.sample_counts[p] = statistics[p].samples;
+		}
+		return result;
+	}
+
+	//renders passes of pass_samples over the whole frame into accumulation buffer until samples_per_pixel is reached
+	//or time budget runs out, snapshot is called after every pass
+	//pixels sum samples in the same order as in render, so reaching samples_per_pixel gives the same image
+	//a resumable checkpoint continues from its sums, as if the render had not been interrupted
+	Frame render_progressive(const Camera& camera, const uint64_t height, const uint64_t width, const RenderSettings& settings, ThreadPool& pool, const SnapshotCallback& snapshot = {}, const Checkpoint* resume = nullptr) const {
+		using clock = std::chrono::steady_clock;
+		const auto start = clock::now();
+		const auto elapsed = [&] { return std::chrono::duration<double>(clock::now() - start).count(); };
+
+		const auto& progressive = settings.progressive;
+		const auto target_samples = std::max(settings.samples_per_pixel, 1);
+		const auto pass_samples = std::max(progressive.pass_samples, 1);
+
+		auto tile_settings = settings;
+		tile_settings.report_progress = false;
+
+		const auto pixel_count = height * width;
+		std::vector<Color> accumulated(pixel_count);
+		Frame frame{ height, width, settings.pixel_format };
+		const auto pattern = sample_pattern(height, width, settings);
+		int samples = 0;
+		uint64_t passes = 0;
+		double last_pass_time = 0;
+		//in samples per pixel, a time budget may end the render sooner
+		ProgressReporter progress{ "samples per pixel", uint64_t(target_samples), settings.report_progress };
+
+		//checkpoints keep only sums, luminance moments are not needed by progressive passes
+		std::optional<CheckpointWriter> writer;
+		if (!settings.checkpoint.path.empty()) writer.emplace(settings.checkpoint.path, settings.checkpoint.interval);
+		auto checkpoint = [&](bool finished) {
+			if (!writer || !(finished || writer->due())) return;
+			Checkpoint state{ Checkpoint::Mode::progressive, checkpoint_key(settings), height, width, passes, pixel_count * samples, {} };
+			state.pixels.resize(pixel_count);
+			for (uint64_t p = 0; p < pixel_count; ++p) {
+				state.pixels[p].sum = accumulated[p];
+				state.pixels[p].samples = static_cast<uint32_t>(samples);
+			}
+			writer->write(std::move(state));
+		};
+
+		if (resume && resumable(*resume, Checkpoint::Mode::progressive, height, width, settings) && pixel_count > 0) {
+			passes = resume->passes;
+			samples = static_cast<int>(resume->total_samples / pixel_count);
+			for (uint64_t p = 0; p < pixel_count; ++p) {
+				accumulated[p] = resume->pixels[p].sum;
+				if (samples > 0) frame.set_pixel(p / width, p % width, accumulated[p] / samples);
+			}
+			progress.advance(uint64_t(samples));
+		}
+
+		while (samples < target_samples) {
+			if (progressive.time_budget > 0 && samples > 0 && elapsed() + last_pass_time > progressive.time_budget) break;
+
+			const auto pass_start = elapsed();
+			const auto first = samples;
+			const auto last = std::min(samples + pass_samples, target_samples);
+
+			for_each_pixel(pool, height, width, tile_settings, [&](uint64_t y, uint64_t x) {
+				auto& sum = accumulated[y * width + x];
+				for (int i = first; i < last; ++i) {
+					sum += pixel_sample(camera, pattern, y, x, i, settings);
+				}
+				frame.set_pixel(y, x, sum / last);
+			});
+
+			samples = last;
+			++passes;
+			last_pass_time = elapsed() - pass_start;
+			checkpoint(false);
+			progress.advance(uint64_t(last - first));
+
+			if (snapshot) snapshot(frame, samples);
+		}
+		checkpoint(true);
+		progress.complete();
+
+		return frame;
+	}
+
+	Frame render(const Camera& camera, const uint64_t height, const uint64_t width, const RenderSettings& settings = {}) const {
+		ThreadPool pool{ settings.thread_count };
+		return render(camera, height, width, settings, pool);
+	}
+};
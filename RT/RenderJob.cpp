@@ -0,0 +1,167 @@
+#include "RenderJob.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <tuple>
+#include <utility>
+
+std::optional<RenderJob> parse_job(std::span<const std::string_view> arguments, std::ostream& errors) {
+	if (arguments.empty() || arguments[0].starts_with("--")) {
+		errors << "expected scene file\n";
+		return {};
+	}
+
+	RenderJob job;
+	job.scene = arguments[0];
+	for (size_t i = 1; i < arguments.size(); ++i) {
+		const auto option = arguments[i];
+		if (option == "--adaptive") {
+			job.adaptive = true;
+			continue;
+		}
+		if (i + 1 == arguments.size()) {
+			errors << "missing value of " << option << '\n';
+			return {};
+		}
+
+		const auto value = arguments[++i];
+		bool valid = true;
+		auto positive = [&]<typename T>(std::optional<T>& field) {
+			T number{};
+			valid = utils::parse_number(value, number) && number > 0;
+			field = number;
+		};
+
+		if (option == "--output") job.output = value;
+		else if (option == "--width") positive(job.width);
+		else if (option == "--height") positive(job.height);
+		else if (option == "--spp") positive(job.samples_per_pixel);
+		else if (option == "--depth") positive(job.max_depth);
+		else if (option == "--threads") positive(job.thread_count);
+		else if (option == "--seed") {
+			uint64_t seed = 0;
+			valid = utils::parse_number(value, seed);
+			job.seed = seed;
+		}
+		else if (option == "--budget") valid = utils::parse_number(value, job.time_budget) && job.time_budget > 0;
+		else {
+			errors << "unknown option " << option << '\n';
+			return {};
+		}
+
+		if (!valid) {
+			errors << "invalid value " << value << " of " << option << '\n';
+			return {};
+		}
+	}
+	return job;
+}
+
+std::optional<std::vector<RenderJob>> read_manifest(const char* filename, std::ostream& errors) {
+	std::ifstream in{ filename, std::ios::binary };
+	if (!in) {
+		errors << "cannot read " << filename << '\n';
+		return {};
+	}
+	const std::string text{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+	//paths of scenes and images are relative to the manifest
+	const auto directory = std::filesystem::path{ filename }.parent_path();
+
+	std::vector<RenderJob> jobs;
+	size_t line_number = 0;
+	std::string_view rest{ text };
+	while (!rest.empty()) {
+		const auto end = rest.find('\n');
+		const auto words = utils::split_words(rest.substr(0, end));
+		rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+		++line_number;
+		if (words.empty()) continue;
+
+		std::ostringstream message;
+		auto job = parse_job(words, message);
+		if (job && job->thread_count) message << "threads are set for the whole batch\n";
+		if (!job || job->thread_count) {
+			errors << filename << ':' << line_number << ": " << message.str();
+			return {};
+		}
+
+		job->scene = (directory / job->scene).string();
+		job->output = (directory / job->output).string();
+		jobs.push_back(std::move(*job));
+	}
+	return jobs;
+}
+
+std::pair<uint64_t, uint64_t> image_size(const RenderJob& job, const SceneDescription& description) noexcept {
+	auto height = job.height.value_or(description.height);
+	auto width = job.width.value_or(description.width);
+	if (job.width && !job.height) height = std::max<uint64_t>(1, (*job.width * description.height + description.width / 2) / description.width);
+	if (job.height && !job.width) width = std::max<uint64_t>(1, (*job.height * description.width + description.height / 2) / description.height);
+	return { height, width };
+}
+
+std::optional<JobReport> JobRunner::run(const RenderJob& job, std::ostream& errors) {
+	using clock = std::chrono::steady_clock;
+	const auto seconds_since = [](clock::time_point start) { return std::chrono::duration<double>(clock::now() - start).count(); };
+
+	JobReport report;
+	auto& scene = scenes_[job.scene];
+	if (!scene) {
+		const auto load_start = clock::now();
+		auto loaded = std::make_unique<LoadedScene>();
+		const auto description = std::filesystem::path{ job.scene }.extension() == ".rtscene"
+			? load_scene(job.scene.c_str(), loaded->RT)
+			: read_scene_text(job.scene.c_str(), loaded->RT, errors);
+		if (!description) {
+			errors << "cannot load scene " << job.scene << '\n';
+			scenes_.erase(job.scene);
+			return {};
+		}
+		loaded->description = *description;
+		scene = std::move(loaded);
+		report.load_seconds = seconds_since(load_start);
+	}
+
+	const auto& description = scene->description;
+	std::tie(report.height, report.width) = image_size(job, description);
+
+	auto settings = description.settings;
+	if (job.samples_per_pixel) settings.samples_per_pixel = *job.samples_per_pixel;
+	if (job.max_depth) settings.max_depth = *job.max_depth;
+	if (job.seed) settings.seed = *job.seed;
+	settings.adaptive.enabled = job.adaptive;
+	settings.progressive.time_budget = job.time_budget;
+	settings.thread_count = pool_.size();
+	settings.report_progress = report_progress_;
+
+	const auto camera = description.camera.camera(Scalar(report.width) / report.height);
+	const auto render_start = clock::now();
+	const auto image = [&] {
+		if (job.time_budget > 0) {
+			int samples = 0;
+			auto frame = scene->RT.render_progressive(camera, report.height, report.width, settings, pool_, [&](const Frame&, int samples_per_pixel) {
+				samples = samples_per_pixel;
+			});
+			report.total_samples = uint64_t(samples) * report.height * report.width;
+			return frame;
+		}
+		if (job.adaptive) {
+			auto result = scene->RT.render_adaptive(camera, report.height, report.width, settings, pool_);
+			report.total_samples = result.total_samples;
+			return std::move(result.image);
+		}
+		report.total_samples = uint64_t(std::max(settings.samples_per_pixel, 1)) * report.height * report.width;
+		return scene->RT.render(camera, report.height, report.width, settings, pool_);
+	}();
+	report.render_seconds = seconds_since(render_start);
+
+	if (!image.save(job.output.c_str())) {
+		errors << "cannot write " << job.output << '\n';
+		return {};
+	}
+	return report;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "SceneFile.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//Renders of scene files set up at runtime, one from the command line (RT render) or many from a manifest (RT batch).
+//Options left out come from the scene file, see SceneDescription.
+
+struct RenderJob {
+	std::string scene;              //scene file, other than .rtscene ones are text scenes compiled when loaded
+	std::string output = "out.ppm"; //format by extension, see Frame::save
+	std::optional<uint64_t> width;  //with only one of width and height, the other keeps aspect ratio of the scene
+	std::optional<uint64_t> height;
+	std::optional<int> samples_per_pixel;
+	std::optional<int> max_depth;
+	std::optional<uint64_t> seed;
+	std::optional<size_t> thread_count;
+	double time_budget = 0;         //in seconds, if not 0 the render is progressive, samples_per_pixel is then its limit
+	bool adaptive = false;
+};
+
+//<scene> [--output file] [--width n] [--height n] [--spp n] [--depth n] [--seed n] [--threads n] [--budget seconds] [--adaptive]
+//empty if an option is unknown or its value is invalid, which is reported to errors
+[[nodiscard]]
+std::optional<RenderJob> parse_job(std::span<const std::string_view> arguments, std::ostream& errors);
+
+//jobs of the manifest, one per line with arguments of parse_job, # starts a comment
+//threads are set for the whole batch, so jobs cannot have them
+[[nodiscard]]
+std::optional<std::vector<RenderJob>> read_manifest(const char* filename, std::ostream& errors);
+
+//height and width of the image of job rendering a scene of description, options left out come from description
+[[nodiscard]]
+std::pair<uint64_t, uint64_t> image_size(const RenderJob& job, const SceneDescription& description) noexcept;
+
+struct JobReport {
+	uint64_t height = 0;
+	uint64_t width = 0;
+	uint64_t total_samples = 0;
+	double load_seconds = 0;        //0 if the scene was loaded by an earlier job
+	double render_seconds = 0;
+};
+
+//Runs jobs one after another on one pool. Scenes are loaded by the first job which renders them and kept
+//for the following ones, so a batch pays neither process startup nor scene load and build per job.
+class JobRunner {
+	struct LoadedScene {
+		DefaultRayTracer RT{};
+		SceneDescription description;
+	};
+
+	ThreadPool& pool_;
+	bool report_progress_;
+	std::unordered_map<std::string, std::unique_ptr<const LoadedScene>> scenes_;
+
+public:
+	JobRunner(ThreadPool& pool, bool report_progress) : pool_{ pool }, report_progress_{ report_progress } {}
+
+	//renders the job with threads of the pool and writes its image, empty if the scene cannot be loaded
+	//or the image written, which is reported to errors
+	[[nodiscard]]
+	std::optional<JobReport> run(const RenderJob& job, std::ostream& errors);
+
+	[[nodiscard]]
+	size_t scene_count() const noexcept {
+		return scenes_.size();
+	}
+};
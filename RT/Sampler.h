@@ -0,0 +1,292 @@
+#pragma once
+
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+enum class SamplerType {
+	independent, //white noise from the random stream
+	stratified,  //jittered strata of the pixel's samples, permuted per dimension
+	sobol,       //Owen scrambled Sobol (0, 2) sequence, scrambled per pixel and dimension
+	blue_noise   //one Sobol sequence spread over pixels in Morton order, errors of neighbours are anti-correlated
+};
+
+//what a sampler needs to know about the image, made once per render
+struct SamplePattern {
+	SamplerType type = SamplerType::independent;
+	uint64_t height = 1;
+	uint64_t width = 1;
+	uint32_t samples_per_pixel = 1;
+	uint64_t seed = 0;               //renders with different seeds are independent estimates
+	uint32_t strata_x = 1;           //stratified: strata_x * strata_y >= samples_per_pixel
+	uint32_t strata_y = 1;
+	uint32_t log2_samples = 0;       //blue noise: samples per pixel rounded up to power of 2
+	uint32_t base4_digits = 0;       //blue noise: digits of Morton index permuted per dimension
+
+	SamplePattern() = default;
+
+	SamplePattern(SamplerType type, uint64_t height, uint64_t width, uint64_t samples_per_pixel, uint64_t seed = 0) noexcept
+		: type{ type }, height{ height }, width{ width }, samples_per_pixel{ static_cast<uint32_t>(std::max<uint64_t>(samples_per_pixel, 1)) }, seed{ seed }
+	{
+		strata_x = static_cast<uint32_t>(std::ceil(std::sqrt(double(this->samples_per_pixel))));
+		strata_y = (this->samples_per_pixel + strata_x - 1) / strata_x;
+
+		log2_samples = static_cast<uint32_t>(std::bit_width(std::bit_ceil(this->samples_per_pixel)) - 1);
+		const auto resolution = std::bit_ceil(std::max<uint64_t>({ height, width, 1 }));
+		base4_digits = static_cast<uint32_t>(std::bit_width(resolution) - 1) + (log2_samples + 1) / 2;
+	}
+};
+
+//Values of sample dimensions in [0, 1), which the path consumes in order: pixel position, lens position
+//and then for every bounce whatever the material and russian roulette need.
+//Each bounce starts new dimensions (keyed by remaining depth like the random streams), so the values a bounce gets
+//do not depend on how many the previous one took. Dimensions are padded: every 1D or 2D draw is a separate
+//low discrepancy sequence with its own scramble, so any number of them can be used.
+//References: Kensler, Correlated Multi-Jittered Sampling; Burley, Practical Hash-based Owen Scrambling;
+//Ahmed, Wonka, Screen-Space Blue-Noise Diffusion of Monte Carlo Sampling Error via Hierarchical Ordering of Pixels.
+class Sampler {
+	SamplePattern pattern_;
+	uint64_t pixel_key_ = 0;
+	uint64_t sample_ = 0;
+	uint64_t morton_index_ = 0;
+	uint64_t bounce_ = 0;
+	uint32_t dimension_ = 0;
+
+	static constexpr double one_minus_epsilon = 0x1.fffffffffffffp-1;
+
+	[[nodiscard]] static constexpr
+	uint32_t reverse_bits(uint32_t x) noexcept {
+		x = (x << 16) | (x >> 16);
+		x = ((x & 0x00ff00ff) << 8) | ((x & 0xff00ff00) >> 8);
+		x = ((x & 0x0f0f0f0f) << 4) | ((x & 0xf0f0f0f0) >> 4);
+		x = ((x & 0x33333333) << 2) | ((x & 0xcccccccc) >> 2);
+		x = ((x & 0x55555555) << 1) | ((x & 0xaaaaaaaa) >> 1);
+		return x;
+	}
+
+	//hash in which each bit depends only on the bits below it (Laine, Karras)
+	[[nodiscard]] static constexpr
+	uint32_t laine_karras(uint32_t x, uint32_t seed) noexcept {
+		x += seed;
+		x ^= x * 0x6c50b47c;
+		x ^= x * 0xb82f1e52;
+		x ^= x * 0xc7afe638;
+		x ^= x * 0x8d22f6e6;
+		return x;
+	}
+
+	//random permutation of bits, where each bit is flipped depending on the bits above it
+	[[nodiscard]] static constexpr
+	uint32_t owen_scramble(uint32_t x, uint32_t seed) noexcept {
+		return reverse_bits(laine_karras(reverse_bits(x), seed));
+	}
+
+	//second dimension of the Sobol sequence is xor of direction numbers of the index bits,
+	//tables hold the xors for each value of each byte of the index
+	static constexpr auto sobol_tables = [] {
+		std::array<std::array<uint32_t, 256>, 4> tables{};
+		uint32_t directions[32]{};
+		directions[0] = 1u << 31;
+		for (int i = 1; i < 32; ++i) directions[i] = directions[i - 1] ^ (directions[i - 1] >> 1);
+
+		for (int byte = 0; byte < 4; ++byte) {
+			for (uint32_t value = 0; value < 256; ++value) {
+				for (int bit = 0; bit < 8; ++bit) {
+					if (value & (1u << bit)) tables[byte][value] ^= directions[8 * byte + bit];
+				}
+			}
+		}
+		return tables;
+	}();
+
+	//first two dimensions of the Sobol sequence, Owen scrambled - the first is van der Corput,
+	//so its scramble is a hash of the index
+	[[nodiscard]] static constexpr
+	std::pair<uint32_t, uint32_t> sobol(uint32_t index, uint32_t seed_x, uint32_t seed_y) noexcept {
+		const auto y = sobol_tables[0][index & 0xff] ^ sobol_tables[1][(index >> 8) & 0xff]
+		             ^ sobol_tables[2][(index >> 16) & 0xff] ^ sobol_tables[3][index >> 24];
+		return { reverse_bits(laine_karras(index, seed_x)), owen_scramble(y, seed_y) };
+	}
+
+	//i-th element of random permutation of [0, l) given by p
+	[[nodiscard]] static constexpr
+	uint32_t permutation_element(uint32_t i, uint32_t l, uint32_t p) noexcept {
+		auto w = l - 1;
+		w |= w >> 1;
+		w |= w >> 2;
+		w |= w >> 4;
+		w |= w >> 8;
+		w |= w >> 16;
+		do {
+			i ^= p;
+			i *= 0xe170893d;
+			i ^= p >> 16;
+			i ^= (i & w) >> 4;
+			i ^= p >> 8;
+			i *= 0x0929eb3f;
+			i ^= p >> 23;
+			i ^= (i & w) >> 1;
+			i *= 1 | p >> 27;
+			i *= 0x6935fa69;
+			i ^= (i & w) >> 11;
+			i *= 0x74dcb303;
+			i ^= (i & w) >> 2;
+			i *= 0x9e501cc3;
+			i ^= (i & w) >> 2;
+			i *= 0xc860a3df;
+			i &= w;
+			i ^= i >> 5;
+		} while (i >= l);
+		return (i + p) % l;
+	}
+
+	[[nodiscard]] static constexpr
+	uint64_t morton(uint64_t x, uint64_t y) noexcept {
+		auto spread = [](uint64_t v) {
+			v &= 0xffffffff;
+			v = (v | (v << 16)) & 0x0000ffff0000ffff;
+			v = (v | (v << 8)) & 0x00ff00ff00ff00ff;
+			v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0f;
+			v = (v | (v << 2)) & 0x3333333333333333;
+			v = (v | (v << 1)) & 0x5555555555555555;
+			return v;
+		};
+		return spread(x) | (spread(y) << 1);
+	}
+
+	//index into the sequence shared by all pixels, base 4 digits of the Morton index are shuffled
+	//by permutations depending on the digits above them, so each block of pixels gets a well distributed part of it
+	[[nodiscard]]
+	uint64_t blue_noise_index(uint64_t dimension) const noexcept {
+		static constexpr uint8_t permutations[24][4] = {
+			{ 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 1, 3 }, { 0, 2, 3, 1 }, { 0, 3, 2, 1 }, { 0, 3, 1, 2 },
+			{ 1, 0, 2, 3 }, { 1, 0, 3, 2 }, { 1, 2, 0, 3 }, { 1, 2, 3, 0 }, { 1, 3, 2, 0 }, { 1, 3, 0, 2 },
+			{ 2, 1, 0, 3 }, { 2, 1, 3, 0 }, { 2, 0, 1, 3 }, { 2, 0, 3, 1 }, { 2, 3, 0, 1 }, { 2, 3, 1, 0 },
+			{ 3, 1, 2, 0 }, { 3, 1, 0, 2 }, { 3, 2, 1, 0 }, { 3, 2, 0, 1 }, { 3, 0, 2, 1 }, { 3, 0, 1, 2 }
+		};
+
+		const bool odd_power = pattern_.log2_samples & 1;
+		uint64_t index = 0;
+		for (auto i = int(pattern_.base4_digits) - 1; i >= int(odd_power); --i) {
+			const auto shift = 2 * i - int(odd_power);
+			const auto digit = (morton_index_ >> shift) & 3;
+			const auto higher = morton_index_ >> (shift + 2);
+			const auto p = (utils::CounterRng::mix(higher ^ (0x55555555 * dimension)) >> 24) % 24;
+			index |= uint64_t{ permutations[p][digit] } << shift;
+		}
+		if (odd_power) {
+			index |= (morton_index_ & 1) ^ (utils::CounterRng::mix((morton_index_ >> 1) ^ (0x55555555 * dimension)) & 1);
+		}
+		return index;
+	}
+
+	[[nodiscard]]
+	uint64_t next_dimension() noexcept {
+		return (bounce_ << 16) + dimension_++;
+	}
+
+	[[nodiscard]]
+	static double to_unit(uint32_t x) noexcept {
+		return x * 0x1.0p-32;
+	}
+
+	//index into scrambled sequence and its seed for the next dimension
+	[[nodiscard]]
+	std::pair<uint32_t, uint64_t> sequence_point() noexcept {
+		const auto dimension = next_dimension();
+		if (pattern_.type == SamplerType::sobol) {
+			const auto seed = utils::CounterRng::mix(pixel_key_ ^ utils::CounterRng::mix(dimension));
+			return { owen_scramble(static_cast<uint32_t>(sample_), static_cast<uint32_t>(seed)), seed };
+		}
+		//only lower 32 bits of the index change the point, pixels far apart in Morton order are decorrelated by the seed
+		const auto index = blue_noise_index(dimension);
+		return { static_cast<uint32_t>(index), utils::CounterRng::mix(pixel_key_ ^ utils::CounterRng::mix(dimension) ^ (index >> 32)) };
+	}
+
+	[[nodiscard]]
+	uint32_t stratum(uint32_t strata) noexcept {
+		const auto dimension = next_dimension();
+		const auto seed = utils::CounterRng::mix(pixel_key_ ^ utils::CounterRng::mix(dimension) ^ (sample_ / pattern_.samples_per_pixel));
+		return permutation_element(static_cast<uint32_t>(sample_ % pattern_.samples_per_pixel), strata, static_cast<uint32_t>(seed));
+	}
+
+public:
+	//starts random stream of the sample as well, under seed of the pattern,
+	//so the thread which happens to render the pixel does not matter
+	void start_sample(const SamplePattern& pattern, uint64_t pixel, uint64_t sample) noexcept {
+		utils::rng.seed(pattern.seed);
+		utils::rng.start_sample(pixel, sample);
+		pattern_ = pattern;
+		sample_ = sample;
+		bounce_ = 0;
+		dimension_ = 0;
+
+		if (pattern.type == SamplerType::blue_noise) {
+			const auto y = pixel / pattern.width, x = pixel % pattern.width;
+			pixel_key_ = utils::rng.pixel_key(UINT64_MAX);
+			//samples beyond the rounded up count continue with another scramble of the sequence
+			morton_index_ = (morton(x, y) << pattern.log2_samples) | (sample & ((uint64_t{ 1 } << pattern.log2_samples) - 1));
+			pixel_key_ ^= utils::CounterRng::mix(sample >> pattern.log2_samples);
+		}
+		else {
+			pixel_key_ = utils::rng.pixel_key(pixel);
+		}
+	}
+
+	//starts random stream of the bounce as well
+	void start_bounce(uint64_t bounce) noexcept {
+		utils::rng.start_bounce(bounce);
+		bounce_ = bounce;
+		dimension_ = 0;
+	}
+
+	[[nodiscard]]
+	double get_1d() noexcept {
+		switch (pattern_.type) {
+		case SamplerType::stratified: {
+			const auto n = pattern_.samples_per_pixel;
+			return std::min((stratum(n) + utils::rng.uniform()) / n, one_minus_epsilon);
+		}
+		case SamplerType::sobol:
+		case SamplerType::blue_noise: {
+			const auto [index, seed] = sequence_point();
+			return to_unit(reverse_bits(laine_karras(index, static_cast<uint32_t>(seed >> 32))));
+		}
+		default:
+			return utils::rng.uniform();
+		}
+	}
+
+	[[nodiscard]]
+	std::pair<double, double> get_2d() noexcept {
+		switch (pattern_.type) {
+		case SamplerType::stratified: {
+			const auto s = stratum(pattern_.strata_x * pattern_.strata_y);
+			const auto u = (s % pattern_.strata_x + utils::rng.uniform()) / pattern_.strata_x;
+			const auto v = (s / pattern_.strata_x + utils::rng.uniform()) / pattern_.strata_y;
+			return { std::min(u, one_minus_epsilon), std::min(v, one_minus_epsilon) };
+		}
+		case SamplerType::sobol:
+		case SamplerType::blue_noise: {
+			const auto [index, seed] = sequence_point();
+			const auto [x, y] = sobol(index, static_cast<uint32_t>(seed >> 32), static_cast<uint32_t>(utils::CounterRng::mix(seed)));
+			return { to_unit(x), to_unit(y) };
+		}
+		default: {
+			const auto u = utils::rng.uniform();
+			return { u, utils::rng.uniform() };
+		}
+		}
+	}
+};
+
+namespace utils {
+	//samples of the path traced by this thread, started by RayTracer for every pixel sample and bounce
+	//until then it hands out values of the random stream
+	inline thread_local Sampler sampler;
+}
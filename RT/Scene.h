@@ -3,18 +3,38 @@
 #include "Hitable.h"
 #include "Ray.h"
 #include "HitRecord.h"
+#include "BVH.h"
+#include "RayPacket.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
 #include <vector>
 #include <tuple>
+#include <utility>
 #include <optional>
 
+struct PrimitiveIndex
+{
+	size_t type_index;
+	size_t vector_index;
+};
+
 template <Hittable... Hs>
 class Scene {
 	static_assert(utils::are_distinct_v<Hs...>, "Some type appears more then one time");
 
 	std::tuple<std::vector<Hs>... > objects;
 
+	//filled by build(), ordered so that BVH leaves refer to contiguous ranges
+	std::vector<PrimitiveIndex> primitives;
+	BVH bvh;
+	double built_cost = 0;          //SAH cost of the BVH when it was last built, refit compares against it
+	std::vector<AABB> boxes;        //of primitives in BVH order, kept between refits
+
 	template <typename T>
 	auto& get_vector() {
 		static_assert(utils::is_in_pack_v<T, Hs...>);
@@ -27,41 +47,289 @@ class Scene {
 		return std::get<std::vector<T>>(objects);
 	}
 
+	void invalidate() noexcept {
+		primitives.clear();
+		bvh.clear();
+	}
+
+	//BVH over boxes of all objects, which are built already
+	void build_top_level() {
+		invalidate();
+
+		boxes.clear();
+		auto collect = [&]<Hittable T>(const std::vector<T>& v) {
+			for (size_t i = 0; i < v.size(); ++i) {
+				primitives.push_back({ utils::first_occurance<T, Hs...>::value, i });
+				boxes.push_back(v[i].bounding_box());
+			}
+		};
+		(collect(get_vector<Hs>()), ...);
+
+		const auto order = bvh.build(boxes);
+
+		std::vector<PrimitiveIndex> ordered;
+		ordered.reserve(order.size());
+		for (auto i : order) ordered.push_back(primitives[i]);
+		primitives = std::move(ordered);
+		built_cost = bvh.sah_cost();
+	}
+
+	[[nodiscard]]
+	std::optional<HitRecord> intersect_linear(const Ray& ray, Scalar t_min, Scalar t_max) const {
+		std::optional<HitRecord> ret_value{};
+		auto closest_so_far = t_max;
+
+		auto intersect_one = [&]<Hittable T>(const std::vector<T>&v) {
+			for (const Hittable auto& object : v) {
+				if (auto hit = object.intersect(ray, t_min, closest_so_far); hit) {
+					closest_so_far = hit->t;
+					ret_value = hit;
+				}
+			}
+		};
+
+		(intersect_one(get_vector<Hs>()), ...);
+
+		if (ret_value) ret_value->time = ray.time();
+		return ret_value;
+	}
+
+	[[nodiscard]]
+	bool occluded_linear(const Ray& ray, Scalar t_min, Scalar t_max) const {
+		auto occluded_one = [&]<Hittable T>(const std::vector<T>& v) {
+			return std::any_of(v.begin(), v.end(), [&](const T& object) { return any_hit(object, ray, t_min, t_max); });
+		};
+
+		return (occluded_one(get_vector<Hs>()) || ...);
+	}
+
 public:
+	static constexpr size_t type_count = sizeof...(Hs);
+
+	//PrimitiveIndex::type_index of objects of type T
+	template <Hittable T>
+	[[nodiscard]]
+	static constexpr size_t type_index() noexcept {
+		static_assert(utils::is_in_pack_v<T, Hs...>, "This type is not in the list");
+		return utils::first_occurance<T, Hs...>::value;
+	}
+
 	void clear() {
 		(std::get<std::vector<Hs>>(objects).clear(), ...);
+		invalidate();
 	}
 
 	template <Hittable T>
 	auto push_back(T&& object) {
 		static_assert(utils::is_in_pack_v<T, Hs...>, "This type is not in the list");
+		invalidate();
 		return get_vector<T>().push_back(std::forward<T>(object));
 	}
 
+	//returns index of the object for update
 	template <Hittable T, typename... Ts>
-	void emplace_back(Ts&&... args) {
+	PrimitiveIndex emplace_back(Ts&&... args) {
 		static_assert(utils::is_in_pack<T, Hs...>::value, "Given type is not in the list");
 		static_assert(std::is_constructible_v<T, Ts...>, "Cannot construct hittable from given arguments");
 
+		invalidate();
 		get_vector<T>().emplace_back(std::forward<Ts>(args)...);
+		return { utils::first_occurance<T, Hs...>::value, get_vector<T>().size() - 1 };
+	}
+
+	//copies objects in bulk, e.g. from a mapped scene file
+	template <Hittable T>
+	void append(std::span<const T> objects) {
+		static_assert(utils::is_in_pack_v<T, Hs...>, "This type is not in the list");
+		invalidate();
+		get_vector<T>().insert(get_vector<T>().end(), objects.begin(), objects.end());
+	}
+
+	//builds acceleration structure over all objects, has to be called again after objects are added
+	//until then intersect falls back to testing every object
+	void build() {
+		//objects with their own acceleration structure (two-level hierarchy)
+		auto build_objects = [&]<Hittable T>(std::vector<T>& v) {
+			if constexpr (requires (T & object) { object.build(); }) {
+				for (auto& object : v) object.build();
+			}
+		};
+		(build_objects(get_vector<Hs>()), ...);
+
+		build_top_level();
 	}
 
+	//calls f(object) for the object, which f can move (e.g. Instance::set_transform) while the BVH stays valid
+	//for other rays than those of the changed objects - refit has to follow before the scene is rendered
+	//f is instantiated for every object type, so it has to compile for all of them
+	template <typename F>
+	void update(const PrimitiveIndex& object, F&& f) {
+		[&]<size_t... Is>(std::index_sequence<Is...>) {
+			((Is == object.type_index ? (void)f(std::get<Is>(objects)[object.vector_index]) : void()), ...);
+		}(std::index_sequence_for<Hs...>{});
+	}
+
+	//refits the BVH to the boxes of objects after update, which costs one pass over the primitives and nodes
+	//when that leaves the BVH more than rebuild_ratio times costlier than it was when built, it is rebuilt instead
+	//(only the top level, objects keep their own BVHs), returns whether it was rebuilt
+	bool refit(double rebuild_ratio = 1.5) {
+		if (bvh.empty()) {
+			build_top_level();
+			return true;
+		}
+
+		for (size_t i = 0; i < primitives.size(); ++i) {
+			const auto& primitive = primitives[i];
+			auto visitor = [&]<Hittable T>(const std::vector<T>& v) {
+				return v[primitive.vector_index].bounding_box();
+			};
+			boxes[i] = *utils::visit_tuple(objects, visitor, primitive.type_index);
+		}
+		bvh.refit(boxes);
+
+		if (bvh.sah_cost() <= rebuild_ratio * built_cost) return false;
+		build_top_level();
+		return true;
+	}
+
+	//takes a top level BVH built before over the same objects (see SceneFile.h) instead of building it
+	//objects have to be built already, primitives are in the order of BVH leaves
+	void assign_hierarchy(std::span<const PrimitiveIndex> order, std::span<const BVH::Node> nodes) {
+		primitives.assign(order.begin(), order.end());
+		bvh.assign(nodes);
+		boxes.resize(primitives.size());
+		built_cost = bvh.sah_cost();
+	}
+
+	template <Hittable T>
+	[[nodiscard]]
+	const std::vector<T>& objects_of_type() const {
+		return get_vector<T>();
+	}
+
+	//number of objects of all types
 	[[nodiscard]]
-	std::optional<HitRecord> intersect(const Ray& ray, double t_min, double t_max) const {
+	size_t size() const noexcept {
+		return (get_vector<Hs>().size() + ...);
+	}
+
+	//primitives in the order of BVH leaves and the nodes, valid while the scene is built
+	[[nodiscard]]
+	std::span<const PrimitiveIndex> primitive_order() const noexcept {
+		return primitives;
+	}
+
+	[[nodiscard]]
+	const BVH& hierarchy() const noexcept {
+		return bvh;
+	}
+
+	[[nodiscard]]
+	bool is_built() const noexcept {
+		return !bvh.empty();
+	}
+
+	[[nodiscard]]
+	std::optional<HitRecord> intersect(const Ray& ray, Scalar t_min, Scalar t_max) const {
+		if (bvh.empty()) return intersect_linear(ray, t_min, t_max);
+
 		std::optional<HitRecord> ret_value{};
-		auto closest_so_far = t_max;
 
-		auto intersect_one = [&]<Hittable T>(const std::vector<T>&v) {
-			for (const Hittable auto& object : v) {
-				if (auto hit = object.intersect(ray, t_min, closest_so_far); hit) {
+		bvh.intersect(ray, t_min, t_max, [&](uint32_t first, uint32_t count, Scalar& closest_so_far) {
+			bool hit_any = false;
+			for (auto i = first; i < first + count; ++i) {
+				const auto& primitive = primitives[i];
+				auto visitor = [&]<Hittable T>(const std::vector<T>& v) {
+					return v[primitive.vector_index].intersect(ray, t_min, closest_so_far);
+				};
+
+				if (auto hit = utils::visit_tuple(objects, visitor, primitive.type_index); hit) {
 					closest_so_far = hit->t;
 					ret_value = hit;
+					hit_any = true;
 				}
 			}
-		};
-
-		(intersect_one(get_vector<Hs>()), ...);
+			return hit_any;
+		});
 
+		if (ret_value) ret_value->time = ray.time();
 		return ret_value;
 	}
+
+	//whether anything is hit in [t_min, t_max], e.g. between a point and a light
+	//traversal ends at the first hit found and no HitRecord is made
+	[[nodiscard]]
+	bool occluded(const Ray& ray, Scalar t_min, Scalar t_max) const {
+		if (bvh.empty()) return occluded_linear(ray, t_min, t_max);
+
+		return bvh.occluded(ray, t_min, t_max, [&](uint32_t first, uint32_t count) {
+			for (auto i = first; i < first + count; ++i) {
+				const auto& primitive = primitives[i];
+				auto visitor = [&]<Hittable T>(const std::vector<T>& v) {
+					return any_hit(v[primitive.vector_index], ray, t_min, t_max);
+				};
+
+				if (utils::visit_tuple(objects, visitor, primitive.type_index).value_or(false)) return true;
+			}
+			return false;
+		});
+	}
+
+	//closest hits of packet rays, hits[lane] stays empty for lanes without ray or hit
+	//objects with packet intersect (spheres) test all rays at once, others are intersected ray by ray
+	void intersect(const RayPacket& packet, Scalar t_min, Scalar t_max, std::array<std::optional<HitRecord>, RayPacket::size>& hits) const {
+		hits.fill(std::nullopt);
+
+		if (bvh.empty()) {
+			for (auto lanes = packet.active; lanes; lanes &= lanes - 1) {
+				const auto lane = std::countr_zero(lanes);
+				hits[lane] = intersect_linear(packet.ray(lane), t_min, t_max);
+			}
+			return;
+		}
+
+		std::array<Scalar, RayPacket::size> closest;
+		closest.fill(t_max);
+		std::array<uint32_t, RayPacket::size> closest_primitive;
+		closest_primitive.fill(UINT32_MAX);
+
+		bvh.intersect(packet, t_min, closest.data(), [&](uint32_t first, uint32_t count, uint32_t lanes) {
+			for (auto i = first; i < first + count; ++i) {
+				auto visitor = [&]<Hittable T>(const std::vector<T>& v) -> uint32_t {
+					const auto& object = v[primitives[i].vector_index];
+					if constexpr (requires { { object.intersect(packet, lanes, t_min, closest.data()) } -> std::same_as<uint32_t>; }) {
+						return object.intersect(packet, lanes, t_min, closest.data());
+					}
+					else {
+						uint32_t hit_lanes = 0;
+						for (auto l = lanes; l; l &= l - 1) {
+							const auto lane = std::countr_zero(l);
+							if (const auto hit = object.intersect(packet.ray(lane), t_min, closest[lane]); hit) {
+								closest[lane] = hit->t;
+								hit_lanes |= 1u << lane;
+							}
+						}
+						return hit_lanes;
+					}
+				};
+
+				const auto hit_lanes = utils::visit_tuple(objects, visitor, primitives[i].type_index).value_or(0);
+				for (auto l = hit_lanes; l; l &= l - 1) closest_primitive[std::countr_zero(l)] = i;
+			}
+		});
+
+		//records are made by intersecting the closest primitive again, its nearest hit is the one found
+		//t_max is not shrunk to the distance of the hit, boxes of flat meshes may round their entry past it
+		for (auto lanes = packet.active; lanes; lanes &= lanes - 1) {
+			const auto lane = std::countr_zero(lanes);
+			if (closest_primitive[lane] == UINT32_MAX) continue;
+
+			const auto& primitive = primitives[closest_primitive[lane]];
+			auto visitor = [&]<Hittable T>(const std::vector<T>& v) {
+				return v[primitive.vector_index].intersect(packet.ray(lane), t_min, t_max);
+			};
+			hits[lane] = utils::visit_tuple(objects, visitor, primitive.type_index);
+			if (hits[lane]) hits[lane]->time = packet.time[lane];
+		}
+	}
 };
\ No newline at end of file
@@ -0,0 +1,555 @@
+#include "SceneFile.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+	constexpr char scene_magic[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+	constexpr uint32_t scene_version = 1;
+	constexpr uint32_t byte_order_mark = 0x01020304;
+	constexpr uint64_t section_alignment = 64;
+
+	using SceneType = decltype(DefaultRayTracer::scene);
+
+	enum class MaterialKind : uint32_t { lambertian, metal, dielectric, light };
+
+	struct MaterialRecord {
+		uint32_t kind;
+		uint32_t reserved;
+		double parameters[4];       //color and fuzz (metal), index of refraction (dielectric) or radiance (light)
+	};
+
+	struct CameraRecord {
+		double lookfrom[3];
+		double lookat[3];
+		double vup[3];
+		double vfov;
+		double aperture;
+		double focus_distance;
+	};
+
+	struct RenderRecord {
+		uint64_t height;
+		uint64_t width;
+		uint64_t seed;
+		int32_t samples_per_pixel;
+		int32_t max_depth;
+		uint32_t integrator;
+		uint32_t sampler;
+	};
+
+	//arrays of a built SphereSet without padding
+	struct SetRecord {
+		uint64_t count;
+		uint64_t node_count;
+		uint64_t x_offset;
+		uint64_t y_offset;
+		uint64_t z_offset;
+		uint64_t radius_offset;
+		uint64_t material_offset;
+		uint64_t node_offset;
+	};
+
+	//mesh file embedded at offset, material is index into materials of the scene file
+	struct MeshRecord {
+		uint64_t offset;
+		uint64_t material;
+	};
+
+	struct SceneFileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;        //byte_order_mark as written, tells files of other byte order apart
+		uint32_t scalar_size;       //objects are stored as they are in memory, so their layout in the build has to match
+		uint32_t sphere_size;
+		uint32_t node_size;
+		uint32_t index_size;        //of MaterialIndex and PrimitiveIndex
+		uint32_t object_types[3];   //PrimitiveIndex::type_index of Sphere, SphereSet and TriangleMesh
+		uint32_t reserved;
+		CameraRecord camera;
+		RenderRecord render;
+		uint64_t material_count;
+		uint64_t sphere_count;
+		uint64_t primitive_count;
+		uint64_t node_count;
+		uint64_t set_count;
+		uint64_t mesh_count;
+		uint64_t material_offset;   //sections in bytes from start of the file
+		uint64_t sphere_offset;
+		uint64_t primitive_offset;
+		uint64_t node_offset;
+		uint64_t set_offset;
+		uint64_t mesh_offset;
+	};
+
+	static_assert(std::is_trivially_copyable_v<Sphere> && std::is_trivially_copyable_v<BVH::Node> && std::is_trivially_copyable_v<PrimitiveIndex>,
+		"objects are copied from the file as they are");
+	static_assert(sizeof(MaterialIndex) == sizeof(PrimitiveIndex));
+
+	constexpr uint32_t object_types[3] = {
+		uint32_t(SceneType::type_index<Sphere>()),
+		uint32_t(SceneType::type_index<SphereSet>()),
+		uint32_t(SceneType::type_index<TriangleMesh>())
+	};
+
+	using MaterialListType = decltype(DefaultRayTracer::materials);
+
+	//MaterialIndex::type_index by MaterialKind
+	constexpr size_t material_types[4] = {
+		MaterialListType::type_index<Lambertian>(),
+		MaterialListType::type_index<Metal>(),
+		MaterialListType::type_index<Dielectric>(),
+		MaterialListType::type_index<DiffuseLight>()
+	};
+
+	template <typename T>
+	[[nodiscard]]
+	std::span<const T> section(std::span<const std::byte> file, uint64_t offset, uint64_t count) noexcept {
+		return { reinterpret_cast<const T*>(file.data() + offset), static_cast<size_t>(count) };
+	}
+
+	[[nodiscard]]
+	bool section_fits(uint64_t file_size, uint64_t offset, uint64_t count, uint64_t element_size) noexcept {
+		return offset % section_alignment == 0
+			&& offset <= file_size
+			&& count <= (file_size - offset) / element_size;
+	}
+
+	[[nodiscard]]
+	MaterialRecord material_record(const DefaultRayTracer& RT, size_t i) {
+		MaterialRecord record{};
+		auto set = [&](MaterialKind kind, const Color& color, double extra = 0) {
+			record.kind = static_cast<uint32_t>(kind);
+			record.parameters[0] = color.x();
+			record.parameters[1] = color.y();
+			record.parameters[2] = color.z();
+			record.parameters[3] = extra;
+		};
+
+		RT.materials.visit(MaterialIndex{ 0, i }, [&]<Material M>(const M& material) {
+			if constexpr (std::is_same_v<M, Lambertian>) set(MaterialKind::lambertian, material.color());
+			else if constexpr (std::is_same_v<M, Metal>) set(MaterialKind::metal, material.color(), material.fuzz());
+			else if constexpr (std::is_same_v<M, Dielectric>) set(MaterialKind::dielectric, Color{ material.index_of_refraction(), 0, 0 });
+			else set(MaterialKind::light, material.radiance());
+		});
+		return record;
+	}
+
+	//kind is valid
+	void emplace_material(DefaultRayTracer& RT, const MaterialRecord& record) {
+		const auto& p = record.parameters;
+		const Color color{ Scalar(p[0]), Scalar(p[1]), Scalar(p[2]) };
+		switch (static_cast<MaterialKind>(record.kind)) {
+		case MaterialKind::lambertian: (void)RT.materials.emplace_material<Lambertian>(color); break;
+		case MaterialKind::metal: (void)RT.materials.emplace_material<Metal>(color, Scalar(p[3])); break;
+		case MaterialKind::dielectric: (void)RT.materials.emplace_material<Dielectric>(Scalar(p[0])); break;
+		case MaterialKind::light: (void)RT.materials.emplace_material<DiffuseLight>(color); break;
+		}
+	}
+
+	[[nodiscard]]
+	CameraRecord camera_record(const SceneCamera& camera) noexcept {
+		CameraRecord record{};
+		for (auto i : { 0, 1, 2 }) {
+			record.lookfrom[i] = camera.lookfrom.data[i];
+			record.lookat[i] = camera.lookat.data[i];
+			record.vup[i] = camera.vup.data[i];
+		}
+		record.vfov = camera.vfov;
+		record.aperture = camera.aperture;
+		record.focus_distance = camera.focus_distance;
+		return record;
+	}
+
+	[[nodiscard]]
+	SceneCamera scene_camera(const CameraRecord& record) noexcept {
+		SceneCamera camera;
+		for (auto i : { 0, 1, 2 }) {
+			camera.lookfrom.data[i] = Scalar(record.lookfrom[i]);
+			camera.lookat.data[i] = Scalar(record.lookat[i]);
+			camera.vup.data[i] = Scalar(record.vup[i]);
+		}
+		camera.vfov = Scalar(record.vfov);
+		camera.aperture = Scalar(record.aperture);
+		camera.focus_distance = Scalar(record.focus_distance);
+		return camera;
+	}
+}
+
+Camera SceneCamera::camera(Scalar aspect_ratio) const {
+	const auto focus = focus_distance > 0 ? focus_distance : (lookfrom - lookat).length();
+	return { lookfrom, lookat, vup, vfov, aspect_ratio, aperture, focus };
+}
+
+bool save_scene(const char* filename, const DefaultRayTracer& RT, const SceneDescription& description) {
+	const auto& scene = RT.scene;
+	if (!scene.objects_of_type<Instance<SphereSet>>().empty() || !scene.objects_of_type<Instance<TriangleMesh>>().empty()) return false;
+	if (scene.size() > 0 && !scene.is_built()) return false;
+
+	std::ofstream out{ filename, std::ios::binary };
+	if (!out) return false;
+
+	auto write_section = [&]<typename T>(std::span<const T> data) -> uint64_t {
+		static constexpr char zeros[section_alignment]{};
+		const auto position = static_cast<uint64_t>(out.tellp());
+		const auto offset = (position + section_alignment - 1) / section_alignment * section_alignment;
+		out.write(zeros, static_cast<std::streamsize>(offset - position));
+		out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size_bytes()));
+		return offset;
+	};
+
+	SceneFileHeader header{};
+	std::memcpy(header.magic, scene_magic, sizeof(scene_magic));
+	header.version = scene_version;
+	header.byte_order = byte_order_mark;
+	header.scalar_size = sizeof(Scalar);
+	header.sphere_size = sizeof(Sphere);
+	header.node_size = sizeof(BVH::Node);
+	header.index_size = sizeof(PrimitiveIndex);
+	std::memcpy(header.object_types, object_types, sizeof(object_types));
+	header.camera = camera_record(description.camera);
+	header.render = {
+		description.height,
+		description.width,
+		description.settings.seed,
+		description.settings.samples_per_pixel,
+		description.settings.max_depth,
+		static_cast<uint32_t>(description.settings.integrator),
+		static_cast<uint32_t>(description.settings.sampler)
+	};
+	//written again at the end, when offsets are known
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	std::vector<MaterialRecord> materials;
+	materials.reserve(RT.materials.size());
+	for (size_t i = 0; i < RT.materials.size(); ++i) materials.push_back(material_record(RT, i));
+	header.material_count = materials.size();
+	header.material_offset = write_section(std::span<const MaterialRecord>{ materials });
+
+	const auto& spheres = scene.objects_of_type<Sphere>();
+	header.sphere_count = spheres.size();
+	header.sphere_offset = write_section(std::span<const Sphere>{ spheres });
+
+	header.primitive_count = scene.primitive_order().size();
+	header.primitive_offset = write_section(scene.primitive_order());
+	header.node_count = scene.hierarchy().nodes().size();
+	header.node_offset = write_section(std::span<const BVH::Node>{ scene.hierarchy().nodes() });
+
+	std::vector<SetRecord> sets;
+	for (const auto& set : scene.objects_of_type<SphereSet>()) {
+		SetRecord record{};
+		record.count = set.size();
+		record.node_count = set.bvh().nodes().size();
+		record.x_offset = write_section(set.xs());
+		record.y_offset = write_section(set.ys());
+		record.z_offset = write_section(set.zs());
+		record.radius_offset = write_section(set.radii());
+		record.material_offset = write_section(set.materials());
+		record.node_offset = write_section(std::span<const BVH::Node>{ set.bvh().nodes() });
+		sets.push_back(record);
+	}
+
+	std::vector<MeshRecord> meshes;
+	for (const auto& mesh : scene.objects_of_type<TriangleMesh>()) {
+		const auto offset = write_section(std::span<const char>{});
+		if (!mesh.write(out)) return false;
+		meshes.push_back({ offset, mesh.material().vector_index });
+	}
+
+	header.set_count = sets.size();
+	header.set_offset = write_section(std::span<const SetRecord>{ sets });
+	header.mesh_count = meshes.size();
+	header.mesh_offset = write_section(std::span<const MeshRecord>{ meshes });
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return static_cast<bool>(out);
+}
+
+std::optional<SceneDescription> load_scene(const char* filename, DefaultRayTracer& RT) {
+	if (RT.scene.size() > 0 || RT.materials.size() > 0) return {};
+
+	auto file = MappedFile::open(filename);
+	if (!file) return {};
+
+	const auto bytes = file->bytes();
+	SceneFileHeader header;
+	if (bytes.size() < sizeof(header)) return {};
+	std::memcpy(&header, bytes.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, scene_magic, sizeof(scene_magic)) != 0
+		|| header.version != scene_version
+		|| header.byte_order != byte_order_mark
+		|| header.scalar_size != sizeof(Scalar)
+		|| header.sphere_size != sizeof(Sphere)
+		|| header.node_size != sizeof(BVH::Node)
+		|| header.index_size != sizeof(PrimitiveIndex)
+		|| std::memcmp(header.object_types, object_types, sizeof(object_types)) != 0
+		|| header.render.integrator > static_cast<uint32_t>(Integrator::wavefront)
+		|| header.render.sampler > static_cast<uint32_t>(SamplerType::blue_noise)
+		|| header.render.height == 0 || header.render.width == 0
+		|| header.render.samples_per_pixel < 1 || header.render.max_depth < 1
+		|| !section_fits(bytes.size(), header.material_offset, header.material_count, sizeof(MaterialRecord))
+		|| !section_fits(bytes.size(), header.sphere_offset, header.sphere_count, sizeof(Sphere))
+		|| !section_fits(bytes.size(), header.primitive_offset, header.primitive_count, sizeof(PrimitiveIndex))
+		|| !section_fits(bytes.size(), header.node_offset, header.node_count, sizeof(BVH::Node))
+		|| !section_fits(bytes.size(), header.set_offset, header.set_count, sizeof(SetRecord))
+		|| !section_fits(bytes.size(), header.mesh_offset, header.mesh_count, sizeof(MeshRecord))
+		|| header.primitive_count != header.sphere_count + header.set_count + header.mesh_count
+		|| (header.node_count == 0) != (header.primitive_count == 0)) {
+		return {};
+	}
+
+	const auto material_records = section<MaterialRecord>(bytes, header.material_offset, header.material_count);
+	const auto spheres = section<Sphere>(bytes, header.sphere_offset, header.sphere_count);
+	const auto primitives = section<PrimitiveIndex>(bytes, header.primitive_offset, header.primitive_count);
+	const auto nodes = section<BVH::Node>(bytes, header.node_offset, header.node_count);
+	const auto sets = section<SetRecord>(bytes, header.set_offset, header.set_count);
+	const auto meshes = section<MeshRecord>(bytes, header.mesh_offset, header.mesh_count);
+
+	//everything is checked before RT is touched, indices stored in objects have to refer to what is loaded
+	//materials are added to the empty list in file order, so they get the indices they had when saved
+	for (const auto& record : material_records) {
+		if (record.kind > static_cast<uint32_t>(MaterialKind::light)) return {};
+	}
+	std::vector<MaterialIndex> material_indices;
+	for (const auto& record : material_records) {
+		material_indices.push_back({ material_types[record.kind], material_indices.size() });
+	}
+	auto valid_material = [&](const MaterialIndex& m) {
+		return m.vector_index < material_indices.size() && material_indices[m.vector_index].type_index == m.type_index;
+	};
+
+	for (const auto& sphere : spheres) {
+		if (!valid_material(sphere.material())) return {};
+	}
+
+	for (const auto& set : sets) {
+		if (!section_fits(bytes.size(), set.x_offset, set.count, sizeof(Scalar))
+			|| !section_fits(bytes.size(), set.y_offset, set.count, sizeof(Scalar))
+			|| !section_fits(bytes.size(), set.z_offset, set.count, sizeof(Scalar))
+			|| !section_fits(bytes.size(), set.radius_offset, set.count, sizeof(Scalar))
+			|| !section_fits(bytes.size(), set.material_offset, set.count, sizeof(MaterialIndex))
+			|| !section_fits(bytes.size(), set.node_offset, set.node_count, sizeof(BVH::Node))
+			|| !BVH::valid(section<BVH::Node>(bytes, set.node_offset, set.node_count), set.count)) {
+			return {};
+		}
+		for (const auto& m : section<MaterialIndex>(bytes, set.material_offset, set.count)) {
+			if (!valid_material(m)) return {};
+		}
+	}
+
+	std::vector<TriangleMesh> loaded_meshes;
+	loaded_meshes.reserve(meshes.size());
+	for (const auto& mesh : meshes) {
+		if (mesh.material >= material_indices.size()) return {};
+		auto loaded = TriangleMesh::load(file, mesh.offset, material_indices[mesh.material]);
+		if (!loaded) return {};
+		loaded_meshes.push_back(std::move(*loaded));
+	}
+
+	const uint64_t counts[3] = { header.sphere_count, header.set_count, header.mesh_count };
+	for (const auto& primitive : primitives) {
+		const auto type = std::find(std::begin(object_types), std::end(object_types), primitive.type_index);
+		if (type == std::end(object_types) || primitive.vector_index >= counts[type - std::begin(object_types)]) return {};
+	}
+	if (!BVH::valid(nodes, header.primitive_count)) return {};
+
+	for (const auto& record : material_records) emplace_material(RT, record);
+	RT.scene.append(spheres);
+	for (const auto& set : sets) {
+		RT.scene.emplace_back<SphereSet>(
+			section<Scalar>(bytes, set.x_offset, set.count),
+			section<Scalar>(bytes, set.y_offset, set.count),
+			section<Scalar>(bytes, set.z_offset, set.count),
+			section<Scalar>(bytes, set.radius_offset, set.count),
+			section<MaterialIndex>(bytes, set.material_offset, set.count),
+			section<BVH::Node>(bytes, set.node_offset, set.node_count));
+	}
+	for (auto& mesh : loaded_meshes) RT.scene.emplace_back<TriangleMesh>(std::move(mesh));
+	RT.scene.assign_hierarchy(primitives, nodes);
+	RT.build_lights();
+
+	SceneDescription description;
+	description.camera = scene_camera(header.camera);
+	description.height = header.render.height;
+	description.width = header.render.width;
+	description.settings.seed = header.render.seed;
+	description.settings.samples_per_pixel = header.render.samples_per_pixel;
+	description.settings.max_depth = header.render.max_depth;
+	description.settings.integrator = static_cast<Integrator>(header.render.integrator);
+	description.settings.sampler = static_cast<SamplerType>(header.render.sampler);
+	return description;
+}
+
+namespace {
+	//all words as numbers
+	[[nodiscard]]
+	bool parse_numbers(std::span<const std::string_view> words, std::span<double> values) {
+		if (words.size() != values.size()) return false;
+		for (size_t i = 0; i < words.size(); ++i) {
+			if (!utils::parse_number(words[i], values[i])) return false;
+		}
+		return true;
+	}
+}
+
+std::optional<SceneDescription> read_scene_text(const char* filename, DefaultRayTracer& RT, std::ostream& errors) {
+	if (RT.scene.size() > 0 || RT.materials.size() > 0) return {};
+
+	std::ifstream in{ filename, std::ios::binary };
+	if (!in) {
+		errors << "cannot read " << filename << '\n';
+		return {};
+	}
+	const std::string text{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+	const auto directory = std::filesystem::path{ filename }.parent_path();
+
+	SceneDescription description;
+	std::unordered_map<std::string, MaterialIndex> materials;
+	std::optional<SphereSet> set;
+	size_t line_number = 0;
+
+	auto fail = [&](std::string_view message) -> std::optional<SceneDescription> {
+		errors << filename << ':' << line_number << ": " << message << '\n';
+		return {};
+	};
+
+	std::string_view rest{ text };
+	while (!rest.empty()) {
+		const auto end = rest.find('\n');
+		const auto words = utils::split_words(rest.substr(0, end));
+		rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+		++line_number;
+		if (words.empty()) continue;
+
+		const auto keyword = words[0];
+		const auto arguments = std::span{ words }.subspan(1);
+
+		if (keyword == "image") {
+			if (arguments.size() != 2 || !utils::parse_number(arguments[0], description.width) || !utils::parse_number(arguments[1], description.height)
+				|| description.width == 0 || description.height == 0) {
+				return fail("expected image <width> <height>");
+			}
+		}
+		else if (keyword == "samples") {
+			if (arguments.size() != 1 || !utils::parse_number(arguments[0], description.settings.samples_per_pixel) || description.settings.samples_per_pixel < 1) {
+				return fail("expected samples <per pixel>");
+			}
+		}
+		else if (keyword == "depth") {
+			if (arguments.size() != 1 || !utils::parse_number(arguments[0], description.settings.max_depth) || description.settings.max_depth < 1) {
+				return fail("expected depth <max depth>");
+			}
+		}
+		else if (keyword == "seed") {
+			if (arguments.size() != 1 || !utils::parse_number(arguments[0], description.settings.seed)) return fail("expected seed <seed>");
+		}
+		else if (keyword == "integrator") {
+			constexpr std::pair<std::string_view, Integrator> names[] = {
+				{ "iterative", Integrator::iterative }, { "recursive", Integrator::recursive }, { "wavefront", Integrator::wavefront }
+			};
+			const auto name = std::find_if(std::begin(names), std::end(names), [&](const auto& n) { return arguments.size() == 1 && n.first == arguments[0]; });
+			if (name == std::end(names)) return fail("expected integrator iterative | recursive | wavefront");
+			description.settings.integrator = name->second;
+		}
+		else if (keyword == "sampler") {
+			constexpr std::pair<std::string_view, SamplerType> names[] = {
+				{ "independent", SamplerType::independent }, { "stratified", SamplerType::stratified },
+				{ "sobol", SamplerType::sobol }, { "blue_noise", SamplerType::blue_noise }
+			};
+			const auto name = std::find_if(std::begin(names), std::end(names), [&](const auto& n) { return arguments.size() == 1 && n.first == arguments[0]; });
+			if (name == std::end(names)) return fail("expected sampler independent | stratified | sobol | blue_noise");
+			description.settings.sampler = name->second;
+		}
+		else if (keyword == "camera") {
+			double v[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+			if (arguments.size() < 7 || arguments.size() > 9 || !parse_numbers(arguments, std::span{ v }.first(arguments.size()))) {
+				return fail("expected camera <from x y z> <at x y z> <vfov> [<aperture> [<focus distance>]]");
+			}
+			auto& camera = description.camera;
+			camera.lookfrom = { Scalar(v[0]), Scalar(v[1]), Scalar(v[2]) };
+			camera.lookat = { Scalar(v[3]), Scalar(v[4]), Scalar(v[5]) };
+			camera.vfov = Scalar(v[6]);
+			camera.aperture = Scalar(v[7]);
+			camera.focus_distance = Scalar(v[8]);
+		}
+		else if (keyword == "material") {
+			if (arguments.size() < 2) return fail("expected material <name> <type> <parameters>");
+			const std::string name{ arguments[0] };
+			if (materials.contains(name)) return fail("material " + name + " is defined already");
+
+			const auto type = arguments[1];
+			const auto parameters = arguments.subspan(2);
+			double p[4];
+			if (type == "lambertian" && parse_numbers(parameters, std::span{ p }.first(3))) {
+				materials[name] = RT.materials.emplace_material<Lambertian>(Color{ Scalar(p[0]), Scalar(p[1]), Scalar(p[2]) });
+			}
+			else if (type == "metal" && parse_numbers(parameters, std::span{ p }.first(4))) {
+				materials[name] = RT.materials.emplace_material<Metal>(Color{ Scalar(p[0]), Scalar(p[1]), Scalar(p[2]) }, Scalar(p[3]));
+			}
+			else if (type == "dielectric" && parse_numbers(parameters, std::span{ p }.first(1))) {
+				materials[name] = RT.materials.emplace_material<Dielectric>(Scalar(p[0]));
+			}
+			else if (type == "light" && parse_numbers(parameters, std::span{ p }.first(3))) {
+				materials[name] = RT.materials.emplace_material<DiffuseLight>(Color{ Scalar(p[0]), Scalar(p[1]), Scalar(p[2]) });
+			}
+			else {
+				return fail("expected lambertian <r g b> | metal <r g b> <fuzz> | dielectric <ior> | light <r g b>");
+			}
+		}
+		else if (keyword == "sphere") {
+			double v[4];
+			if (arguments.size() != 5 || !parse_numbers(arguments.first(4), v)) return fail("expected sphere <x y z> <radius> <material>");
+			const auto material = materials.find(std::string{ arguments[4] });
+			if (material == materials.end()) return fail("unknown material " + std::string{ arguments[4] });
+
+			const Position center{ Scalar(v[0]), Scalar(v[1]), Scalar(v[2]) };
+			if (set) set->emplace_back(center, Scalar(v[3]), material->second);
+			else RT.scene.emplace_back<Sphere>(center, Scalar(v[3]), material->second);
+		}
+		else if (keyword == "set") {
+			if (arguments.size() == 1 && arguments[0] == "begin" && !set) {
+				set.emplace();
+			}
+			else if (arguments.size() == 1 && arguments[0] == "end" && set) {
+				if (set->size() > 0) RT.scene.emplace_back<SphereSet>(std::move(*set));
+				set.reset();
+			}
+			else {
+				return fail(set ? "expected set end" : "expected set begin");
+			}
+		}
+		else if (keyword == "mesh") {
+			if (arguments.size() != 2) return fail("expected mesh <file> <material>");
+			const auto material = materials.find(std::string{ arguments[1] });
+			if (material == materials.end()) return fail("unknown material " + std::string{ arguments[1] });
+
+			const auto path = (directory / std::filesystem::path{ arguments[0] }).string();
+			auto mesh = std::filesystem::path{ arguments[0] }.extension() == ".obj"
+				? TriangleMesh::from_obj(path.c_str(), material->second)
+				: TriangleMesh::load(path.c_str(), material->second);
+			if (!mesh) return fail("cannot load mesh " + path);
+			RT.scene.emplace_back<TriangleMesh>(std::move(*mesh));
+		}
+		else {
+			return fail("unknown statement " + std::string{ keyword });
+		}
+	}
+
+	if (set) return fail("set is not ended");
+
+	RT.build();
+	return description;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Scenes.h"
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+
+//Scene files hold materials, spheres, sphere sets and meshes of a DefaultRayTracer together with the camera and render
+//settings. Objects are stored as they are in memory, after build() - spheres in the order of Scene storage, sets and
+//meshes with their BVHs and the top level BVH over all of them - so loading is one mapping of the file, bulk copies of
+//spheres and sets and mesh buffers used in place (see TriangleMesh), with no BVH built and no object made one by one.
+//Files are read by builds of the same Scalar type and byte order, instances are not stored.
+//
+//Scene file: header (see SceneFile.cpp), then materials, spheres, top level primitives and nodes, arrays of sphere sets,
+//embedded mesh files and tables of sets and meshes, each section aligned to 64 bytes.
+//
+//Text scenes (one statement per line, # starts a comment) are compiled into scene files by "RT compile scene.txt scene.rtscene":
+//  image <width> <height>
+//  samples <per pixel>
+//  depth <max depth>
+//  seed <seed>
+//  integrator iterative | recursive | wavefront
+//  sampler independent | stratified | sobol | blue_noise
+//  camera <from x y z> <at x y z> <vfov> [<aperture> [<focus distance>]]    (vup is +y, focus defaults to distance to at)
+//  material <name> lambertian <r g b> | metal <r g b> <fuzz> | dielectric <ior> | light <r g b>
+//  sphere <x y z> <radius> <material>
+//  set begin ... set end                                                     (spheres between go into one SphereSet)
+//  mesh <file> <material>                                                     (.obj or mesh file, relative to the text file)
+
+struct SceneCamera {
+	Position lookfrom{ 0, 0, 1 };
+	Position lookat{ 0, 0, 0 };
+	Direction vup{ 0, 1, 0 };
+	Scalar vfov = 40;
+	Scalar aperture = 0;
+	Scalar focus_distance = 0;      //0 for distance from lookfrom to lookat
+
+	[[nodiscard]]
+	Camera camera(Scalar aspect_ratio) const;
+};
+
+//everything of a scene besides its objects, settings hold only what scene files store (samples_per_pixel, max_depth,
+//integrator, sampler and seed), the rest keeps defaults
+struct SceneDescription {
+	SceneCamera camera;
+	uint64_t height = 400;
+	uint64_t width = 600;
+	RenderSettings settings;
+};
+
+//writes built RT, false if the file cannot be written or RT is not built or has instances
+bool save_scene(const char* filename, const DefaultRayTracer& RT, const SceneDescription& description);
+
+//maps scene file into empty RT, which is ready to render (built, with its lights)
+//empty if RT is not empty or the file cannot be opened or is not a valid scene file of this build
+[[nodiscard]]
+std::optional<SceneDescription> load_scene(const char* filename, DefaultRayTracer& RT);
+
+//parses text scene into empty RT and builds it, errors are reported to errors with their line
+[[nodiscard]]
+std::optional<SceneDescription> read_scene_text(const char* filename, DefaultRayTracer& RT, std::ostream& errors);
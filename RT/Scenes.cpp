@@ -0,0 +1,440 @@
+#include "Scenes.h"
+#include "utils.h"
+#include "Warp.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include <numbers>
+#include <random>
+#include <utility>
+
+void book_scene(DefaultRayTracer& RT, uint64_t seed) {
+	utils::rng.seed(seed);
+
+	auto ground_material = RT.materials.emplace_material<Lambertian>(Color{ 0.5, 0.5, 0.5 });
+	RT.scene.emplace_back<Sphere>(Position{ 0, -1000, 0 }, 1000, ground_material);
+
+	std::discrete_distribution<int> material_dst{ {80, 15, 5} };
+	for (int a = -11; a < 11; ++a) {
+		for (int b = -11; b < 11; ++b) {
+			auto choose_material = material_dst(utils::rng);
+			Position center{ Scalar(a + 0.7 * utils::random_double()), 0.2, Scalar(b + 0.7 * utils::random_double()) };
+
+			if ((center - Position{ 4, 0.2, 0 }).length() > 0.9) {
+				MaterialIndex sphere_material = [&] {
+					switch (choose_material)
+					{
+					case 0: {
+						const auto color = Color::random().elementwise_mul(Color::random());
+						return RT.materials.emplace_material<Lambertian>(color);
+					}
+					case 1: {
+						const auto color = Color::random(0.5, 1);
+						const auto fuzz = utils::random_double(0, 0.5);
+						return RT.materials.emplace_material<Metal>(color, fuzz);
+					}
+					default: {
+						return RT.materials.emplace_material<Dielectric>(1.5);
+					}
+					}
+				}();
+
+				RT.scene.emplace_back<Sphere>(center, 0.2, sphere_material);
+			}
+		}
+	}
+
+	auto material = RT.materials.emplace_material<Dielectric>(1.5);
+	RT.scene.emplace_back<Sphere>(Position{ 0, 1, 0 }, 1.0, material);
+
+	material = RT.materials.emplace_material<Lambertian>(Color{ 0.4, 0.2, 0.1 });
+	RT.scene.emplace_back<Sphere>(Position{ -4, 1, 0 }, 1.0, material);
+
+	material = RT.materials.emplace_material<Metal>(Color{ 0.7, 0.6, 0.5 }, 0.0);
+	RT.scene.emplace_back<Sphere>(Position{ 4, 1, 0 }, 1, material);
+
+	RT.build();
+}
+
+Camera book_camera(Scalar aspect_ratio) {
+	Position lookfrom{ 13, 2, 3 };
+	Position lookat{ 0, 0, 0 };
+	Direction vup{ 0, 1, 0 };
+	Scalar dist_to_focus = 10.0;
+	Scalar aperture = 0.1;
+
+	return {
+		lookfrom,
+		lookat,
+		vup,
+		20,
+		aspect_ratio,
+		aperture,
+		dist_to_focus
+	};
+}
+
+std::optional<Camera> mesh_scene(DefaultRayTracer& RT, const char* filename, Scalar aspect_ratio) {
+	auto mesh = TriangleMesh::load(filename, RT.materials.emplace_material<Lambertian>(Color{ 0.7, 0.7, 0.7 }));
+	if (!mesh) return {};
+
+	const auto bounds = mesh->bounding_box();
+	const auto center = bounds.centroid();
+	const auto size = std::max(bounds.extent().length(), Scalar(1e-3));
+
+	//ground sphere touching bottom of the mesh
+	const auto ground_radius = 1000 * size;
+	auto ground_material = RT.materials.emplace_material<Lambertian>(Color{ 0.5, 0.5, 0.5 });
+	RT.scene.emplace_back<Sphere>(Position{ center.x(), bounds.min.y() - ground_radius, center.z() }, ground_radius, ground_material);
+
+	RT.scene.emplace_back<TriangleMesh>(std::move(*mesh));
+	RT.build();
+
+	const auto lookfrom = center + Direction{ 1.0, 0.5, 1.5 } * size;
+	return Camera{
+		lookfrom,
+		center,
+		Direction{ 0, 1, 0 },
+		30,
+		aspect_ratio,
+		0,
+		(lookfrom - center).length()
+	};
+}
+
+std::shared_ptr<const SphereSet> tree_asset(DefaultRayTracer& RT) {
+	const auto bark = RT.materials.emplace_material<Lambertian>(Color{ 0.3, 0.2, 0.1 });
+	const MaterialIndex leaves[] = {
+		RT.materials.emplace_material<Lambertian>(Color{ 0.1, 0.4, 0.1 }),
+		RT.materials.emplace_material<Lambertian>(Color{ 0.2, 0.5, 0.1 }),
+		RT.materials.emplace_material<Lambertian>(Color{ 0.1, 0.3, 0.05 })
+	};
+
+	auto tree = std::make_shared<SphereSet>();
+	for (int i = 0; i < 12; ++i) {
+		tree->emplace_back(Position{ 0, Scalar(0.1 * i), 0 }, Scalar(0.08 - 0.002 * i), bark);
+	}
+	for (int i = 0; i < 200; ++i) {
+		const auto u = Direction::random();
+		const auto offset = warp::ball_from_cube(u.x(), u.y(), u.z()) * Scalar(0.6);
+		tree->emplace_back(Position{ 0, 1.6, 0 } + offset, Scalar(utils::random_double(0.1, 0.18)), leaves[i % 3]);
+	}
+	tree->build();
+	return tree;
+}
+
+std::vector<Transform> forest_layout(size_t tree_count) {
+	const auto side = static_cast<size_t>(std::ceil(std::sqrt(double(tree_count))));
+	constexpr Scalar spacing = 2;
+
+	std::vector<Transform> transforms;
+	transforms.reserve(tree_count);
+	for (size_t i = 0; i < tree_count; ++i) {
+		const auto x = (Scalar(i % side) - Scalar(side) / 2 + Scalar(utils::random_double(0, 0.6))) * spacing;
+		const auto z = (Scalar(i / side) - Scalar(side) / 2 + Scalar(utils::random_double(0, 0.6))) * spacing;
+		const auto angle = Scalar(utils::random_double(0, 2 * std::numbers::pi));
+		const auto scale = Scalar(utils::random_double(0.7, 1.3));
+
+		transforms.push_back(Transform::translation(Position{ x, 0, z })
+			* Transform::rotation(Direction{ 0, 1, 0 }, angle)
+			* Transform::scaling(scale));
+	}
+	return transforms;
+}
+
+std::vector<PrimitiveIndex> forest_scene(DefaultRayTracer& RT, size_t tree_count) {
+	auto ground_material = RT.materials.emplace_material<Lambertian>(Color{ 0.4, 0.35, 0.25 });
+	RT.scene.emplace_back<Sphere>(Position{ 0, -10000, 0 }, 10000, ground_material);
+
+	const auto tree = tree_asset(RT);
+	std::vector<PrimitiveIndex> trees;
+	for (const auto& transform : forest_layout(tree_count)) {
+		trees.push_back(RT.scene.emplace_back<Instance<SphereSet>>(tree, transform));
+	}
+
+	RT.build();
+	return trees;
+}
+
+Camera forest_camera(size_t tree_count, Scalar aspect_ratio) {
+	const auto half_size = std::sqrt(Scalar(tree_count));
+	const Position lookfrom{ -half_size, 4, -half_size };
+	const Position lookat{ 0, 0, 0 };
+
+	return {
+		lookfrom,
+		lookat,
+		Direction{ 0, 1, 0 },
+		40,
+		aspect_ratio,
+		0,
+		(lookfrom - lookat).length()
+	};
+}
+
+Animation forest_animation(DefaultRayTracer& RT, size_t tree_count, size_t moving_count, uint64_t frame_count) {
+	const auto trees = forest_scene(RT, tree_count);
+	const auto& instances = RT.scene.objects_of_type<Instance<SphereSet>>();
+
+	Animation animation;
+	animation.frame_count = frame_count;
+	const auto duration = frame_count / animation.frame_rate;
+
+	//keys every 0.1 s turn trees by 3 degrees, close enough for blended matrices to keep their size
+	constexpr double key_interval = 0.1;
+	constexpr Scalar degrees_per_second = 30;
+	constexpr Scalar speed = 1;
+	const auto key_count = static_cast<size_t>(std::ceil(duration / key_interval)) + 1;
+	for (size_t i = 0; i < std::min(moving_count, trees.size()); ++i) {
+		const auto placement = instances[trees[i].vector_index].transform();
+		ObjectTrack track{ trees[i], {} };
+		for (size_t k = 0; k < key_count; ++k) {
+			const auto time = Scalar(k * key_interval);
+			const auto spin = Transform::rotation(Direction{ 0, 1, 0 }, time * degrees_per_second * std::numbers::pi_v<Scalar> / 180);
+			const auto slide = Transform::translation(Direction{ time * speed * (i % 2 ? 1 : -1), 0, 0 });
+			track.keys.push_back({ k * key_interval, slide * placement * spin });
+		}
+		animation.objects.push_back(std::move(track));
+	}
+
+	const auto half_size = std::sqrt(Scalar(tree_count));
+	animation.camera.keys = {
+		{ 0, Position{ -half_size, 4, -half_size }, Position{ 0, 0, 0 } },
+		{ duration, Position{ -half_size / 2, 3, -half_size / 2 }, Position{ 0, 0, 0 } }
+	};
+	return animation;
+}
+
+namespace {
+	//two sided quads, each given by a corner and two edges
+	TriangleMesh quads(std::initializer_list<std::array<Position, 3>> sides, const MaterialIndex& material) {
+		std::vector<TriangleMesh::Vertex> vertices;
+		std::vector<TriangleMesh::Triangle> triangles;
+		for (const auto& [corner, u, v] : sides) {
+			const auto first = static_cast<uint32_t>(vertices.size());
+			for (const auto& p : { corner, corner + u, corner + u + v, corner + v }) {
+				vertices.push_back({ float(p.x()), float(p.y()), float(p.z()) });
+			}
+			triangles.push_back({ first, first + 1, first + 2 });
+			triangles.push_back({ first, first + 2, first + 3 });
+		}
+		return { std::move(vertices), std::move(triangles), material };
+	}
+}
+
+void room_scene(DefaultRayTracer& RT) {
+	const auto white = RT.materials.emplace_material<Lambertian>(Color{ 0.73, 0.73, 0.73 });
+	const auto red = RT.materials.emplace_material<Lambertian>(Color{ 0.65, 0.05, 0.05 });
+	const auto green = RT.materials.emplace_material<Lambertian>(Color{ 0.12, 0.45, 0.15 });
+
+	//x in [-1, 1], y in [0, 2], z in [-1, 3]
+	RT.scene.emplace_back<TriangleMesh>(quads({
+		{ Position{ -1, 0, -1 }, Direction{ 2, 0, 0 }, Direction{ 0, 0, 4 } },
+		{ Position{ -1, 2, -1 }, Direction{ 2, 0, 0 }, Direction{ 0, 0, 4 } },
+		{ Position{ -1, 0, -1 }, Direction{ 2, 0, 0 }, Direction{ 0, 2, 0 } },
+		{ Position{ -1, 0, 3 }, Direction{ 2, 0, 0 }, Direction{ 0, 2, 0 } }
+	}, white));
+	RT.scene.emplace_back<TriangleMesh>(quads({ { Position{ -1, 0, -1 }, Direction{ 0, 2, 0 }, Direction{ 0, 0, 4 } } }, red));
+	RT.scene.emplace_back<TriangleMesh>(quads({ { Position{ 1, 0, -1 }, Direction{ 0, 2, 0 }, Direction{ 0, 0, 4 } } }, green));
+
+	RT.scene.emplace_back<Sphere>(Position{ 0, 1.8, 0 }, 0.1, RT.materials.emplace_material<DiffuseLight>(Color{ 40, 36, 30 }));
+
+	RT.scene.emplace_back<Sphere>(Position{ -0.45, 0.35, -0.3 }, 0.35, RT.materials.emplace_material<Dielectric>(1.5));
+	RT.scene.emplace_back<Sphere>(Position{ 0.45, 0.35, 0.2 }, 0.35, white);
+	RT.scene.emplace_back<Sphere>(Position{ 0.1, 0.15, 0.8 }, 0.15, RT.materials.emplace_material<Metal>(Color{ 0.8, 0.8, 0.8 }, 0.1));
+
+	RT.build();
+}
+
+Camera room_camera(Scalar aspect_ratio) {
+	const Position lookfrom{ 0, 1, 2.9 };
+	const Position lookat{ 0, 0.8, 0 };
+
+	return {
+		lookfrom,
+		lookat,
+		Direction{ 0, 1, 0 },
+		50,
+		aspect_ratio,
+		0,
+		(lookfrom - lookat).length()
+	};
+}
+
+std::pair<std::vector<TriangleMesh::Vertex>, std::vector<TriangleMesh::Triangle>> sphere_mesh(uint32_t stacks, uint32_t slices) {
+	std::vector<TriangleMesh::Vertex> vertices;
+	std::vector<TriangleMesh::Triangle> triangles;
+
+	vertices.push_back({ 0, 1, 0 });
+	for (uint32_t i = 1; i < stacks; ++i) {
+		const auto theta = std::numbers::pi * i / stacks;
+		for (uint32_t j = 0; j < slices; ++j) {
+			const auto phi = 2 * std::numbers::pi * j / slices;
+			vertices.push_back({ float(std::sin(theta) * std::cos(phi)), float(std::cos(theta)), float(std::sin(theta) * std::sin(phi)) });
+		}
+	}
+	vertices.push_back({ 0, -1, 0 });
+
+	const auto south = static_cast<uint32_t>(vertices.size() - 1);
+	auto ring = [&](uint32_t i, uint32_t j) { return 1 + (i - 1) * slices + j % slices; };
+	for (uint32_t j = 0; j < slices; ++j) {
+		triangles.push_back({ 0, ring(1, j + 1), ring(1, j) });
+		triangles.push_back({ south, ring(stacks - 1, j), ring(stacks - 1, j + 1) });
+		for (uint32_t i = 1; i + 1 < stacks; ++i) {
+			triangles.push_back({ ring(i, j), ring(i, j + 1), ring(i + 1, j) });
+			triangles.push_back({ ring(i, j + 1), ring(i + 1, j + 1), ring(i + 1, j) });
+		}
+	}
+	return { std::move(vertices), std::move(triangles) };
+}
+
+void sphere_grid_scene(DefaultRayTracer& RT, size_t sphere_count, uint64_t seed) {
+	utils::rng.seed(seed);
+
+	const MaterialIndex materials[] = {
+		RT.materials.emplace_material<Lambertian>(Color{ 0.7, 0.3, 0.2 }),
+		RT.materials.emplace_material<Lambertian>(Color{ 0.2, 0.5, 0.7 }),
+		RT.materials.emplace_material<Metal>(Color{ 0.8, 0.8, 0.7 }, 0.2),
+		RT.materials.emplace_material<Dielectric>(1.5)
+	};
+
+	//unit spacing, spheres fill about a sixth of the cube
+	const auto side = static_cast<size_t>(std::ceil(std::cbrt(double(sphere_count))));
+	const auto half_side = Scalar(side) / 2;
+	SphereSet spheres;
+	for (size_t i = 0; i < sphere_count; ++i) {
+		const Position center{
+			Scalar(i % side) - half_side + Scalar(utils::random_double(0.2, 0.8)),
+			Scalar(i / side % side) - half_side + Scalar(utils::random_double(0.2, 0.8)),
+			Scalar(i / side / side) - half_side + Scalar(utils::random_double(0.2, 0.8))
+		};
+		spheres.emplace_back(center, Scalar(utils::random_double(0.15, 0.3)), materials[i % std::size(materials)]);
+	}
+	RT.scene.emplace_back<SphereSet>(std::move(spheres));
+
+	RT.build();
+}
+
+Camera sphere_grid_camera(size_t sphere_count, Scalar aspect_ratio) {
+	const auto half_side = Scalar(std::cbrt(double(sphere_count))) / 2;
+	const Position lookfrom{ 2.6f * half_side, 2 * half_side, 3.2f * half_side };
+	const Position lookat{ 0, 0, 0 };
+
+	return {
+		lookfrom,
+		lookat,
+		Direction{ 0, 1, 0 },
+		40,
+		aspect_ratio,
+		0,
+		(lookfrom - lookat).length()
+	};
+}
+
+void glass_scene(DefaultRayTracer& RT, uint64_t seed) {
+	utils::rng.seed(seed);
+
+	auto ground_material = RT.materials.emplace_material<Lambertian>(Color{ 0.5, 0.5, 0.5 });
+	RT.scene.emplace_back<Sphere>(Position{ 0, -1000, 0 }, 1000, ground_material);
+
+	//glass in front, hollow ones have an inner surface of negative radius
+	constexpr Scalar indices[] = { 1.33, 1.5, 1.9, 2.4 };
+	for (int row = 0; row < 4; ++row) {
+		for (int column = -4; column <= 4; ++column) {
+			const auto radius = Scalar(utils::random_double(0.25, 0.4));
+			const Position center{ Scalar(column), radius, Scalar(row) };
+			const auto glass = RT.materials.emplace_material<Dielectric>(indices[(row + column + 4) % std::size(indices)]);
+			RT.scene.emplace_back<Sphere>(center, radius, glass);
+			if ((row + column) % 2 == 0) RT.scene.emplace_back<Sphere>(center, -Scalar(0.9) * radius, glass);
+		}
+	}
+
+	//diffuse behind, seen through the glass
+	for (int column = -6; column <= 6; ++column) {
+		const auto color = Color::random(0.2, 0.9);
+		RT.scene.emplace_back<Sphere>(Position{ Scalar(column), 0.6, -2 }, 0.6, RT.materials.emplace_material<Lambertian>(color));
+	}
+
+	RT.build();
+}
+
+Camera glass_camera(Scalar aspect_ratio) {
+	const Position lookfrom{ 0, 2.5, 9 };
+	const Position lookat{ 0, 0.3, 0.5 };
+
+	return {
+		lookfrom,
+		lookat,
+		Direction{ 0, 1, 0 },
+		45,
+		aspect_ratio,
+		0,
+		(lookfrom - lookat).length()
+	};
+}
+
+void tessellated_scene(DefaultRayTracer& RT, uint32_t stacks, uint32_t slices) {
+	auto ground_material = RT.materials.emplace_material<Lambertian>(Color{ 0.5, 0.5, 0.5 });
+	RT.scene.emplace_back<Sphere>(Position{ 0, -1000, 0 }, 1000, ground_material);
+
+	const MaterialIndex materials[] = {
+		RT.materials.emplace_material<Lambertian>(Color{ 0.4, 0.2, 0.1 }),
+		RT.materials.emplace_material<Metal>(Color{ 0.7, 0.6, 0.5 }, 0.05),
+		RT.materials.emplace_material<Dielectric>(1.5)
+	};
+
+	const auto [unit_vertices, triangles] = sphere_mesh(stacks, slices);
+	for (int i = 0; i < 3; ++i) {
+		auto vertices = unit_vertices;
+		for (auto& v : vertices) {
+			v[0] += float(2.2 * (i - 1));
+			v[1] += 1;
+		}
+		RT.scene.emplace_back<TriangleMesh>(TriangleMesh{ std::move(vertices), triangles, materials[i] });
+	}
+
+	RT.build();
+}
+
+Camera tessellated_camera(Scalar aspect_ratio) {
+	const Position lookfrom{ 3, 3, 9 };
+	const Position lookat{ 0, 0.8, 0 };
+
+	return {
+		lookfrom,
+		lookat,
+		Direction{ 0, 1, 0 },
+		35,
+		aspect_ratio,
+		0,
+		(lookfrom - lookat).length()
+	};
+}
+
+std::optional<Camera> named_scene(DefaultRayTracer& RT, std::string_view name, Scalar aspect_ratio) {
+	constexpr size_t sphere_grid_count = 100'000;
+
+	if (name == "book") {
+		book_scene(RT);
+		return book_camera(aspect_ratio);
+	}
+	if (name == "room") {
+		room_scene(RT);
+		return room_camera(aspect_ratio);
+	}
+	if (name == "glass") {
+		glass_scene(RT);
+		return glass_camera(aspect_ratio);
+	}
+	if (name == "mesh") {
+		tessellated_scene(RT, 128, 256);
+		return tessellated_camera(aspect_ratio);
+	}
+	if (name == "sphere_grid") {
+		sphere_grid_scene(RT, sphere_grid_count);
+		return sphere_grid_camera(sphere_grid_count, aspect_ratio);
+	}
+	return {};
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "RayTracer.h"
+#include "Sphere.h"
+#include "SphereSet.h"
+#include "TriangleMesh.h"
+#include "Instance.h"
+#include "Materials.h"
+#include "Camera.h"
+#include "Animation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using DefaultRayTracer = RayTracer<TypeList<Sphere, SphereSet, TriangleMesh, Instance<SphereSet>, Instance<TriangleMesh>>, TypeList<Lambertian, Metal, Dielectric, DiffuseLight>>;
+
+//scenes are built with RT.build(), so emissive spheres become lights sampled at diffuse hits
+
+//random spheres from the cover of Ray Tracing in One Weekend, the same for the same seed
+void book_scene(DefaultRayTracer& RT, uint64_t seed = 0);
+
+[[nodiscard]]
+Camera book_camera(Scalar aspect_ratio);
+
+//mesh file (see TriangleMesh) standing on the ground, returns camera looking at it or empty if the file cannot be loaded
+[[nodiscard]]
+std::optional<Camera> mesh_scene(DefaultRayTracer& RT, const char* filename, Scalar aspect_ratio);
+
+//tree made of spheres, trunk along y from the origin and crown around y = 1.6, built and ready to be shared
+[[nodiscard]]
+std::shared_ptr<const SphereSet> tree_asset(DefaultRayTracer& RT);
+
+//placements of trees on a jittered grid with random rotation about y and uniform scale, about 2 units apart
+[[nodiscard]]
+std::vector<Transform> forest_layout(size_t tree_count);
+
+//trees of forest_layout, all instances of one shared tree_asset, on the ground, returns indices of the trees
+std::vector<PrimitiveIndex> forest_scene(DefaultRayTracer& RT, size_t tree_count);
+
+[[nodiscard]]
+Camera forest_camera(size_t tree_count, Scalar aspect_ratio);
+
+//forest_scene whose first moving_count trees slide and spin while the camera moves in, frame_count frames at 24 fps
+[[nodiscard]]
+Animation forest_animation(DefaultRayTracer& RT, size_t tree_count, size_t moving_count, uint64_t frame_count);
+
+//closed room with colored walls lit only by a small spherical light under the ceiling, camera is inside
+void room_scene(DefaultRayTracer& RT);
+
+[[nodiscard]]
+Camera room_camera(Scalar aspect_ratio);
+
+//closed latitude-longitude sphere of radius 1 around the origin, vertices on poles and seam are shared
+[[nodiscard]]
+std::pair<std::vector<TriangleMesh::Vertex>, std::vector<TriangleMesh::Triangle>> sphere_mesh(uint32_t stacks, uint32_t slices);
+
+//Canonical scenes of the benchmark suite, fixed by their seed so that results of different commits are comparable.
+
+//sphere_count small spheres of mixed materials in one SphereSet, on a jittered cubic grid seen from outside
+void sphere_grid_scene(DefaultRayTracer& RT, size_t sphere_count, uint64_t seed = 0);
+
+[[nodiscard]]
+Camera sphere_grid_camera(size_t sphere_count, Scalar aspect_ratio);
+
+//rows of solid and hollow glass spheres of different index of refraction in front of colored diffuse ones
+void glass_scene(DefaultRayTracer& RT, uint64_t seed = 0);
+
+[[nodiscard]]
+Camera glass_camera(Scalar aspect_ratio);
+
+//three tessellated spheres (diffuse, metal, glass) of 2 * stacks * slices triangles each on the ground
+void tessellated_scene(DefaultRayTracer& RT, uint32_t stacks, uint32_t slices);
+
+[[nodiscard]]
+Camera tessellated_camera(Scalar aspect_ratio);
+
+//scene of the given name (book, room, glass, mesh, sphere_grid) built into RT with its camera, empty for other names
+//lets processes which render parts of one frame build the same scene, see Distributed.h
+[[nodiscard]]
+std::optional<Camera> named_scene(DefaultRayTracer& RT, std::string_view name, Scalar aspect_ratio);
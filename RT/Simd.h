@@ -0,0 +1,74 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RT_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//kernels using wider instruction sets than the rest of the program are compiled with target attribute on gcc/clang,
+//msvc allows the intrinsics anywhere
+#if defined(__GNUC__)
+#define RT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define RT_TARGET(isa)
+#endif
+
+#include <algorithm>
+
+namespace simd {
+	enum class Level {
+		scalar,
+		avx2,
+		avx512
+	};
+
+	[[nodiscard]]
+	inline const char* name(Level level) noexcept {
+		switch (level) {
+		case Level::avx2: return "avx2";
+		case Level::avx512: return "avx512";
+		default: return "scalar";
+		}
+	}
+
+	//best level supported by both cpu and os
+	[[nodiscard]]
+	inline Level detect() noexcept {
+#if defined(RT_X86) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return Level::scalar;
+
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!osxsave) return Level::scalar;
+		const auto xcr0 = _xgetbv(0);
+
+		__cpuidex(info, 7, 0);
+		const bool avx2 = (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+		const bool avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+
+		return avx512 ? Level::avx512 : avx2 ? Level::avx2 : Level::scalar;
+#elif defined(RT_X86) && defined(__GNUC__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) return Level::avx512;
+		if (__builtin_cpu_supports("avx2")) return Level::avx2;
+		return Level::scalar;
+#else
+		return Level::scalar;
+#endif
+	}
+
+	//level used by kernels, can be lowered (e.g. to compare kernels) but not raised above detected one
+	inline Level& active_level() noexcept {
+		static Level level = detect();
+		return level;
+	}
+
+	inline void set_level(Level level) noexcept {
+		active_level() = std::min(level, detect());
+	}
+}
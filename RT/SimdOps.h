@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Simd.h"
+
+#include <cstdint>
+
+//Included by files with SIMD kernels after they turn off floating point contraction, so that
+//wrappers inlined into kernels round exactly like scalar code.
+
+#ifdef RT_X86
+namespace simd {
+	//thin wrappers over intrinsics, so that one kernel serves both precisions
+	template <typename T>
+	struct Avx2;
+
+	template <>
+	struct Avx2<double> {
+		using Reg = __m256d;
+		using Index = __m256i;
+		using IndexLane = int64_t;
+		static constexpr uint32_t width = 4;
+
+		RT_TARGET("avx2") static Reg set1(double v) { return _mm256_set1_pd(v); }
+		RT_TARGET("avx2") static Reg load(const double* p) { return _mm256_loadu_pd(p); }
+		RT_TARGET("avx2") static Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+		RT_TARGET("avx2") static Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+		RT_TARGET("avx2") static Reg mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+		RT_TARGET("avx2") static Reg div(Reg a, Reg b) { return _mm256_div_pd(a, b); }
+		RT_TARGET("avx2") static Reg sqrt(Reg a) { return _mm256_sqrt_pd(a); }
+		RT_TARGET("avx2") static Reg in_range(Reg t, Reg lower, Reg upper) {
+			return _mm256_and_pd(_mm256_cmp_pd(t, lower, _CMP_GE_OQ), _mm256_cmp_pd(t, upper, _CMP_LE_OQ));
+		}
+		RT_TARGET("avx2") static Reg mask_or(Reg a, Reg b) { return _mm256_or_pd(a, b); }
+		RT_TARGET("avx2") static Reg mask_and(Reg a, Reg b) { return _mm256_and_pd(a, b); }
+		RT_TARGET("avx2") static Reg less_equal(Reg a, Reg b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+		RT_TARGET("avx2") static Reg less(Reg a, Reg b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+		RT_TARGET("avx2") static Reg min(Reg a, Reg b) { return _mm256_min_pd(a, b); }
+		RT_TARGET("avx2") static Reg max(Reg a, Reg b) { return _mm256_max_pd(a, b); }
+		//one bit per lane
+		RT_TARGET("avx2") static uint32_t movemask(Reg mask) { return static_cast<uint32_t>(_mm256_movemask_pd(mask)); }
+		//b where mask is set, a elsewhere
+		RT_TARGET("avx2") static Reg blend(Reg a, Reg b, Reg mask) { return _mm256_blendv_pd(a, b, mask); }
+		RT_TARGET("avx2") static void store(double* p, Reg a) { _mm256_storeu_pd(p, a); }
+
+		RT_TARGET("avx2") static Index iota(uint32_t first) { return _mm256_add_epi64(_mm256_set1_epi64x(first), _mm256_setr_epi64x(0, 1, 2, 3)); }
+		RT_TARGET("avx2") static Index index_set1(int64_t v) { return _mm256_set1_epi64x(v); }
+		RT_TARGET("avx2") static Index index_add(Index a, Index b) { return _mm256_add_epi64(a, b); }
+		RT_TARGET("avx2") static Index index_blend(Index a, Index b, Reg mask) { return _mm256_blendv_epi8(a, b, _mm256_castpd_si256(mask)); }
+		RT_TARGET("avx2") static void index_store(IndexLane* p, Index a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a); }
+	};
+
+	template <>
+	struct Avx2<float> {
+		using Reg = __m256;
+		using Index = __m256i;
+		using IndexLane = int32_t;
+		static constexpr uint32_t width = 8;
+
+		RT_TARGET("avx2") static Reg set1(float v) { return _mm256_set1_ps(v); }
+		RT_TARGET("avx2") static Reg load(const float* p) { return _mm256_loadu_ps(p); }
+		RT_TARGET("avx2") static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+		RT_TARGET("avx2") static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+		RT_TARGET("avx2") static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+		RT_TARGET("avx2") static Reg div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+		RT_TARGET("avx2") static Reg sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+		RT_TARGET("avx2") static Reg in_range(Reg t, Reg lower, Reg upper) {
+			return _mm256_and_ps(_mm256_cmp_ps(t, lower, _CMP_GE_OQ), _mm256_cmp_ps(t, upper, _CMP_LE_OQ));
+		}
+		RT_TARGET("avx2") static Reg mask_or(Reg a, Reg b) { return _mm256_or_ps(a, b); }
+		RT_TARGET("avx2") static Reg mask_and(Reg a, Reg b) { return _mm256_and_ps(a, b); }
+		RT_TARGET("avx2") static Reg less_equal(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		RT_TARGET("avx2") static Reg less(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		RT_TARGET("avx2") static Reg min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+		RT_TARGET("avx2") static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+		//one bit per lane
+		RT_TARGET("avx2") static uint32_t movemask(Reg mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+		RT_TARGET("avx2") static Reg blend(Reg a, Reg b, Reg mask) { return _mm256_blendv_ps(a, b, mask); }
+		RT_TARGET("avx2") static void store(float* p, Reg a) { _mm256_storeu_ps(p, a); }
+
+		RT_TARGET("avx2") static Index iota(uint32_t first) { return _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(first)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)); }
+		RT_TARGET("avx2") static Index index_set1(int32_t v) { return _mm256_set1_epi32(v); }
+		RT_TARGET("avx2") static Index index_add(Index a, Index b) { return _mm256_add_epi32(a, b); }
+		RT_TARGET("avx2") static Index index_blend(Index a, Index b, Reg mask) { return _mm256_blendv_epi8(a, b, _mm256_castps_si256(mask)); }
+		RT_TARGET("avx2") static void index_store(IndexLane* p, Index a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a); }
+	};
+
+	template <typename T>
+	struct Avx512;
+
+	template <>
+	struct Avx512<double> {
+		using Reg = __m512d;
+		using Mask = __mmask8;
+		using Index = __m512i;
+		using IndexLane = int64_t;
+		static constexpr uint32_t width = 8;
+
+		RT_TARGET("avx512f") static Reg set1(double v) { return _mm512_set1_pd(v); }
+		RT_TARGET("avx512f") static Reg load(const double* p) { return _mm512_loadu_pd(p); }
+		RT_TARGET("avx512f") static Reg add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+		RT_TARGET("avx512f") static Reg sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+		RT_TARGET("avx512f") static Reg mul(Reg a, Reg b) { return _mm512_mul_pd(a, b); }
+		RT_TARGET("avx512f") static Reg div(Reg a, Reg b) { return _mm512_div_pd(a, b); }
+		RT_TARGET("avx512f") static Reg sqrt(Reg a) { return _mm512_sqrt_pd(a); }
+		RT_TARGET("avx512f") static Mask in_range(Reg t, Reg lower, Reg upper) {
+			return _mm512_cmp_pd_mask(t, lower, _CMP_GE_OQ) & _mm512_cmp_pd_mask(t, upper, _CMP_LE_OQ);
+		}
+		RT_TARGET("avx512f") static Reg blend(Reg a, Reg b, Mask mask) { return _mm512_mask_blend_pd(mask, a, b); }
+		RT_TARGET("avx512f") static void store(double* p, Reg a) { _mm512_storeu_pd(p, a); }
+
+		RT_TARGET("avx512f") static Index iota(uint32_t first) { return _mm512_add_epi64(_mm512_set1_epi64(first), _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7)); }
+		RT_TARGET("avx512f") static Index index_set1(int64_t v) { return _mm512_set1_epi64(v); }
+		RT_TARGET("avx512f") static Index index_add(Index a, Index b) { return _mm512_add_epi64(a, b); }
+		RT_TARGET("avx512f") static Index index_blend(Index a, Index b, Mask mask) { return _mm512_mask_blend_epi64(mask, a, b); }
+		RT_TARGET("avx512f") static void index_store(IndexLane* p, Index a) { _mm512_storeu_si512(p, a); }
+	};
+
+	template <>
+	struct Avx512<float> {
+		using Reg = __m512;
+		using Mask = __mmask16;
+		using Index = __m512i;
+		using IndexLane = int32_t;
+		static constexpr uint32_t width = 16;
+
+		RT_TARGET("avx512f") static Reg set1(float v) { return _mm512_set1_ps(v); }
+		RT_TARGET("avx512f") static Reg load(const float* p) { return _mm512_loadu_ps(p); }
+		RT_TARGET("avx512f") static Reg add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+		RT_TARGET("avx512f") static Reg sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+		RT_TARGET("avx512f") static Reg mul(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+		RT_TARGET("avx512f") static Reg div(Reg a, Reg b) { return _mm512_div_ps(a, b); }
+		RT_TARGET("avx512f") static Reg sqrt(Reg a) { return _mm512_sqrt_ps(a); }
+		RT_TARGET("avx512f") static Mask in_range(Reg t, Reg lower, Reg upper) {
+			return _mm512_cmp_ps_mask(t, lower, _CMP_GE_OQ) & _mm512_cmp_ps_mask(t, upper, _CMP_LE_OQ);
+		}
+		RT_TARGET("avx512f") static Reg blend(Reg a, Reg b, Mask mask) { return _mm512_mask_blend_ps(mask, a, b); }
+		RT_TARGET("avx512f") static void store(float* p, Reg a) { _mm512_storeu_ps(p, a); }
+
+		RT_TARGET("avx512f") static Index iota(uint32_t first) {
+			return _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(first)), _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+		}
+		RT_TARGET("avx512f") static Index index_set1(int32_t v) { return _mm512_set1_epi32(v); }
+		RT_TARGET("avx512f") static Index index_add(Index a, Index b) { return _mm512_add_epi32(a, b); }
+		RT_TARGET("avx512f") static Index index_blend(Index a, Index b, Mask mask) { return _mm512_mask_blend_epi32(mask, a, b); }
+		RT_TARGET("avx512f") static void index_store(IndexLane* p, Index a) { _mm512_storeu_si512(p, a); }
+	};
+}
+#endif
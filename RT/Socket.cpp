@@ -0,0 +1,205 @@
+#include "Socket.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+	using NativeSocket = SOCKET;
+
+	//Winsock has to be started before the first socket is made, it is left running until exit
+	bool start_sockets() {
+		static const bool started = [] {
+			WSADATA data;
+			return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+		}();
+		return started;
+	}
+
+	void close_socket(NativeSocket socket) noexcept {
+		closesocket(socket);
+	}
+
+	constexpr int send_flags = 0;
+	constexpr int shutdown_both = SD_BOTH;
+#else
+	using NativeSocket = int;
+
+	bool start_sockets() {
+		return true;
+	}
+
+	void close_socket(NativeSocket socket) noexcept {
+		close(socket);
+	}
+
+	//writes to connections closed by the other side fail instead of raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+	constexpr int send_flags = MSG_NOSIGNAL;
+#else
+	constexpr int send_flags = 0;
+#endif
+	constexpr int shutdown_both = SHUT_RDWR;
+#endif
+
+	NativeSocket native(uintptr_t handle) noexcept {
+		return static_cast<NativeSocket>(handle);
+	}
+
+	//Nagle's algorithm would hold back small messages (e.g. task headers) until the previous one is acknowledged
+	void disable_delay(NativeSocket socket) noexcept {
+		int enabled = 1;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+	}
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+	if (this != &other) {
+		if (handle_ != invalid) close_socket(native(handle_));
+		handle_ = other.handle_;
+		other.handle_ = invalid;
+	}
+	return *this;
+}
+
+Socket::~Socket() {
+	if (handle_ != invalid) close_socket(native(handle_));
+}
+
+std::optional<Socket> Socket::connect(const char* host, uint16_t port) {
+	if (!start_sockets()) return {};
+
+	addrinfo hints{};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	char service[8];
+	std::snprintf(service, sizeof(service), "%u", unsigned{ port });
+
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(host, service, &hints, &addresses) != 0) return {};
+
+	std::optional<Socket> result;
+	for (auto* address = addresses; address && !result; address = address->ai_next) {
+		const auto socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (static_cast<uintptr_t>(socket) == invalid) continue;
+		if (::connect(socket, address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0) {
+			close_socket(socket);
+			continue;
+		}
+		disable_delay(socket);
+		result = Socket{ static_cast<uintptr_t>(socket) };
+	}
+	freeaddrinfo(addresses);
+	return result;
+}
+
+bool Socket::send_all(const void* data, size_t size) noexcept {
+	const auto* bytes = static_cast<const char*>(data);
+	while (size > 0) {
+		const auto chunk = static_cast<int>(std::min<size_t>(size, INT_MAX));
+		const auto sent = ::send(native(handle_), bytes, chunk, send_flags);
+		if (sent <= 0) return false;
+		bytes += sent;
+		size -= static_cast<size_t>(sent);
+	}
+	return true;
+}
+
+bool Socket::receive_all(void* data, size_t size) noexcept {
+	auto* bytes = static_cast<char*>(data);
+	while (size > 0) {
+		const auto chunk = static_cast<int>(std::min<size_t>(size, INT_MAX));
+		const auto received = ::recv(native(handle_), bytes, chunk, 0);
+		if (received <= 0) return false;
+		bytes += received;
+		size -= static_cast<size_t>(received);
+	}
+	return true;
+}
+
+bool Socket::set_timeout(double seconds) noexcept {
+#ifdef _WIN32
+	const DWORD timeout = static_cast<DWORD>(std::lround(seconds * 1e3));
+#else
+	timeval timeout{};
+	timeout.tv_sec = static_cast<decltype(timeout.tv_sec)>(seconds);
+	timeout.tv_usec = static_cast<decltype(timeout.tv_usec)>((seconds - std::floor(seconds)) * 1e6);
+#endif
+	const auto option = reinterpret_cast<const char*>(&timeout);
+	return setsockopt(native(handle_), SOL_SOCKET, SO_RCVTIMEO, option, sizeof(timeout)) == 0
+		&& setsockopt(native(handle_), SOL_SOCKET, SO_SNDTIMEO, option, sizeof(timeout)) == 0;
+}
+
+void Socket::shutdown() noexcept {
+	::shutdown(native(handle_), shutdown_both);
+}
+
+std::optional<Listener> Listener::listen(uint16_t port, const char* address) {
+	if (!start_sockets()) return {};
+
+	sockaddr_in local{};
+	local.sin_family = AF_INET;
+	local.sin_port = htons(port);
+	if (inet_pton(AF_INET, address, &local.sin_addr) != 1) return {};
+
+	const auto socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (static_cast<uintptr_t>(socket) == Socket::invalid) return {};
+	Socket owner{ static_cast<uintptr_t>(socket) };
+
+#ifndef _WIN32
+	//coordinator can be restarted on the same port while connections of the previous one are timing out
+	int reuse = 1;
+	setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
+	if (bind(socket, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) return {};
+	if (::listen(socket, SOMAXCONN) != 0) return {};
+
+	return Listener{ std::move(owner) };
+}
+
+uint16_t Listener::port() const noexcept {
+	sockaddr_in address{};
+	socklen_t size = sizeof(address);
+	if (getsockname(native(socket_.handle_), reinterpret_cast<sockaddr*>(&address), &size) != 0) return 0;
+	return ntohs(address.sin_port);
+}
+
+std::optional<Socket> Listener::accept(double timeout) {
+	const auto socket = native(socket_.handle_);
+	pollfd request{};
+	request.fd = socket;
+	request.events = POLLIN;
+	const auto milliseconds = static_cast<int>(std::lround(timeout * 1e3));
+#ifdef _WIN32
+	if (WSAPoll(&request, 1, milliseconds) <= 0) return {};
+#else
+	if (poll(&request, 1, milliseconds) <= 0) return {};
+#endif
+
+	const auto connection = ::accept(socket, nullptr, nullptr);
+	if (static_cast<uintptr_t>(connection) == Socket::invalid) return {};
+	disable_delay(connection);
+	return Socket{ static_cast<uintptr_t>(connection) };
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+//Blocking TCP connection, closed on destruction.
+class Socket {
+	static constexpr uintptr_t invalid = UINTPTR_MAX;
+
+	uintptr_t handle_ = invalid;
+
+	friend class Listener;
+	explicit Socket(uintptr_t handle) noexcept : handle_{ handle } {}
+
+public:
+	Socket(Socket&& other) noexcept : handle_{ other.handle_ } {
+		other.handle_ = invalid;
+	}
+	Socket& operator=(Socket&& other) noexcept;
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+	~Socket();
+
+	//empty if host cannot be resolved or nothing listens on the port
+	[[nodiscard]]
+	static std::optional<Socket> connect(const char* host, uint16_t port);
+
+	//false if the connection is broken, otherwise all of data has been sent
+	bool send_all(const void* data, size_t size) noexcept;
+
+	//false if the connection is closed or broken or timeout runs out before all of size bytes came
+	bool receive_all(void* data, size_t size) noexcept;
+
+	//send and receive fail when they cannot go on for this long, 0 waits forever
+	bool set_timeout(double seconds) noexcept;
+
+	//ends the connection in both directions, calls blocked in other threads return false
+	void shutdown() noexcept;
+};
+
+//Accepts TCP connections on a port of one IPv4 address. Connections are not authenticated, so listening on other
+//than loopback (e.g. 0.0.0.0 for all interfaces) lets anyone who reaches the port in.
+class Listener {
+	Socket socket_;
+
+	explicit Listener(Socket socket) noexcept : socket_{ std::move(socket) } {}
+
+public:
+	//port 0 picks a free port, see port(), address is numeric (e.g. 127.0.0.1)
+	//empty if the address is not valid or the port cannot be bound
+	[[nodiscard]]
+	static std::optional<Listener> listen(uint16_t port, const char* address = "127.0.0.1");
+
+	[[nodiscard]]
+	uint16_t port() const noexcept;
+
+	//empty if no connection comes within timeout seconds
+	[[nodiscard]]
+	std::optional<Socket> accept(double timeout);
+};
@@ -1,22 +1,24 @@
 #pragma once
 
 #include "Ray.h"
+#include "RayPacket.h"
 #include "Hitable.h"
 #include "HitRecord.h"
+#include "AABB.h"
 #include "Material.h"
-#include <optional>
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <optional>
 
 class Sphere {
 	Position center_;
-	double radius_;
+	Scalar radius_;
 	MaterialIndex material_;
 
-public:
-	Sphere(const Position& center, double radius, const MaterialIndex& material) : center_{ center }, radius_{ radius }, material_{material} {}
-
+	//nearest root in [t_min, t_max]
 	[[nodiscard]]
-	std::optional<HitRecord> intersect(const Ray& ray, double t_min, double t_max) const noexcept {
+	std::optional<Scalar> nearest_root(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept {
 		const auto oc = ray.origin() - center_;
 		const auto a = ray.direction().length_squared();
 		const auto half_b = oc.dot(ray.direction());
@@ -36,16 +38,69 @@ public:
 			}
 		}
 
-		return [&] {
-			HitRecord r;
-			r.position = ray.at(root);
-			r.material = material_;
-			r.t = root;
-			r.set_face_normal(ray.direction(), (r.position - center_) / radius_);
+		return root;
+	}
+
+public:
+	Sphere(const Position& center, Scalar radius, const MaterialIndex& material) : center_{ center }, radius_{ radius }, material_{material} {}
+
+	[[nodiscard]]
+	std::optional<HitRecord> intersect(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept {
+		const auto t = nearest_root(ray, t_min, t_max);
+		if (!t) return {};
+		return hit_record(ray, *t, center_, radius_, material_);
+	}
+
+	[[nodiscard]]
+	bool occluded(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept {
+		return nearest_root(ray, t_min, t_max).has_value();
+	}
+
+	[[nodiscard]]
+	const Position& center() const noexcept {
+		return center_;
+	}
+
+	[[nodiscard]]
+	Scalar radius() const noexcept {
+		return radius_;
+	}
+
+	[[nodiscard]]
+	const MaterialIndex& material() const noexcept {
+		return material_;
+	}
+
+	[[nodiscard]]
+	uint32_t intersect(const RayPacket& packet, uint32_t lanes, Scalar t_min, Scalar* t_max) const noexcept {
+		return packet.intersect_sphere(center_, radius_, lanes, t_min, t_max);
+	}
+
+	//point computed from the ray can be far from the surface when t is imprecise, it is projected back onto the sphere
+	//whose error only depends on magnitudes of center and radius (Pharr et al.: Physically Based Rendering, 3.9.4)
+	[[nodiscard]]
+	static HitRecord hit_record(const Ray& ray, Scalar t, const Position& center, Scalar radius, const MaterialIndex& material) noexcept {
+		constexpr auto gamma5 = 5 * std::numeric_limits<Scalar>::epsilon() / 2;
+
+		const auto outward_normal = (ray.at(t) - center).unit() * (radius < 0 ? -1 : 1);
+		const auto max_center = std::max({ std::abs(center.x()), std::abs(center.y()), std::abs(center.z()) });
 
-			return r;
-		}();
+		HitRecord r;
+		r.position = center + outward_normal * std::abs(radius);
+		r.material = material;
+		r.t = t;
+		r.error = gamma5 * (max_center + std::abs(radius));
+		r.set_face_normal(ray.direction(), outward_normal);
+
+		return r;
+	}
+
+	[[nodiscard]]
+	AABB bounding_box() const noexcept {
+		const auto radius = std::abs(radius_);
+		const Direction r{ radius, radius, radius };
+		return { center_ - r, center_ + r };
 	}
 };
 
-static_assert(Hittable<Sphere>);
\ No newline at end of file
+static_assert(Occluder<Sphere>);
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "SphereSet.h"
+#include "Simd.h"
+
+#include <cmath>
+
+//wider targets enable fma and gcc would fuse multiplications with additions, kernels have to round like scalar code
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "SimdOps.h"
+
+namespace {
+	//same arithmetic in the same order as Sphere::intersect, so all kernels agree with it exactly
+	void closest_hit_scalar(const SphereSet::View& s, uint32_t first, uint32_t count, const Ray& ray, Scalar t_min, Scalar& t_max, uint32_t& index) {
+		const auto& o = ray.origin();
+		const auto& d = ray.direction();
+		const auto a = d.length_squared();
+
+		for (auto i = first; i < first + count; ++i) {
+			const auto ocx = o.x() - s.x[i];
+			const auto ocy = o.y() - s.y[i];
+			const auto ocz = o.z() - s.z[i];
+			const auto half_b = ocx * d.x() + ocy * d.y() + ocz * d.z();
+			const auto c = (ocx * ocx + ocy * ocy + ocz * ocz) - s.radius[i] * s.radius[i];
+			const auto discriminant = half_b * half_b - a * c;
+
+			if (!(discriminant >= 0)) continue;
+
+			const auto sqrt_d = std::sqrt(discriminant);
+			auto root = (-half_b - sqrt_d) / a;
+			if (root < t_min || t_max < root) {
+				root = (-half_b + sqrt_d) / a;
+				if (root < t_min || t_max < root) continue;
+			}
+
+			t_max = root;
+			index = i;
+		}
+	}
+
+#ifdef RT_X86
+	//one ray against width spheres per iteration, every lane keeps its own closest hit and they are reduced at the end
+	//sqrt of negative discriminant (and NaN padding) gives NaN, which fails every comparison
+#define RT_CLOSEST_HIT_KERNEL(Ops, hit_mask)                                                                                       \
+		const auto& o = ray.origin();                                                                                              \
+		const auto& d = ray.direction();                                                                                           \
+                                                                                                                                   \
+		const auto ox = Ops::set1(o.x()), oy = Ops::set1(o.y()), oz = Ops::set1(o.z());                                            \
+		const auto dx = Ops::set1(d.x()), dy = Ops::set1(d.y()), dz = Ops::set1(d.z());                                            \
+		const auto a = Ops::set1(d.length_squared());                                                                              \
+		const auto t_lower = Ops::set1(t_min);                                                                                     \
+		const auto zero = Ops::set1(0);                                                                                            \
+                                                                                                                                   \
+		auto best_t = Ops::set1(t_max);                                                                                            \
+		auto best_index = Ops::index_set1(-1);                                                                                     \
+		auto lane_index = Ops::iota(first);                                                                                        \
+		const auto step = Ops::index_set1(Ops::width);                                                                             \
+                                                                                                                                   \
+		for (auto i = first; i < first + count; i += Ops::width) {                                                                 \
+			const auto ocx = Ops::sub(ox, Ops::load(s.x + i));                                                                     \
+			const auto ocy = Ops::sub(oy, Ops::load(s.y + i));                                                                     \
+			const auto ocz = Ops::sub(oz, Ops::load(s.z + i));                                                                     \
+			const auto r = Ops::load(s.radius + i);                                                                                \
+                                                                                                                                   \
+			const auto half_b = Ops::add(Ops::add(Ops::mul(ocx, dx), Ops::mul(ocy, dy)), Ops::mul(ocz, dz));                       \
+			const auto oc2 = Ops::add(Ops::add(Ops::mul(ocx, ocx), Ops::mul(ocy, ocy)), Ops::mul(ocz, ocz));                       \
+			const auto c = Ops::sub(oc2, Ops::mul(r, r));                                                                          \
+			const auto discriminant = Ops::sub(Ops::mul(half_b, half_b), Ops::mul(a, c));                                         \
+                                                                                                                                   \
+			const auto sqrt_d = Ops::sqrt(discriminant);                                                                           \
+			const auto minus_b = Ops::sub(zero, half_b);                                                                           \
+			const auto near = Ops::div(Ops::sub(minus_b, sqrt_d), a);                                                              \
+			const auto far = Ops::div(Ops::add(minus_b, sqrt_d), a);                                                               \
+                                                                                                                                   \
+			const auto near_ok = Ops::in_range(near, t_lower, best_t);                                                             \
+			const auto far_ok = Ops::in_range(far, t_lower, best_t);                                                               \
+                                                                                                                                   \
+			const auto root = Ops::blend(far, near, near_ok);                                                                      \
+			const auto hit = hit_mask;                                                                                             \
+                                                                                                                                   \
+			best_t = Ops::blend(best_t, root, hit);                                                                                \
+			best_index = Ops::index_blend(best_index, lane_index, hit);                                                            \
+			lane_index = Ops::index_add(lane_index, step);                                                                         \
+		}                                                                                                                          \
+                                                                                                                                   \
+		Scalar ts[Ops::width];                                                                                                     \
+		typename Ops::IndexLane indices[Ops::width];                                                                               \
+		Ops::store(ts, best_t);                                                                                                    \
+		Ops::index_store(indices, best_index);                                                                                     \
+		for (uint32_t lane = 0; lane < Ops::width; ++lane) {                                                                       \
+			if (indices[lane] >= 0 && ts[lane] <= t_max) {                                                                         \
+				t_max = ts[lane];                                                                                                  \
+				index = static_cast<uint32_t>(indices[lane]);                                                                      \
+			}                                                                                                                      \
+		}
+
+	RT_TARGET("avx2")
+	void closest_hit_avx2(const SphereSet::View& s, uint32_t first, uint32_t count, const Ray& ray, Scalar t_min, Scalar& t_max, uint32_t& index) {
+		using Ops = simd::Avx2<Scalar>;
+		RT_CLOSEST_HIT_KERNEL(Ops, Ops::mask_or(near_ok, far_ok))
+	}
+
+	RT_TARGET("avx512f")
+	void closest_hit_avx512(const SphereSet::View& s, uint32_t first, uint32_t count, const Ray& ray, Scalar t_min, Scalar& t_max, uint32_t& index) {
+		using Ops = simd::Avx512<Scalar>;
+		RT_CLOSEST_HIT_KERNEL(Ops, static_cast<Ops::Mask>(near_ok | far_ok))
+	}
+
+#undef RT_CLOSEST_HIT_KERNEL
+#endif
+}
+
+SphereSet::Kernel SphereSet::kernel() noexcept {
+	switch (simd::active_level()) {
+#ifdef RT_X86
+	case simd::Level::avx512: return closest_hit_avx512;
+	case simd::Level::avx2: return closest_hit_avx2;
+#endif
+	default: return closest_hit_scalar;
+	}
+}
+
+SphereSet::SphereSet(std::span<const Scalar> x, std::span<const Scalar> y, std::span<const Scalar> z, std::span<const Scalar> radius,
+	std::span<const MaterialIndex> materials, std::span<const BVH::Node> nodes)
+	: materials_(materials.begin(), materials.end()), size_{ x.size() }
+{
+	reserve(size_);
+	x_.assign(x.begin(), x.end());
+	y_.assign(y.begin(), y.end());
+	z_.assign(z.begin(), z.end());
+	radius_.assign(radius.begin(), radius.end());
+	pad();
+
+	bvh_.assign(nodes);
+	if (!bvh_.empty()) {
+		bounds_ = bvh_.bounds();
+		return;
+	}
+	for (size_t i = 0; i < size_; ++i) {
+		const auto r = std::abs(radius_[i]);
+		bounds_.expand(AABB{ center(i) - Direction{ r, r, r }, center(i) + Direction{ r, r, r } });
+	}
+}
+
+void SphereSet::build() {
+	std::vector<AABB> boxes;
+	boxes.reserve(size_);
+	for (size_t i = 0; i < size_; ++i) {
+		const auto r = std::abs(radius_[i]);
+		const auto c = center(i);
+		boxes.push_back({ c - Direction{ r, r, r }, c + Direction{ r, r, r } });
+	}
+
+	const auto order = bvh_.build(boxes, simd_width);
+
+	auto reorder = [&](auto& v) {
+		std::remove_reference_t<decltype(v)> ordered;
+		ordered.reserve(v.capacity());
+		for (auto i : order) ordered.push_back(v[i]);
+		v = std::move(ordered);
+	};
+	reorder(x_);
+	reorder(y_);
+	reorder(z_);
+	reorder(radius_);
+	reorder(materials_);
+	pad();
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "Ray.h"
+#include "Hitable.h"
+#include "HitRecord.h"
+#include "AABB.h"
+#include "BVH.h"
+#include "Sphere.h"
+#include "utils.h"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+//Spheres stored as structure of arrays and intersected several at a time with SIMD kernels.
+//Only the closest candidate is turned into HitRecord. After build() spheres are reordered
+//so that leaves of its own BVH are contiguous ranges of the arrays.
+class SphereSet {
+public:
+	//widest kernel (avx512) processes that many spheres at once, arrays are padded to it
+	static constexpr size_t simd_width = 64 / sizeof(Scalar);
+	static constexpr size_t alignment = 64;
+
+	using Array = std::vector<Scalar, utils::AlignedAllocator<Scalar, alignment>>;
+
+	//pointers to the arrays, shared by kernels
+	struct View {
+		const Scalar* x;
+		const Scalar* y;
+		const Scalar* z;
+		const Scalar* radius;
+	};
+
+	//closest hit among spheres [first, first + count) with t in [t_min, t_max]
+	//on hit shrinks t_max and sets index, reading up to simd_width - 1 spheres past the range is allowed
+	using Kernel = void (*)(const View& spheres, uint32_t first, uint32_t count, const Ray& ray, Scalar t_min, Scalar& t_max, uint32_t& index);
+
+	[[nodiscard]]
+	static Kernel kernel() noexcept;
+
+private:
+	Array x_, y_, z_, radius_;
+	std::vector<MaterialIndex> materials_;
+	size_t size_ = 0;
+	AABB bounds_;
+	BVH bvh_;
+
+	//padding spheres have NaN centers, comparisons with them are always false so they are never hit
+	void pad() {
+		const auto padded = (size_ + simd_width - 1) / simd_width * simd_width + simd_width;
+		const auto nan = std::numeric_limits<Scalar>::quiet_NaN();
+		x_.resize(size_); y_.resize(size_); z_.resize(size_); radius_.resize(size_);
+		x_.resize(padded, nan); y_.resize(padded, nan); z_.resize(padded, nan); radius_.resize(padded, Scalar(0));
+	}
+
+	[[nodiscard]]
+	View view() const noexcept {
+		return { x_.data(), y_.data(), z_.data(), radius_.data() };
+	}
+
+public:
+	SphereSet() {
+		pad();
+	}
+
+	//set as written to scene files: spheres in the order of build() and its BVH nodes, empty if it was not built
+	//arrays are of the same size and copied in bulk, nothing is built again
+	SphereSet(std::span<const Scalar> x, std::span<const Scalar> y, std::span<const Scalar> z, std::span<const Scalar> radius,
+		std::span<const MaterialIndex> materials, std::span<const BVH::Node> nodes);
+
+	void emplace_back(const Position& center, Scalar radius, const MaterialIndex& material) {
+		x_.resize(size_); y_.resize(size_); z_.resize(size_); radius_.resize(size_);
+		x_.push_back(center.x());
+		y_.push_back(center.y());
+		z_.push_back(center.z());
+		radius_.push_back(radius);
+		materials_.push_back(material);
+		++size_;
+
+		const auto r = std::abs(radius);
+		bounds_.expand(AABB{ center - Direction{ r, r, r }, center + Direction{ r, r, r } });
+		bvh_.clear();
+		pad();
+	}
+
+	void reserve(size_t count) {
+		const auto padded = count + 2 * simd_width;
+		x_.reserve(padded); y_.reserve(padded); z_.reserve(padded); radius_.reserve(padded);
+		materials_.reserve(count);
+	}
+
+	[[nodiscard]]
+	size_t size() const noexcept {
+		return size_;
+	}
+
+	[[nodiscard]]
+	Position center(size_t i) const noexcept {
+		return { x_[i], y_[i], z_[i] };
+	}
+
+	[[nodiscard]]
+	Scalar radius(size_t i) const noexcept {
+		return radius_[i];
+	}
+
+	[[nodiscard]]
+	const MaterialIndex& material(size_t i) const noexcept {
+		return materials_[i];
+	}
+
+	//arrays without padding, in the order of BVH leaves once built
+	[[nodiscard]]
+	std::span<const Scalar> xs() const noexcept {
+		return { x_.data(), size_ };
+	}
+
+	[[nodiscard]]
+	std::span<const Scalar> ys() const noexcept {
+		return { y_.data(), size_ };
+	}
+
+	[[nodiscard]]
+	std::span<const Scalar> zs() const noexcept {
+		return { z_.data(), size_ };
+	}
+
+	[[nodiscard]]
+	std::span<const Scalar> radii() const noexcept {
+		return { radius_.data(), size_ };
+	}
+
+	[[nodiscard]]
+	std::span<const MaterialIndex> materials() const noexcept {
+		return materials_;
+	}
+
+	[[nodiscard]]
+	const BVH& bvh() const noexcept {
+		return bvh_;
+	}
+
+	//builds BVH with leaves of up to simd_width spheres, without it every sphere is tested
+	void build();
+
+	[[nodiscard]]
+	std::optional<HitRecord> intersect(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept {
+		const auto closest_hit = kernel();
+		const auto spheres = view();
+		auto index = UINT32_MAX;
+		auto t = t_max;
+
+		if (bvh_.empty()) {
+			closest_hit(spheres, 0, static_cast<uint32_t>(size_), ray, t_min, t, index);
+		}
+		else {
+			bvh_.intersect(ray, t_min, t_max, [&](uint32_t first, uint32_t count, Scalar& closest_so_far) {
+				const auto previous = index;
+				closest_hit(spheres, first, count, ray, t_min, closest_so_far, index);
+				t = closest_so_far;
+				return index != previous;
+			});
+		}
+
+		if (index == UINT32_MAX) return {};
+
+		return Sphere::hit_record(ray, t, center(index), radius_[index], materials_[index]);
+	}
+
+	//stops at the first leaf with a hit, the kernel still looks for the closest sphere within the leaf
+	[[nodiscard]]
+	bool occluded(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept {
+		const auto closest_hit = kernel();
+		const auto spheres = view();
+		auto index = UINT32_MAX;
+		auto t = t_max;
+
+		if (bvh_.empty()) {
+			closest_hit(spheres, 0, static_cast<uint32_t>(size_), ray, t_min, t, index);
+			return index != UINT32_MAX;
+		}
+
+		return bvh_.occluded(ray, t_min, t_max, [&](uint32_t first, uint32_t count) {
+			closest_hit(spheres, first, count, ray, t_min, t, index);
+			return index != UINT32_MAX;
+		});
+	}
+
+	[[nodiscard]]
+	AABB bounding_box() const noexcept {
+		return bounds_;
+	}
+};
+
+static_assert(Occluder<SphereSet>);
@@ -0,0 +1,153 @@
+#include "Stats.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+namespace stats {
+	namespace {
+		struct Registry {
+			std::mutex mutex;
+			std::vector<Counters*> live;
+			Counters retired; //threads which have finished
+		};
+
+		Registry& registry() {
+			static Registry r;
+			return r;
+		}
+	}
+
+	Counters& Counters::operator+=(const Counters& other) noexcept {
+		for (size_t i = 0; i < rays.size(); ++i) rays[i] += other.rays[i];
+		shadow_rays += other.shadow_rays;
+		nodes += other.nodes;
+		leaf_primitives += other.leaf_primitives;
+		for (size_t i = 0; i < scatters.size(); ++i) scatters[i] += other.scatters[i];
+		for (size_t i = 0; i < terminations.size(); ++i) terminations[i] += other.terminations[i];
+		for (size_t i = 0; i < stage_seconds.size(); ++i) stage_seconds[i] += other.stage_seconds[i];
+		return *this;
+	}
+
+	ThreadCounters::ThreadCounters() {
+		auto& r = registry();
+		std::scoped_lock lock{ r.mutex };
+		r.live.push_back(&counters);
+	}
+
+	ThreadCounters::~ThreadCounters() {
+		auto& r = registry();
+		std::scoped_lock lock{ r.mutex };
+		r.retired += counters;
+		std::erase(r.live, &counters);
+	}
+
+	void reset() {
+		auto& r = registry();
+		std::scoped_lock lock{ r.mutex };
+		for (auto* c : r.live) *c = {};
+		r.retired = {};
+	}
+
+	Counters collect() {
+		auto& r = registry();
+		std::scoped_lock lock{ r.mutex };
+		auto sum = r.retired;
+		for (const auto* c : r.live) sum += *c;
+		return sum;
+	}
+}
+
+uint64_t RenderStats::rays() const noexcept {
+	return std::accumulate(counters.rays.begin(), counters.rays.end(), uint64_t{ 0 }) + counters.shadow_rays;
+}
+
+void RenderStats::write_json(std::ostream& out) const {
+	constexpr const char* termination_names[] = { "escaped", "absorbed", "roulette", "max_depth" };
+	constexpr const char* stage_names[] = { "tracing", "generation", "intersection", "shading", "compaction", "accumulation" };
+	static_assert(std::size(termination_names) == size_t(stats::Termination::count));
+	static_assert(std::size(stage_names) == size_t(stats::Stage::count));
+
+	auto array = [&](const auto& values, size_t count) {
+		out << '[';
+		for (size_t i = 0; i < count; ++i) out << (i ? ", " : "") << values[i];
+		out << ']';
+	};
+
+	//depth buckets past the deepest bounce reached are left out
+	size_t depths = counters.rays.size();
+	while (depths > 0 && counters.rays[depths - 1] == 0) --depths;
+
+	const auto flags = out.flags();
+	out << std::setprecision(9);
+	out << "{\n";
+	out << "  \"instrumented\": " << (stats::enabled ? "true" : "false") << ",\n";
+	out << "  \"seconds\": " << seconds << ",\n";
+	out << "  \"height\": " << height << ",\n";
+	out << "  \"width\": " << width << ",\n";
+	out << "  \"samples\": " << samples << ",\n";
+	out << "  \"rays\": " << rays() << ",\n";
+	out << "  \"rays_per_second\": " << rays_per_second() << ",\n";
+	out << "  \"rays_by_depth\": "; array(counters.rays, depths); out << ",\n";
+	out << "  \"shadow_rays\": " << counters.shadow_rays << ",\n";
+	out << "  \"bvh_nodes_tested\": " << counters.nodes << ",\n";
+	out << "  \"leaf_primitives_tested\": " << counters.leaf_primitives << ",\n";
+	out << "  \"scatters_by_material_type\": "; array(counters.scatters, std::min(material_types, counters.scatters.size())); out << ",\n";
+	out << "  \"terminated_paths\": {";
+	for (size_t i = 0; i < std::size(termination_names); ++i) {
+		out << (i ? ", " : " ") << '"' << termination_names[i] << "\": " << counters.terminations[i];
+	}
+	out << " },\n";
+	out << "  \"stage_seconds\": {";
+	for (size_t i = 0; i < std::size(stage_names); ++i) {
+		out << (i ? ", " : " ") << '"' << stage_names[i] << "\": " << counters.stage_seconds[i];
+	}
+	out << " }\n";
+	out << "}\n";
+	out.flags(flags);
+}
+
+bool RenderStats::write_json(const char* filename) const {
+	std::ofstream file{ filename };
+	if (!file) return false;
+	write_json(file);
+	return static_cast<bool>(file);
+}
+
+ProgressReporter::ProgressReporter(std::string label, uint64_t total, bool enabled, std::chrono::milliseconds interval)
+	: label_{ std::move(label) }, total_{ total } {
+	if (!enabled) return;
+
+	thread_ = std::thread{ [this, interval] {
+		std::unique_lock lock{ mutex_ };
+		while (!finished_condition_.wait_for(lock, interval, [&] { return finished_; })) {
+			print(std::cout, done_.load(std::memory_order_relaxed));
+		}
+	} };
+}
+
+ProgressReporter::~ProgressReporter() {
+	if (!thread_.joinable()) return;
+
+	{
+		std::scoped_lock lock{ mutex_ };
+		finished_ = true;
+	}
+	finished_condition_.notify_one();
+	thread_.join();
+	print(std::cout, done_.load());
+}
+
+void ProgressReporter::print(std::ostream& out, uint64_t done) const {
+	const auto elapsed = std::chrono::duration<double>(clock::now() - start_).count();
+	const auto total = total_.load();
+	const auto fraction = total > 0 ? double(done) / total : 1.0;
+
+	out << label_ << ": " << std::fixed << std::setprecision(1) << 100 * fraction << "% (" << done << '/' << total << "), "
+		<< elapsed << " s elapsed";
+	if (done >= total) out << ", done";
+	else if (done > 0) out << ", " << elapsed * (1 - fraction) / fraction << " s left";
+	out << std::defaultfloat << std::setprecision(6) << std::endl;
+}
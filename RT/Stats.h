@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+//Render statistics. Hot paths bump plain counters of their own thread, which are summed over all threads
+//once the render is done, so counting needs no synchronization. Building with RT_DISABLE_STATS removes
+//the counting code altogether, reports then only contain times.
+namespace stats {
+#ifdef RT_DISABLE_STATS
+	inline constexpr bool enabled = false;
+#else
+	inline constexpr bool enabled = true;
+#endif
+
+	inline constexpr size_t depth_buckets = 32;   //rays of deeper bounces are counted in the last bucket
+	inline constexpr size_t material_types = 16;  //scatter calls of material types past that are counted in the last one
+
+	enum class Termination { escaped, absorbed, roulette, max_depth, count };
+
+	//stages of rendering, wall time measured on the thread which drives them
+	enum class Stage { tracing, generation, intersection, shading, compaction, accumulation, count };
+
+	struct Counters {
+		std::array<uint64_t, depth_buckets> rays{}; //closest hit rays by bounce, camera rays are bounce 0
+		uint64_t shadow_rays = 0;
+		uint64_t nodes = 0;                         //BVH nodes whose box was tested, over all levels
+		uint64_t leaf_primitives = 0;               //primitives in leaves reached by rays, each is tested
+		std::array<uint64_t, material_types> scatters{};
+		std::array<uint64_t, size_t(Termination::count)> terminations{};
+		std::array<double, size_t(Stage::count)> stage_seconds{};
+
+		Counters& operator+=(const Counters& other) noexcept;
+	};
+
+	//counters of a thread, listed while the thread lives so that collect can find them
+	struct ThreadCounters {
+		Counters counters;
+
+		ThreadCounters();
+		~ThreadCounters();
+		ThreadCounters(const ThreadCounters&) = delete;
+		ThreadCounters& operator=(const ThreadCounters&) = delete;
+	};
+
+	inline thread_local ThreadCounters thread_counters;
+
+	//zeroes counters of all threads, has to be called while no thread is counting (e.g. before render starts)
+	//counters are shared by the process, so renders running at the same time are counted together
+	void reset();
+
+	//sum over all threads, including those which have already finished
+	[[nodiscard]]
+	Counters collect();
+
+	inline void count_rays(int depth, uint64_t count = 1) noexcept {
+		if constexpr (enabled) thread_counters.counters.rays[std::min<size_t>(size_t(depth), depth_buckets - 1)] += count;
+	}
+
+	inline void count_shadow_ray() noexcept {
+		if constexpr (enabled) ++thread_counters.counters.shadow_rays;
+	}
+
+	inline void count_node() noexcept {
+		if constexpr (enabled) ++thread_counters.counters.nodes;
+	}
+
+	inline void count_leaf(uint32_t primitives) noexcept {
+		if constexpr (enabled) thread_counters.counters.leaf_primitives += primitives;
+	}
+
+	inline void count_scatter(size_t material_type) noexcept {
+		if constexpr (enabled) ++thread_counters.counters.scatters[std::min(material_type, material_types - 1)];
+	}
+
+	inline void count_termination(Termination reason, uint64_t count = 1) noexcept {
+		if constexpr (enabled) thread_counters.counters.terminations[size_t(reason)] += count;
+	}
+
+	//adds time from construction to destruction to the stage, always measured as it costs two clock reads per stage
+	class StageTimer {
+		Stage stage_;
+		std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+
+	public:
+		explicit StageTimer(Stage stage) noexcept : stage_{ stage } {}
+		StageTimer(const StageTimer&) = delete;
+		StageTimer& operator=(const StageTimer&) = delete;
+
+		~StageTimer() {
+			thread_counters.counters.stage_seconds[size_t(stage_)] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+		}
+	};
+}
+
+//Counters of one render with its size and time.
+struct RenderStats {
+	double seconds = 0;
+	uint64_t height = 0;
+	uint64_t width = 0;
+	uint64_t samples = 0;       //camera samples over all pixels
+	size_t material_types = 0;  //of the renderer, number of entries in scatters_by_material_type
+	stats::Counters counters;
+
+	[[nodiscard]]
+	uint64_t rays() const noexcept;
+
+	[[nodiscard]]
+	double rays_per_second() const noexcept {
+		return seconds > 0 ? rays() / seconds : 0;
+	}
+
+	void write_json(std::ostream& out) const;
+
+	//false if the file cannot be written
+	bool write_json(const char* filename) const;
+};
+
+//Prints progress and estimated time left from its own thread every interval, so workers only add to an atomic counter
+//and never wait for output. Prints nothing when disabled.
+class ProgressReporter {
+	using clock = std::chrono::steady_clock;
+
+	std::string label_;
+	std::atomic<uint64_t> total_;
+	std::atomic<uint64_t> done_ = 0;
+	clock::time_point start_ = clock::now();
+
+	std::mutex mutex_;
+	std::condition_variable finished_condition_;
+	bool finished_ = false;
+	std::thread thread_;
+
+	void print(std::ostream& out, uint64_t done) const;
+
+public:
+	ProgressReporter(std::string label, uint64_t total, bool enabled, std::chrono::milliseconds interval = std::chrono::milliseconds{ 1000 });
+	ProgressReporter(const ProgressReporter&) = delete;
+	ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+	//stops the thread and prints the final line
+	~ProgressReporter();
+
+	void advance(uint64_t count = 1) noexcept {
+		done_.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	//work ended before total was reached (e.g. adaptive sampling converged), what is done so far becomes the total
+	void complete() noexcept {
+		total_.store(done_.load());
+	}
+};
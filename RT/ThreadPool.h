@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+//Fixed set of worker threads executing indexed tasks.
+//Every worker owns a queue, parallel_for deals contiguous blocks of indices to the queues,
+//workers take from the front of their own queue and steal from the back of the others when it runs dry.
+class ThreadPool {
+	struct Queue {
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues_;
+	std::vector<std::thread> threads_;
+
+	std::mutex mutex_;
+	std::condition_variable work_available_;
+	std::condition_variable work_done_;
+
+	const std::function<void(size_t)>* task_ = nullptr;
+	size_t generation_ = 0;
+	size_t remaining_ = 0;
+	size_t active_ = 0; //workers which may still pop tasks of current generation
+	bool stopping_ = false;
+
+	[[nodiscard]]
+	std::optional<size_t> pop(size_t worker) {
+		{
+			auto& own = *queues_[worker];
+			std::scoped_lock lock{ own.mutex };
+			if (!own.tasks.empty()) {
+				const auto task = own.tasks.front();
+				own.tasks.pop_front();
+				return task;
+			}
+		}
+
+		for (size_t i = 1; i < queues_.size(); ++i) {
+			auto& victim = *queues_[(worker + i) % queues_.size()];
+			std::scoped_lock lock{ victim.mutex };
+			if (!victim.tasks.empty()) {
+				const auto task = victim.tasks.back();
+				victim.tasks.pop_back();
+				return task;
+			}
+		}
+
+		return {};
+	}
+
+	void worker_loop(size_t worker) {
+		size_t seen_generation = 0;
+
+		while (true) {
+			const std::function<void(size_t)>* task;
+			{
+				std::unique_lock lock{ mutex_ };
+				work_available_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+				if (stopping_) return;
+				seen_generation = generation_;
+				task = task_;
+				if (!task) continue; //woke up after the work was already done
+				++active_;
+			}
+
+			size_t finished = 0;
+			while (const auto index = pop(worker)) {
+				(*task)(*index);
+				++finished;
+			}
+
+			std::scoped_lock lock{ mutex_ };
+			remaining_ -= finished;
+			--active_;
+			if (remaining_ == 0 && active_ == 0) work_done_.notify_all();
+		}
+	}
+
+public:
+	explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency()) {
+		thread_count = std::max<size_t>(thread_count, 1);
+
+		for (size_t i = 0; i < thread_count; ++i) {
+			queues_.push_back(std::make_unique<Queue>());
+		}
+		for (size_t i = 0; i < thread_count; ++i) {
+			threads_.emplace_back(&ThreadPool::worker_loop, this, i);
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool() {
+		{
+			std::scoped_lock lock{ mutex_ };
+			stopping_ = true;
+		}
+		work_available_.notify_all();
+		for (auto& t : threads_) t.join();
+	}
+
+	[[nodiscard]]
+	size_t size() const noexcept {
+		return threads_.size();
+	}
+
+	//calls task(i) for every i in [0, count) and waits until all calls return
+	//not reentrant - task must not call parallel_for on the same pool
+	void parallel_for(size_t count, const std::function<void(size_t)>& task) {
+		if (count == 0) return;
+
+		std::unique_lock lock{ mutex_ };
+
+		const auto workers = queues_.size();
+		for (size_t w = 0; w < workers; ++w) {
+			auto& queue = *queues_[w];
+			std::scoped_lock queue_lock{ queue.mutex };
+			for (auto i = count * w / workers; i < count * (w + 1) / workers; ++i) {
+				queue.tasks.push_back(i);
+			}
+		}
+
+		task_ = &task;
+		remaining_ = count;
+		++generation_;
+		work_available_.notify_all();
+		work_done_.wait(lock, [&] { return remaining_ == 0 && active_ == 0; });
+		task_ = nullptr;
+	}
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "Vec3.h"
+#include "AABB.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <optional>
+
+//Affine transform p' = M p + translation, stored as rows of the 3x3 matrix M.
+//Composition reads right to left, (a * b).point(p) == a.point(b.point(p)).
+template <std::floating_point T>
+class BasicTransform {
+	using Vec3 = BasicVec3<T>;
+	using AABB = BasicAABB<T>;
+
+	std::array<Vec3, 3> rows_{ Vec3{ 1, 0, 0 }, Vec3{ 0, 1, 0 }, Vec3{ 0, 0, 1 } };
+	Vec3 translation_{ 0, 0, 0 };
+
+	constexpr BasicTransform(const std::array<Vec3, 3>& rows, const Vec3& translation) : rows_{ rows }, translation_{ translation } {}
+
+	[[nodiscard]] constexpr
+	Vec3 column(int i) const noexcept {
+		return { rows_[0].data[i], rows_[1].data[i], rows_[2].data[i] };
+	}
+
+public:
+	constexpr BasicTransform() = default;
+
+	[[nodiscard]] static constexpr
+	BasicTransform translation(const Vec3& offset) noexcept {
+		return { { Vec3{ 1, 0, 0 }, Vec3{ 0, 1, 0 }, Vec3{ 0, 0, 1 } }, offset };
+	}
+
+	[[nodiscard]] static constexpr
+	BasicTransform scaling(const Vec3& factors) noexcept {
+		return { { Vec3{ factors.x(), 0, 0 }, Vec3{ 0, factors.y(), 0 }, Vec3{ 0, 0, factors.z() } }, Vec3{ 0, 0, 0 } };
+	}
+
+	[[nodiscard]] static constexpr
+	BasicTransform scaling(T factor) noexcept {
+		return scaling(Vec3{ factor, factor, factor });
+	}
+
+	//counterclockwise by angle (radians) when looking against the axis
+	[[nodiscard]] static
+	BasicTransform rotation(const Vec3& axis, T angle) noexcept {
+		const auto a = axis.unit();
+		const auto s = std::sin(angle);
+		const auto c = std::cos(angle);
+		const auto k = 1 - c;
+		return { {
+			Vec3{ c + a.x() * a.x() * k, a.x() * a.y() * k - a.z() * s, a.x() * a.z() * k + a.y() * s },
+			Vec3{ a.y() * a.x() * k + a.z() * s, c + a.y() * a.y() * k, a.y() * a.z() * k - a.x() * s },
+			Vec3{ a.z() * a.x() * k - a.y() * s, a.z() * a.y() * k + a.x() * s, c + a.z() * a.z() * k }
+		}, Vec3{ 0, 0, 0 } };
+	}
+
+	[[nodiscard]] constexpr
+	friend BasicTransform operator*(const BasicTransform& a, const BasicTransform& b) noexcept {
+		std::array<Vec3, 3> rows;
+		for (auto i : { 0, 1, 2 }) {
+			for (auto j : { 0, 1, 2 }) rows[i].data[j] = a.rows_[i].dot(b.column(j));
+		}
+		return { rows, a.point(b.translation_) };
+	}
+
+	[[nodiscard]] constexpr
+	bool operator==(const BasicTransform&) const noexcept = default;
+
+	//matrices and translations blended entry by entry, rotations shrink in between, so keys of a rotation have to be
+	//close enough for that not to show (a few degrees)
+	[[nodiscard]] constexpr
+	friend BasicTransform lerp(const BasicTransform& a, const BasicTransform& b, T t) noexcept {
+		std::array<Vec3, 3> rows;
+		for (auto i : { 0, 1, 2 }) rows[i] = lerp(a.rows_[i], b.rows_[i], t);
+		return { rows, lerp(a.translation_, b.translation_, t) };
+	}
+
+	//empty when the matrix is singular, e.g. scaling by zero
+	[[nodiscard]]
+	std::optional<BasicTransform> inverse() const noexcept {
+		//rows of the inverse are cross products of columns divided by the determinant
+		const auto c0 = column(0), c1 = column(1), c2 = column(2);
+		const auto determinant = c0.dot(c1.cross(c2));
+		if (determinant == 0 || !std::isfinite(determinant)) return {};
+
+		const std::array<Vec3, 3> rows{ c1.cross(c2) / determinant, c2.cross(c0) / determinant, c0.cross(c1) / determinant };
+		const BasicTransform linear{ rows, Vec3{ 0, 0, 0 } };
+		return BasicTransform{ rows, -linear.vector(translation_) };
+	}
+
+	[[nodiscard]] constexpr
+	Vec3 point(const Vec3& p) const noexcept {
+		return vector(p) + translation_;
+	}
+
+	[[nodiscard]] constexpr
+	Vec3 vector(const Vec3& v) const noexcept {
+		return { rows_[0].dot(v), rows_[1].dot(v), rows_[2].dot(v) };
+	}
+
+	//normals go through transposed inverse, which has to be called on the inverse transform
+	//the result is not normalized
+	[[nodiscard]] constexpr
+	Vec3 normal_of_inverse(const Vec3& n) const noexcept {
+		return column(0) * n.x() + column(1) * n.y() + column(2) * n.z();
+	}
+
+	//bound of absolute rounding error of point(p), max over axes of gamma3 * (|M| |p| + |translation|)
+	[[nodiscard]]
+	T point_error(const Vec3& p) const noexcept {
+		constexpr auto epsilon = std::numeric_limits<T>::epsilon() / 2;
+		constexpr auto gamma3 = 3 * epsilon / (1 - 3 * epsilon);
+
+		T error = 0;
+		for (auto i : { 0, 1, 2 }) {
+			const auto& r = rows_[i];
+			const auto sum = std::abs(r.x() * p.x()) + std::abs(r.y() * p.y()) + std::abs(r.z() * p.z()) + std::abs(translation_.data[i]);
+			error = std::max(error, gamma3 * sum);
+		}
+		return error;
+	}
+
+	//largest factor by which lengths grow (max absolute row sum, bounds the spectral norm in infinity norm)
+	[[nodiscard]]
+	T max_scale() const noexcept {
+		T scale = 0;
+		for (const auto& r : rows_) scale = std::max(scale, std::abs(r.x()) + std::abs(r.y()) + std::abs(r.z()));
+		return scale;
+	}
+
+	//box containing the transformed box, each output axis takes the smaller and larger product per matrix entry
+	//(Arvo: Transforming Axis-Aligned Bounding Boxes, Graphics Gems), widened by the rounding error of the corners
+	[[nodiscard]]
+	AABB box(const AABB& b) const noexcept {
+		if (b.empty()) return b;
+
+		AABB result{ translation_, translation_ };
+		for (auto i : { 0, 1, 2 }) {
+			for (auto j : { 0, 1, 2 }) {
+				const auto e = rows_[i].data[j] * b.min.data[j];
+				const auto f = rows_[i].data[j] * b.max.data[j];
+				result.min.data[i] += std::min(e, f);
+				result.max.data[i] += std::max(e, f);
+			}
+		}
+
+		const auto corner = Vec3{
+			std::max(std::abs(b.min.x()), std::abs(b.max.x())),
+			std::max(std::abs(b.min.y()), std::abs(b.max.y())),
+			std::max(std::abs(b.min.z()), std::abs(b.max.z()))
+		};
+		const auto error = 2 * point_error(corner);
+		result.min -= Vec3{ error, error, error };
+		result.max += Vec3{ error, error, error };
+		return result;
+	}
+};
+
+using Transform = BasicTransform<Scalar>;
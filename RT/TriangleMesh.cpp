@@ -0,0 +1,371 @@
+#include "TriangleMesh.h"
+#include "BVH.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace {
+	constexpr char mesh_magic[8] = { 'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0' };
+	constexpr uint32_t mesh_version = 1;
+	constexpr uint32_t byte_order_mark = 0x01020304;
+	constexpr uint64_t section_alignment = 64;
+
+	struct MeshFileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;        //byte_order_mark as written, tells files of other byte order apart
+		uint64_t vertex_count;
+		uint64_t triangle_count;
+		uint64_t node_count;
+		uint64_t vertex_offset;     //sections in bytes from start of the file
+		uint64_t triangle_offset;
+		uint64_t node_offset;
+	};
+
+	[[nodiscard]]
+	uint64_t align(uint64_t offset) noexcept {
+		return (offset + section_alignment - 1) / section_alignment * section_alignment;
+	}
+
+	//floats enclosing the value from below and above, so that float boxes contain what the Scalar ones did
+	[[nodiscard]]
+	float round_down(Scalar x) noexcept {
+		const auto f = static_cast<float>(x);
+		return Scalar(f) > x ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+	}
+
+	[[nodiscard]]
+	float round_up(Scalar x) noexcept {
+		const auto f = static_cast<float>(x);
+		return Scalar(f) < x ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+	}
+
+	struct TriangleHit {
+		Scalar t;
+		Scalar b0, b1, b2;
+	};
+
+	//Watertight ray/triangle intersection (Woop, Benthin, Wald). Vertices are translated to the ray origin
+	//and sheared so that the ray points along +z, then edge functions are evaluated in 2D. Shared edges
+	//give the same edge function with opposite sign to both triangles, so no ray slips between them.
+	class WatertightRay {
+		Position origin_;
+		int kx_, ky_, kz_;
+		Scalar sx_, sy_, sz_;
+
+		//edge functions, exactly zero ones are recomputed in double when Scalar is float
+		template <typename T>
+		static void edges(T ax, T ay, T bx, T by, T cx, T cy, T& u, T& v, T& w) noexcept {
+			u = cx * by - cy * bx;
+			v = ax * cy - ay * cx;
+			w = bx * ay - by * ax;
+		}
+
+	public:
+		explicit WatertightRay(const Ray& ray) noexcept : origin_{ ray.origin() } {
+			const auto& d = ray.direction();
+			kz_ = std::abs(d.x()) > std::abs(d.y())
+				? (std::abs(d.x()) > std::abs(d.z()) ? 0 : 2)
+				: (std::abs(d.y()) > std::abs(d.z()) ? 1 : 2);
+			kx_ = (kz_ + 1) % 3;
+			ky_ = (kx_ + 1) % 3;
+			//keeps winding of the triangle, so the sign of edge functions does not depend on the ray
+			if (d.data[kz_] < 0) std::swap(kx_, ky_);
+
+			sx_ = d.data[kx_] / d.data[kz_];
+			sy_ = d.data[ky_] / d.data[kz_];
+			sz_ = 1 / d.data[kz_];
+		}
+
+		[[nodiscard]]
+		std::optional<TriangleHit> intersect(const Position& p0, const Position& p1, const Position& p2, Scalar t_min, Scalar t_max) const noexcept {
+			const auto a = p0 - origin_;
+			const auto b = p1 - origin_;
+			const auto c = p2 - origin_;
+
+			const auto ax = a.data[kx_] - sx_ * a.data[kz_];
+			const auto ay = a.data[ky_] - sy_ * a.data[kz_];
+			const auto bx = b.data[kx_] - sx_ * b.data[kz_];
+			const auto by = b.data[ky_] - sy_ * b.data[kz_];
+			const auto cx = c.data[kx_] - sx_ * c.data[kz_];
+			const auto cy = c.data[ky_] - sy_ * c.data[kz_];
+
+			Scalar u, v, w;
+			edges(ax, ay, bx, by, cx, cy, u, v, w);
+			if constexpr (std::is_same_v<Scalar, float>) {
+				if (u == 0 || v == 0 || w == 0) {
+					double ud, vd, wd;
+					edges<double>(ax, ay, bx, by, cx, cy, ud, vd, wd);
+					u = static_cast<float>(ud);
+					v = static_cast<float>(vd);
+					w = static_cast<float>(wd);
+				}
+			}
+
+			if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0)) return {};
+
+			const auto det = u + v + w;
+			if (det == 0) return {};
+
+			const auto az = sz_ * a.data[kz_];
+			const auto bz = sz_ * b.data[kz_];
+			const auto cz = sz_ * c.data[kz_];
+			const auto inv_det = 1 / det;
+			const auto t = (u * az + v * bz + w * cz) * inv_det;
+			if (!(t >= t_min && t <= t_max)) return {};
+
+			return TriangleHit{ t, u * inv_det, v * inv_det, w * inv_det };
+		}
+	};
+
+	struct OwnedBuffers {
+		std::vector<TriangleMesh::Vertex> vertices;
+		std::vector<TriangleMesh::Triangle> triangles;
+		std::vector<TriangleMesh::Node> nodes;
+	};
+
+	template <typename T>
+	[[nodiscard]]
+	std::span<const T> section(std::span<const std::byte> file, uint64_t offset, uint64_t count) noexcept {
+		return { reinterpret_cast<const T*>(file.data() + offset), static_cast<size_t>(count) };
+	}
+
+	[[nodiscard]]
+	bool section_fits(uint64_t file_size, uint64_t offset, uint64_t count, uint64_t element_size) noexcept {
+		return offset % section_alignment == 0
+			&& offset <= file_size
+			&& count <= (file_size - offset) / element_size;
+	}
+}
+
+TriangleMesh::TriangleMesh(std::vector<Vertex> vertices, std::vector<Triangle> triangles, const MaterialIndex& material)
+	: material_{ material }
+{
+	auto buffers = std::make_shared<OwnedBuffers>();
+	buffers->vertices = std::move(vertices);
+
+	auto position = [&](uint32_t i) {
+		const auto& v = buffers->vertices[i];
+		return Position{ Scalar(v[0]), Scalar(v[1]), Scalar(v[2]) };
+	};
+
+	std::vector<AABB> boxes;
+	boxes.reserve(triangles.size());
+	for (const auto& t : triangles) {
+		boxes.push_back(AABB{}.expand(position(t[0])).expand(position(t[1])).expand(position(t[2])));
+	}
+
+	BVH bvh;
+	const auto order = bvh.build(boxes);
+
+	buffers->triangles.reserve(triangles.size());
+	for (auto i : order) buffers->triangles.push_back(triangles[i]);
+
+	buffers->nodes.reserve(bvh.nodes().size());
+	for (const auto& node : bvh.nodes()) {
+		Node n;
+		for (auto i : { 0, 1, 2 }) {
+			n.bounds.min.data[i] = round_down(node.bounds.min.data[i]);
+			n.bounds.max.data[i] = round_up(node.bounds.max.data[i]);
+		}
+		n.offset = node.offset;
+		n.count = node.count;
+		n.axis = node.axis;
+		buffers->nodes.push_back(n);
+	}
+
+	vertices_ = buffers->vertices;
+	triangles_ = buffers->triangles;
+	nodes_ = buffers->nodes;
+	if (!nodes_.empty()) bounds_ = AABB{ nodes_.front().bounds };
+	storage_ = std::move(buffers);
+}
+
+std::optional<TriangleMesh> TriangleMesh::load(const char* filename, const MaterialIndex& material) {
+	return load(MappedFile::open(filename), 0, material);
+}
+
+std::optional<TriangleMesh> TriangleMesh::load(std::shared_ptr<const MappedFile> file, uint64_t offset, const MaterialIndex& material) {
+	if (!file || offset % section_alignment != 0 || offset > file->bytes().size()) return {};
+
+	const auto bytes = file->bytes().subspan(static_cast<size_t>(offset));
+	MeshFileHeader header;
+	if (bytes.size() < sizeof(header)) return {};
+	std::memcpy(&header, bytes.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, mesh_magic, sizeof(mesh_magic)) != 0
+		|| header.version != mesh_version
+		|| header.byte_order != byte_order_mark
+		|| !section_fits(bytes.size(), header.vertex_offset, header.vertex_count, sizeof(Vertex))
+		|| !section_fits(bytes.size(), header.triangle_offset, header.triangle_count, sizeof(Triangle))
+		|| !section_fits(bytes.size(), header.node_offset, header.node_count, sizeof(Node))
+		|| (header.node_count == 0) != (header.triangle_count == 0)) {
+		return {};
+	}
+
+	TriangleMesh mesh;
+	mesh.vertices_ = section<Vertex>(bytes, header.vertex_offset, header.vertex_count);
+	mesh.triangles_ = section<Triangle>(bytes, header.triangle_offset, header.triangle_count);
+	mesh.nodes_ = section<Node>(bytes, header.node_offset, header.node_count);
+
+	//indices are checked once here so that intersection can trust them
+	const auto vertex_in_range = [&](uint32_t i) { return i < header.vertex_count; };
+	for (const auto& triangle : mesh.triangles_) {
+		if (!std::ranges::all_of(triangle, vertex_in_range)) return {};
+	}
+	if (!BVH::valid(mesh.nodes_, header.triangle_count)) return {};
+
+	if (!mesh.nodes_.empty()) mesh.bounds_ = AABB{ mesh.nodes_.front().bounds };
+	mesh.material_ = material;
+	mesh.mapped_ = true;
+	mesh.storage_ = std::move(file);
+	return mesh;
+}
+
+bool TriangleMesh::save(const char* filename) const {
+	std::ofstream out{ filename, std::ios::binary };
+	return out && write(out);
+}
+
+bool TriangleMesh::write(std::ostream& out) const {
+	MeshFileHeader header{};
+	std::memcpy(header.magic, mesh_magic, sizeof(mesh_magic));
+	header.version = mesh_version;
+	header.byte_order = byte_order_mark;
+	header.vertex_count = vertices_.size();
+	header.triangle_count = triangles_.size();
+	header.node_count = nodes_.size();
+	header.vertex_offset = align(sizeof(header));
+	header.triangle_offset = align(header.vertex_offset + vertices_.size_bytes());
+	header.node_offset = align(header.triangle_offset + triangles_.size_bytes());
+
+	uint64_t position = 0;
+	auto write = [&](uint64_t offset, const void* data, size_t size) {
+		static constexpr char zeros[section_alignment]{};
+		out.write(zeros, static_cast<std::streamsize>(offset - position));
+		out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		position = offset + size;
+	};
+
+	write(0, &header, sizeof(header));
+	write(header.vertex_offset, vertices_.data(), vertices_.size_bytes());
+	write(header.triangle_offset, triangles_.data(), triangles_.size_bytes());
+	write(header.node_offset, nodes_.data(), nodes_.size_bytes());
+
+	return static_cast<bool>(out);
+}
+
+std::optional<TriangleMesh> TriangleMesh::from_obj(const char* filename, const MaterialIndex& material) {
+	std::ifstream in{ filename, std::ios::binary };
+	if (!in) return {};
+	const std::string text{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+
+	std::vector<Vertex> vertices;
+	std::vector<Triangle> triangles;
+	std::vector<uint32_t> face;
+
+	auto skip_spaces = [](std::string_view& s) {
+		while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+	};
+
+	std::string_view rest{ text };
+	while (!rest.empty()) {
+		const auto end = rest.find('\n');
+		auto line = rest.substr(0, end);
+		rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+		if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+		skip_spaces(line);
+		if (line.starts_with("v ") || line.starts_with("v\t")) {
+			line.remove_prefix(2);
+			Vertex v;
+			for (auto& coordinate : v) {
+				skip_spaces(line);
+				const auto [next, error] = std::from_chars(line.data(), line.data() + line.size(), coordinate);
+				if (error != std::errc{}) return {};
+				line.remove_prefix(static_cast<size_t>(next - line.data()));
+			}
+			vertices.push_back(v);
+		}
+		else if (line.starts_with("f ") || line.starts_with("f\t")) {
+			line.remove_prefix(2);
+			face.clear();
+			while (skip_spaces(line), !line.empty()) {
+				//only position index of "v", "v/vt", "v//vn" or "v/vt/vn", negative ones count from the last vertex
+				int64_t index = 0;
+				const auto [next, error] = std::from_chars(line.data(), line.data() + line.size(), index);
+				if (error != std::errc{}) return {};
+				line.remove_prefix(static_cast<size_t>(next - line.data()));
+				while (!line.empty() && line.front() != ' ' && line.front() != '\t') line.remove_prefix(1);
+
+				const auto resolved = index < 0 ? int64_t(vertices.size()) + index : index - 1;
+				if (resolved < 0 || resolved >= int64_t(vertices.size())) return {};
+				face.push_back(static_cast<uint32_t>(resolved));
+			}
+			for (size_t i = 2; i < face.size(); ++i) {
+				triangles.push_back({ face[0], face[i - 1], face[i] });
+			}
+		}
+	}
+
+	return TriangleMesh{ std::move(vertices), std::move(triangles), material };
+}
+
+std::optional<HitRecord> TriangleMesh::intersect(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept {
+	const WatertightRay watertight{ ray };
+	std::optional<TriangleHit> closest;
+	uint32_t closest_triangle = 0;
+
+	BVH::traverse(nodes_, ray, t_min, t_max, [&](uint32_t first, uint32_t count, Scalar& closest_so_far) {
+		bool hit_any = false;
+		for (auto i = first; i < first + count; ++i) {
+			const auto& triangle = triangles_[i];
+			if (const auto hit = watertight.intersect(vertex(triangle[0]), vertex(triangle[1]), vertex(triangle[2]), t_min, closest_so_far); hit) {
+				closest_so_far = hit->t;
+				closest = hit;
+				closest_triangle = i;
+				hit_any = true;
+			}
+		}
+		return hit_any;
+	});
+
+	if (!closest) return {};
+
+	const auto& triangle = triangles_[closest_triangle];
+	const auto p0 = vertex(triangle[0]), p1 = vertex(triangle[1]), p2 = vertex(triangle[2]);
+
+	auto abs = [](const Position& p) { return Position{ std::abs(p.x()), std::abs(p.y()), std::abs(p.z()) }; };
+
+	HitRecord r;
+	r.t = closest->t;
+	r.position = closest->b0 * p0 + closest->b1 * p1 + closest->b2 * p2;
+	//barycentric interpolation error (pbrt 3.9.3)
+	constexpr auto gamma7 = 7 * std::numeric_limits<Scalar>::epsilon() / 2;
+	const auto error = closest->b0 * abs(p0) + closest->b1 * abs(p1) + closest->b2 * abs(p2);
+	r.error = gamma7 * std::max({ error.x(), error.y(), error.z() });
+	r.set_face_normal(ray.direction(), (p1 - p0).cross(p2 - p0).unit());
+	r.material = material_;
+	return r;
+}
+
+bool TriangleMesh::occluded(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept {
+	const WatertightRay watertight{ ray };
+
+	return BVH::traverse<true>(nodes_, ray, t_min, t_max, [&](uint32_t first, uint32_t count) {
+		for (auto i = first; i < first + count; ++i) {
+			const auto& triangle = triangles_[i];
+			if (watertight.intersect(vertex(triangle[0]), vertex(triangle[1]), vertex(triangle[2]), t_min, t_max)) return true;
+		}
+		return false;
+	});
+}
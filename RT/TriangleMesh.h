@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Vec3.h"
+#include "Ray.h"
+#include "Hitable.h"
+#include "HitRecord.h"
+#include "AABB.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <vector>
+
+class MappedFile;
+
+//Indexed triangle mesh with its own BVH and one material for the whole mesh.
+//Buffers (float vertices, index triples in leaf order and BVH nodes with float boxes) are laid out exactly
+//as in mesh files, so a loaded mesh uses the mapped file in place - nothing is parsed or built at load time,
+//triangles and nodes are only checked to index within the file. Meshes are cheap to copy, buffers are shared.
+//
+//Mesh file: header (see TriangleMesh.cpp), then vertices, triangles and nodes, each section aligned to 64 bytes.
+//Files are written by save (e.g. "RT obj2mesh model.obj model.rtmesh") and read on machines of the same byte order.
+class TriangleMesh {
+public:
+	using Vertex = std::array<float, 3>;
+	using Triangle = std::array<uint32_t, 3>;
+
+	//BVH::Node with box rounded outwards to floats
+	struct Node {
+		BasicAABB<float> bounds;
+		uint32_t offset{};
+		uint16_t count{};
+		uint8_t axis{};
+		uint8_t padding{};
+	};
+
+	static_assert(sizeof(Node) == 32, "Node is part of the mesh file format");
+
+private:
+	std::shared_ptr<const void> storage_; //owns the buffers, vectors or mapped file
+	std::span<const Vertex> vertices_;
+	std::span<const Triangle> triangles_;
+	std::span<const Node> nodes_;
+	AABB bounds_;
+	MaterialIndex material_{};
+	bool mapped_ = false;
+
+	TriangleMesh() = default;
+
+	[[nodiscard]]
+	Position vertex(uint32_t i) const noexcept {
+		const auto& v = vertices_[i];
+		return { Scalar(v[0]), Scalar(v[1]), Scalar(v[2]) };
+	}
+
+public:
+	//builds BVH, triangles are reordered so that its leaves are contiguous ranges
+	TriangleMesh(std::vector<Vertex> vertices, std::vector<Triangle> triangles, const MaterialIndex& material);
+
+	//maps mesh file written by save, empty if it cannot be opened or is not a valid mesh file (indices out of range included)
+	[[nodiscard]]
+	static std::optional<TriangleMesh> load(const char* filename, const MaterialIndex& material);
+
+	//mesh file embedded in another mapped file at offset (multiple of 64), e.g. in a scene file
+	[[nodiscard]]
+	static std::optional<TriangleMesh> load(std::shared_ptr<const MappedFile> file, uint64_t offset, const MaterialIndex& material);
+
+	//reads vertices and faces of Wavefront OBJ file, polygons are split into fans of triangles
+	//other statements (normals, texture coordinates, groups, materials) are ignored
+	[[nodiscard]]
+	static std::optional<TriangleMesh> from_obj(const char* filename, const MaterialIndex& material);
+
+	bool save(const char* filename) const;
+
+	//writes mesh file to out, whose position has to be a multiple of 64 for the file to be embedded
+	bool write(std::ostream& out) const;
+
+	[[nodiscard]]
+	size_t vertex_count() const noexcept {
+		return vertices_.size();
+	}
+
+	[[nodiscard]]
+	size_t triangle_count() const noexcept {
+		return triangles_.size();
+	}
+
+	//bytes of vertex, index and node buffers, for mapped meshes only pages touched by rays are resident
+	[[nodiscard]]
+	size_t memory_size() const noexcept {
+		return vertices_.size_bytes() + triangles_.size_bytes() + nodes_.size_bytes();
+	}
+
+	[[nodiscard]]
+	const MaterialIndex& material() const noexcept {
+		return material_;
+	}
+
+	[[nodiscard]]
+	bool is_mapped() const noexcept {
+		return mapped_;
+	}
+
+	[[nodiscard]]
+	std::optional<HitRecord> intersect(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept;
+
+	//first triangle found in [t_min, t_max] ends the search, nothing is interpolated
+	[[nodiscard]]
+	bool occluded(const Ray& ray, Scalar t_min, Scalar t_max) const noexcept;
+
+	[[nodiscard]]
+	AABB bounding_box() const noexcept {
+		return bounds_;
+	}
+};
+
+static_assert(Occluder<TriangleMesh>);
@@ -2,45 +2,63 @@
 
 #include "utils.h"
 
+#include <algorithm>
 #include <cmath>
+#include <concepts>
 #include <ostream>
 
-struct Vec3 {
-	double data[3]{};
+//scalar type of the whole renderer, single precision halves memory traffic and doubles SIMD lanes
+#ifdef RT_SINGLE_PRECISION
+using Scalar = float;
+#else
+using Scalar = double;
+#endif
 
-	constexpr Vec3() = default;
-	constexpr Vec3(double x, double y, double z) : data{ x, y, z } {}
+template <std::floating_point T>
+struct BasicVec3 {
+	using Vec3 = BasicVec3;
+
+	T data[3]{};
+
+	constexpr BasicVec3() = default;
+	constexpr BasicVec3(T x, T y, T z) : data{ x, y, z } {}
+
+	template <std::floating_point U>
+	constexpr explicit BasicVec3(const BasicVec3<U>& v) : data{ static_cast<T>(v.data[0]), static_cast<T>(v.data[1]), static_cast<T>(v.data[2]) } {}
 
 	[[nodiscard]] constexpr
-	double& x() noexcept {
+	T& x() noexcept {
 		return data[0];
 	}
 
 	[[nodiscard]] constexpr
-	double x() const noexcept {
+	T x() const noexcept {
 		return data[0];
 	}
 
 	[[nodiscard]] constexpr
-	double& y() noexcept {
+	T& y() noexcept {
 		return data[1];
 	}
 
 	[[nodiscard]] constexpr
-	double y() const noexcept {
+	T y() const noexcept {
 		return data[1];
 	}
 
 	[[nodiscard]] constexpr
-	double& z() noexcept {
+	T& z() noexcept {
 		return data[2];
 	}
 
 	[[nodiscard]] constexpr
-	double z() const noexcept {
-		return data[0];
+	T z() const noexcept {
+		return data[2];
 	}
 
+	[[nodiscard]] constexpr
+	bool operator==(const Vec3&) const noexcept = default;
+
 	constexpr
 	Vec3& operator+=(const Vec3& rhs) noexcept {
 		for (auto i : { 0, 1, 2 })
@@ -63,14 +81,14 @@ struct Vec3 {
 	}
 
 	constexpr
-	Vec3& operator*=(double rhs) noexcept {
+	Vec3& operator*=(T rhs) noexcept {
 		for (auto i : { 0, 1, 2 })
 			data[i] *= rhs;
 		return *this;
 	}
 
 	constexpr
-	Vec3& operator/=(const double rhs) noexcept {
+	Vec3& operator/=(const T rhs) noexcept {
 		return *this *= (1 / rhs);
 	}
 
@@ -86,24 +104,24 @@ struct Vec3 {
 	}
 
 	[[nodiscard]] constexpr
-	Vec3 operator*(double rhs) const noexcept {
+	Vec3 operator*(T rhs) const noexcept {
 		auto tmp = *this;
 		return tmp *= rhs;
 	}
 
 	[[nodiscard]] constexpr
-	friend Vec3 operator*(double lhs, const Vec3& rhs) noexcept {
+	friend Vec3 operator*(T lhs, const Vec3& rhs) noexcept {
 		return rhs * lhs;
 	}
 
 	[[nodiscard]] constexpr
-	Vec3 operator/(const double rhs) noexcept {
+	Vec3 operator/(const T rhs) const noexcept {
 		auto tmp = *this;
 		return tmp /= rhs;
 	}
 
 	[[nodiscard]] constexpr
-	double dot(const Vec3& rhs) const noexcept {
+	T dot(const Vec3& rhs) const noexcept {
 		return data[0] * rhs.data[0]
 			 + data[1] * rhs.data[1]
 			 + data[2] * rhs.data[2];
@@ -117,11 +135,11 @@ struct Vec3 {
 	}
 
 	[[nodiscard]] constexpr
-	double length_squared() const noexcept {
+	T length_squared() const noexcept {
 		return dot(*this);
 	}
 	[[nodiscard]]
-	double length() const noexcept {
+	T length() const noexcept {
 		return std::sqrt(length_squared());
 	}
 
@@ -142,10 +160,10 @@ struct Vec3 {
 	}
 
 	[[nodiscard]] constexpr
-	Vec3 refracted(const Vec3& normal, double etai_over_etat) const noexcept {
-		auto cos_theta = std::min((-*this).dot(normal), 1.0);
+	Vec3 refracted(const Vec3& normal, T etai_over_etat) const noexcept {
+		auto cos_theta = std::min((-*this).dot(normal), T(1));
 		Vec3 r_out_prep = etai_over_etat * (*this + cos_theta * normal);
-		Vec3 r_out_parallel = -std::sqrt(std::abs(1.0 - r_out_prep.length_squared())) * normal;
+		Vec3 r_out_parallel = -std::sqrt(std::abs(T(1) - r_out_prep.length_squared())) * normal;
 
 		return r_out_prep + r_out_parallel;
 	}
@@ -161,43 +179,12 @@ struct Vec3 {
 
 	[[nodiscard]]
 	static Vec3 random() noexcept {
-		return { utils::random_double(), utils::random_double(), utils::random_double() };
-	}
-
-	[[nodiscard]]
-	static Vec3 random(double min, double max) noexcept {
-		return { utils::random_double(min, max), utils::random_double(min, max), utils::random_double(min, max) };
+		return { T(utils::random_double()), T(utils::random_double()), T(utils::random_double()) };
 	}
 
 	[[nodiscard]]
-	static Vec3 random_in_sphere() noexcept {
-		while (true) {
-			auto v = random(-1, 1);
-			if (v.length_squared() < 1) return v;
-		}
-	}
-
-	[[nodiscard]]
-	static Vec3 random_in_sphere(double r) noexcept {
-		if (r <= 0) return { 0, 0, 0 };
-		const auto r2 = r * r;
-		while (true) {
-			auto v = random(-r, r);
-			if (v.length_squared() < r) return v;
-		}
-	}
-
-	[[nodiscard]]
-	static Vec3 random_unit() noexcept {
-		return random_in_sphere().unit();
-	}
-
-	[[nodiscard]]
-	static Vec3 random_in_unit_disk() noexcept {
-		while (true) {
-			auto v = Vec3{ utils::random_double(-1, 1), utils::random_double(-1, 1), 0 };
-			if (v.length_squared() < 1) return v;
-		}
+	static Vec3 random(T min, T max) noexcept {
+		return { T(utils::random_double(min, max)), T(utils::random_double(min, max)), T(utils::random_double(min, max)) };
 	}
 
 	friend
@@ -206,12 +193,20 @@ struct Vec3 {
 	}
 
 	friend
-	Vec3 lerp(const Vec3& a, const Vec3& b, double t)
+	Vec3 lerp(const Vec3& a, const Vec3& b, T t)
 	{
 		return a * (1 - t) + b * t;
 	}
 };
 
+static_assert(BasicVec3<double>{ 1, 2, 3 }.x() == 1 && BasicVec3<double>{ 1, 2, 3 }.y() == 2 && BasicVec3<double>{ 1, 2, 3 }.z() == 3);
+static_assert(BasicVec3<float>{ 1, 2, 3 }.x() == 1 && BasicVec3<float>{ 1, 2, 3 }.y() == 2 && BasicVec3<float>{ 1, 2, 3 }.z() == 3);
+static_assert([] { BasicVec3<double> v; v.x() = 1; v.y() = 2; v.z() = 3; return v == BasicVec3<double>{ 1, 2, 3 }; }());
+static_assert([] { const BasicVec3<double> v{ 1, 2, 3 }; return v.x() == 1 && v.y() == 2 && v.z() == 3; }());
+static_assert([] { const BasicVec3<float> v{ 1, 2, 3 }; return v.x() == 1 && v.y() == 2 && v.z() == 3; }());
+static_assert(BasicVec3<double>{ 1, 0, 0 }.cross({ 0, 1, 0 }) == BasicVec3<double>{ 0, 0, 1 });
+
+using Vec3 = BasicVec3<Scalar>;
 using Color = Vec3;
 using Position = Vec3;
 using Direction = Vec3;
\ No newline at end of file
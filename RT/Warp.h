@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Sampler.h"
+#include "Vec3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <numbers>
+#include <utility>
+
+//closed form warps of uniform samples from [0, 1)^2, unlike rejection they keep stratification of the samples
+//random_* ones warp the next samples of the thread's sampler
+namespace warp {
+	//uniform on the unit sphere, z is uniform and so is the angle around it (Archimedes)
+	template <std::floating_point T>
+	[[nodiscard]]
+	BasicVec3<T> unit_from_square(T u, T v) noexcept {
+		const auto z = 1 - 2 * u;
+		const auto r = std::sqrt(std::max(T(0), 1 - z * z));
+		const auto phi = 2 * std::numbers::pi_v<T> * v;
+		return { r * std::cos(phi), r * std::sin(phi), z };
+	}
+
+	//uniform in the unit disk (z = 0), squares around the center are mapped to rings (Shirley, Chiu)
+	template <std::floating_point T>
+	[[nodiscard]]
+	BasicVec3<T> disk_from_square(T u, T v) noexcept {
+		const auto a = 2 * u - 1;
+		const auto b = 2 * v - 1;
+		if (a == 0 && b == 0) return { 0, 0, 0 };
+
+		constexpr auto quarter_pi = std::numbers::pi_v<T> / 4;
+		const auto [r, phi] = std::abs(a) > std::abs(b)
+			? std::pair{ a, quarter_pi * (b / a) }
+			: std::pair{ b, 2 * quarter_pi - quarter_pi * (a / b) };
+		return { r * std::cos(phi), r * std::sin(phi), 0 };
+	}
+
+	//uniform in the unit ball, radius has density proportional to its square
+	template <std::floating_point T>
+	[[nodiscard]]
+	BasicVec3<T> ball_from_cube(T u, T v, T w) noexcept {
+		return unit_from_square(u, v) * std::cbrt(w);
+	}
+
+	[[nodiscard]]
+	inline Vec3 random_in_sphere() noexcept {
+		const auto [u, v] = utils::sampler.get_2d();
+		return ball_from_cube(Scalar(u), Scalar(v), Scalar(utils::sampler.get_1d()));
+	}
+
+	[[nodiscard]]
+	inline Vec3 random_in_sphere(Scalar r) noexcept {
+		if (r <= 0) return { 0, 0, 0 };
+		return random_in_sphere() * r;
+	}
+
+	[[nodiscard]]
+	inline Vec3 random_unit() noexcept {
+		const auto [u, v] = utils::sampler.get_2d();
+		return unit_from_square(Scalar(u), Scalar(v));
+	}
+
+	[[nodiscard]]
+	inline Vec3 random_in_unit_disk() noexcept {
+		const auto [u, v] = utils::sampler.get_2d();
+		return disk_from_square(Scalar(u), Scalar(v));
+	}
+}
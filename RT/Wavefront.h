@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Vec3.h"
+#include "Ray.h"
+#include "Frame.h"
+
+#include <cstdint>
+#include <vector>
+
+//In-flight paths of the wavefront engine, one array per field.
+//Stages walk the arrays in order, so each of them touches only the fields it needs.
+struct PathQueue {
+	std::vector<Position> origins;
+	std::vector<Direction> directions;
+	std::vector<Scalar> times;
+	std::vector<Color> throughputs;
+	std::vector<uint32_t> pixels;   //pixel index in the frame, keys random streams together with sample
+	std::vector<uint32_t> samples;
+	std::vector<uint32_t> slots;    //where the path's color goes in the batch results
+	std::vector<Scalar> pdfs;       //density of the last scattered direction for weighting of emitters it finds, 0 if specular
+
+	[[nodiscard]]
+	size_t size() const noexcept {
+		return slots.size();
+	}
+
+	void resize(size_t size) {
+		origins.resize(size);
+		directions.resize(size);
+		times.resize(size);
+		throughputs.resize(size);
+		pixels.resize(size);
+		samples.resize(size);
+		slots.resize(size);
+		pdfs.resize(size);
+	}
+
+	[[nodiscard]]
+	Ray ray(size_t i) const noexcept {
+		return { origins[i], directions[i], times[i] };
+	}
+
+	void set_ray(size_t i, const Ray& ray) noexcept {
+		origins[i] = ray.origin();
+		directions[i] = ray.direction();
+		times[i] = ray.time();
+	}
+
+	//copies path i to position j of other queue
+	void copy_to(size_t i, PathQueue& other, size_t j) const noexcept {
+		other.origins[j] = origins[i];
+		other.directions[j] = directions[i];
+		other.times[j] = times[i];
+		other.throughputs[j] = throughputs[i];
+		other.pixels[j] = pixels[i];
+		other.samples[j] = samples[i];
+		other.slots[j] = slots[i];
+		other.pdfs[j] = pdfs[i];
+	}
+};
+
+struct WavefrontRender {
+	Frame image;
+	uint64_t rays = 0; //rays intersected with the scene, over all bounces
+};
@@ -1,21 +1,126 @@
 #pragma once
 
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <new>
 #include <random>
+#include <string_view>
 #include <type_traits>
 #include <optional>
+#include <tuple>
+#include <vector>
 
 namespace utils {
-	inline thread_local std::mt19937 rng;
-	inline thread_local std::uniform_real_distribution default_distribution{ 0.0, 1.0 };
+	//Counter based generator - n-th value of a stream is a hash of (key, n), so there is no state to carry
+	//between pixels and any sample can be reproduced without replaying the ones before it.
+	//Streams are keyed by (pixel, sample, bounce), the hash is SplitMix64 finalizer.
+	//Satisfies UniformRandomBitGenerator, so it can be used with standard distributions as well.
+	class CounterRng {
+		uint64_t seed_ = 0;
+		uint64_t sample_key_ = 0;
+		uint64_t key_ = 0;
+		uint64_t counter_ = 0;
+
+		static constexpr uint64_t golden_gamma = 0x9e3779b97f4a7c15;
+
+	public:
+		using result_type = uint64_t;
+
+		[[nodiscard]] static constexpr
+		uint64_t mix(uint64_t z) noexcept {
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+			return z ^ (z >> 31);
+		}
+
+		constexpr CounterRng() = default;
+		constexpr explicit CounterRng(uint64_t seed) noexcept { this->seed(seed); }
+
+		//selects global stream, used outside of rendering (e.g. when generating scenes)
+		constexpr
+		void seed(uint64_t seed = 0) noexcept {
+			seed_ = mix(seed);
+			sample_key_ = seed_;
+			key_ = seed_;
+			counter_ = 0;
+		}
+
+		//key of all samples of the pixel under current seed
+		[[nodiscard]] constexpr
+		uint64_t pixel_key(uint64_t pixel) const noexcept {
+			return mix(seed_ ^ pixel);
+		}
+
+		constexpr
+		void start_sample(uint64_t pixel, uint64_t sample) noexcept {
+			sample_key_ = mix(pixel_key(pixel) + sample * golden_gamma);
+			start_bounce(0);
+		}
+
+		constexpr
+		void start_bounce(uint64_t bounce) noexcept {
+			key_ = mix(sample_key_ + bounce * golden_gamma);
+			counter_ = 0;
+		}
+
+		[[nodiscard]] static constexpr
+		result_type min() noexcept { return 0; }
+
+		[[nodiscard]] static constexpr
+		result_type max() noexcept { return UINT64_MAX; }
+
+		constexpr
+		result_type operator()() noexcept {
+			return mix(key_ + ++counter_ * golden_gamma);
+		}
+
+		//uniform in [0, 1)
+		constexpr
+		double uniform() noexcept {
+			return ((*this)() >> 11) * 0x1.0p-53;
+		}
+	};
+
+	inline thread_local CounterRng rng;
 
 	inline double random_double() noexcept {
-		return default_distribution(rng);
+		return rng.uniform();
 	}
 
 	inline double random_double(double min, double max) noexcept {
-		return default_distribution(rng, std::uniform_real_distribution<double>::param_type{ min, max });
+		return min + (max - min) * rng.uniform();
 	}
 
+	//allocator returning memory aligned to Alignment bytes, e.g. cache line or SIMD register size
+	template <typename T, size_t Alignment>
+	struct AlignedAllocator {
+		static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0, "Wrong alignment");
+
+		using value_type = T;
+
+		template <typename U>
+		struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+		constexpr AlignedAllocator() noexcept = default;
+
+		template <typename U>
+		constexpr AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+		[[nodiscard]]
+		T* allocate(size_t n) {
+			return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ Alignment }));
+		}
+
+		void deallocate(T* p, size_t) noexcept {
+			::operator delete(p, std::align_val_t{ Alignment });
+		}
+
+		template <typename U>
+		constexpr bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+	};
+
 	template <typename T>
 	T clamp(T x, T min, T max) {
 		return x < min ? min
@@ -107,4 +212,28 @@ namespace utils {
 
 		return impl(std::integral_constant<size_t, 0>{}, impl);
 	}
+
+	//whitespace separated words of a line up to its # comment, for text scenes and manifests
+	[[nodiscard]]
+	inline std::vector<std::string_view> split_words(std::string_view line) {
+		line = line.substr(0, line.find('#'));
+		std::vector<std::string_view> words;
+		while (true) {
+			const auto begin = line.find_first_not_of(" \t\r");
+			if (begin == std::string_view::npos) break;
+			line.remove_prefix(begin);
+			const auto end = std::min(line.find_first_of(" \t\r"), line.size());
+			words.push_back(line.substr(0, end));
+			line.remove_prefix(end);
+		}
+		return words;
+	}
+
+	//whole word as a number
+	template <typename T>
+	[[nodiscard]]
+	bool parse_number(std::string_view word, T& value) {
+		const auto [next, error] = std::from_chars(word.data(), word.data() + word.size(), value);
+		return error == std::errc{} && next == word.data() + word.size();
+	}
 }
\ No newline at end of file